@@ -0,0 +1,148 @@
+/// @file
+/// Measures the SoundFont 2 writing throughput of SF2cute.
+
+#include <stdint.h>
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <iostream>
+#include <streambuf>
+#include <ostream>
+#include <stdexcept>
+
+#include <sf2cute.hpp>
+
+using namespace sf2cute;
+
+namespace {
+
+/// The length of each sample, in sample data points.
+constexpr size_t kSampleLength = 1024 * 1024;
+
+/// The ScratchStreamBuffer class represents a stream buffer that copies every byte
+/// into a small scratch area and then discards it.
+///
+/// It keeps the measurement free from the cost of a storage device,
+/// while the data are still read as a real device would.
+class ScratchStreamBuffer : public std::streambuf {
+protected:
+  /// Copies a sequence of characters into the scratch area.
+  /// @param s the characters to be written.
+  /// @param count the number of characters.
+  /// @return the number of characters written.
+  virtual std::streamsize xsputn(const char * s, std::streamsize count) override {
+    std::streamsize remaining = count;
+    while (remaining > 0) {
+      const std::streamsize length = std::min<std::streamsize>(remaining, kScratchSize - position_);
+      std::memcpy(&scratch_[position_], s, size_t(length));
+      position_ = (position_ + length) % kScratchSize;
+      s += length;
+      remaining -= length;
+    }
+    return count;
+  }
+
+  /// Copies a character into the scratch area.
+  /// @param ch the character to be written.
+  /// @return a value other than EOF.
+  virtual int_type overflow(int_type ch) override {
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+      scratch_[position_] = traits_type::to_char_type(ch);
+      position_ = (position_ + 1) % kScratchSize;
+    }
+    return traits_type::not_eof(ch);
+  }
+
+private:
+  /// The size of the scratch area, in bytes.
+  static constexpr std::streamsize kScratchSize = 1024 * 1024;
+
+  /// The scratch area.
+  std::vector<char> scratch_ = std::vector<char>(kScratchSize);
+
+  /// The current position in the scratch area.
+  std::streamsize position_ = 0;
+};
+
+/// Makes a SoundFont that contains the specified amount of sample data.
+/// @param sample_pool_megabytes the size of the sample pool, in megabytes.
+/// @return the SoundFont.
+std::unique_ptr<SoundFont> MakeSoundFont(size_t sample_pool_megabytes) {
+  std::unique_ptr<SoundFont> sf2 = std::make_unique<SoundFont>();
+  std::mt19937 engine(1);
+
+  size_t num_samples = sample_pool_megabytes * 1024 * 1024 / (kSampleLength * sizeof(int16_t));
+  if (num_samples == 0) {
+    num_samples = 1;
+  }
+
+  for (size_t index = 0; index < num_samples; index++) {
+    std::vector<int16_t> data(kSampleLength);
+    for (int16_t & value : data) {
+      value = static_cast<int16_t>(engine());
+    }
+
+    std::shared_ptr<SFSample> sample = sf2->NewSample(
+      "Noise " + std::to_string(index), std::move(data),
+      0, uint32_t(kSampleLength), 44100, 60, 0);
+
+    std::shared_ptr<SFInstrument> instrument = sf2->NewInstrument(
+      sample->name(),
+      std::vector<SFInstrumentZone>{
+        SFInstrumentZone(sample)
+      });
+
+    sf2->NewPreset(instrument->name(), uint16_t(index % 128), uint16_t(index / 128),
+      std::vector<SFPresetZone>{
+        SFPresetZone(instrument)
+      });
+  }
+
+  return sf2;
+}
+
+} // namespace
+
+/// Measures the SoundFont 2 writing throughput of SF2cute.
+/// @param argc Number of arguments.
+/// @param argv Argument vector. argv[1] is the sample pool size in megabytes (default: 256),
+/// argv[2] is the number of iterations (default: 5).
+/// @return 0 if the benchmark is successfully finished.
+int main(int argc, char * argv[]) {
+  const size_t sample_pool_megabytes = (argc >= 2) ? std::strtoul(argv[1], nullptr, 10) : 256;
+  const int num_iterations = (argc >= 3) ? std::atoi(argv[2]) : 5;
+
+  try {
+    std::unique_ptr<SoundFont> sf2 = MakeSoundFont(sample_pool_megabytes);
+
+    ScratchStreamBuffer scratch_buffer;
+    std::ostream out(&scratch_buffer);
+
+    double best_seconds = 0;
+    for (int iteration = 0; iteration < num_iterations; iteration++) {
+      const auto start = std::chrono::steady_clock::now();
+      sf2->Write(out);
+      const auto end = std::chrono::steady_clock::now();
+
+      const double seconds = std::chrono::duration<double>(end - start).count();
+      if (iteration == 0 || seconds < best_seconds) {
+        best_seconds = seconds;
+      }
+    }
+
+    const double megabytes = double(sf2->samples().size() * kSampleLength * sizeof(int16_t)) / (1024 * 1024);
+    std::cout << "Sample pool: " << megabytes << " MB" << std::endl;
+    std::cout << "Best time: " << best_seconds * 1000.0 << " ms" << std::endl;
+    std::cout << "Throughput: " << megabytes / best_seconds << " MB/s" << std::endl;
+    return 0;
+  }
+  catch (const std::exception & e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+}
@@ -19,5 +19,13 @@
 #include "sf2cute/preset_zone.hpp"
 #include "sf2cute/preset.hpp"
 #include "sf2cute/file.hpp"
+#include "sf2cute/file_parser.hpp"
+#include "sf2cute/file_reader.hpp"
+#include "sf2cute/file_writer.hpp"
+#include "sf2cute/build_cache.hpp"
+#include "sf2cute/sample_encoder.hpp"
+#include "sf2cute/output_sink.hpp"
+#include "sf2cute/write_digest.hpp"
+#include "sf2cute/write_observer.hpp"
 
 #endif // SF2CUTE_SF2CUTE_HPP_
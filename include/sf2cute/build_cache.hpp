@@ -0,0 +1,205 @@
+/// @file
+/// SoundFont build cache class header.
+///
+/// @author gocha <https://github.com/gocha>
+
+#ifndef SF2CUTE_BUILD_CACHE_HPP_
+#define SF2CUTE_BUILD_CACHE_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace sf2cute {
+
+class SFSample;
+class SoundFontWriter;
+
+/// The SFBuildCache class remembers where the data of each sample sits in the output of a previous build.
+///
+/// When SoundFontWriter writes a file with a build cache, the data of every sample that is found
+/// in the previous output at the same file name is copied from there in the kernel
+/// (copy_file_range or sendfile, where available), instead of being serialized from SFSample::data().
+/// Only the new samples, the INFO chunk and the hydra chunks are serialized.
+///
+/// A sample is found by two XXH64 hashes of its data points with different seeds, 128 bits
+/// in total, and by their length, so that the previous output is not read again to confirm a hit.
+/// With set_verify_data(true), the bytes in the previous output are also compared with
+/// the data points before they are copied. The previous output is used only if its size
+/// and modification time are the same as when it was written.
+///
+/// @remarks The cache is used by SoundFontWriter::Write(const std::string &)
+/// where the POSIX file I/O functions are available. The samples whose data are stored
+/// in a file (SFSample::has_file_source()) are always copied from their own file.
+class SFBuildCache {
+public:
+  /// Constructs a new empty SFBuildCache.
+  SFBuildCache();
+
+  /// Constructs a new copy of specified SFBuildCache.
+  /// @param origin a SFBuildCache object.
+  SFBuildCache(const SFBuildCache & origin) = default;
+
+  /// Copy-assigns a new value to the SFBuildCache, replacing its current contents.
+  /// @param origin a SFBuildCache object.
+  SFBuildCache & operator=(const SFBuildCache & origin) = default;
+
+  /// Acquires the contents of specified SFBuildCache.
+  /// @param origin a SFBuildCache object.
+  SFBuildCache(SFBuildCache && origin) = default;
+
+  /// Move-assigns a new value to the SFBuildCache, replacing its current contents.
+  /// @param origin a SFBuildCache object.
+  SFBuildCache & operator=(SFBuildCache && origin) = default;
+
+  /// Destructs the SFBuildCache.
+  ~SFBuildCache() = default;
+
+  /// Returns the name of the file that the cache refers to.
+  /// @return the name of the file written by the last build, or an empty string if the cache is empty.
+  const std::string & filename() const noexcept {
+    return filename_;
+  }
+
+  /// Returns the number of samples that the cache knows.
+  /// @return the number of distinct sample data in the previous output.
+  size_t num_entries() const noexcept {
+    return entries_.size();
+  }
+
+  /// Returns the number of samples copied from the previous output by the last write.
+  /// @return the number of samples copied from the previous output.
+  size_t num_copied_samples() const noexcept {
+    return num_copied_samples_;
+  }
+
+  /// Returns the number of samples serialized from their data by the last write.
+  /// @return the number of samples serialized from SFSample::data().
+  size_t num_serialized_samples() const noexcept {
+    return num_serialized_samples_;
+  }
+
+  /// Returns true if the cached bytes are compared with the sample data before they are copied.
+  /// @return true if the cached bytes are compared with the sample data.
+  bool verify_data() const noexcept {
+    return verify_data_;
+  }
+
+  /// Sets whether the cached bytes are compared with the sample data before they are copied.
+  ///
+  /// The comparison reads every copied sample from the previous output,
+  /// so that the time of a rebuild grows with the size of the whole bank again.
+  /// @param verify_data true to compare the cached bytes with the sample data.
+  void set_verify_data(bool verify_data) noexcept {
+    verify_data_ = verify_data;
+  }
+
+  /// Removes all the entries, so that the next write serializes every sample.
+  void Clear();
+
+  /// Loads the index of a previous build.
+  /// @param filename the name of the index file. If the file does not exist, the cache is cleared.
+  /// @throws std::ios_base::failure The index could not be read, or is malformed.
+  void Load(const std::string & filename);
+
+  /// Saves the index of the last build.
+  ///
+  /// The index is written to a temporary file next to it (filename + ".tmp"),
+  /// which then replaces the index, so that a failed save keeps the previous index.
+  /// @param filename the name of the index file.
+  /// @throws std::ios_base::failure An I/O error occurred.
+  void Save(const std::string & filename) const;
+
+  /// Returns the key of the data of a sample.
+  /// @param sample the sample.
+  /// @return the XXH64 hash of the data points in little-endian order.
+  static uint64_t GetSampleKey(const SFSample & sample);
+
+private:
+  friend class SoundFontWriter;
+
+  /// The seed of the second hash of the sample data.
+  static constexpr uint64_t kCheckSeed = 0x9E3779B97F4A7C15;
+
+  /// The SampleHash struct represents the hashes of a sample data.
+  struct SampleHash {
+    /// The XXH64 hash of the data points in little-endian order, which the entries are keyed by.
+    uint64_t key;
+
+    /// The XXH64 hash of the same data points, seeded with kCheckSeed.
+    uint64_t check;
+  };
+
+  /// The Entry struct represents the place of a sample data in the previous output.
+  struct Entry {
+    /// The length of the data, in sample data points.
+    uint32_t length;
+
+    /// The offset of the first data point in the file, in terms of bytes.
+    uint64_t offset;
+
+    /// The second hash of the data, which confirms a match of the key.
+    uint64_t check;
+  };
+
+  /// Returns the hashes of the data of a sample, computed in one pass.
+  /// @param sample the sample.
+  /// @return the hashes of the data points in little-endian order.
+  static SampleHash HashSample(const SFSample & sample);
+
+  /// Returns true if the entries refer to the specified file.
+  /// @param filename the name of the file.
+  /// @param fd the file descriptor of the file opened for reading.
+  /// @return true if the file has the same name, size and modification time as the cached output.
+  bool Matches(const std::string & filename, int fd) const;
+
+  /// Finds the place of a sample data in the previous output.
+  /// @param hash the hashes of the sample data.
+  /// @param length the length of the sample data, in sample data points.
+  /// @return the pointer to the entry, or nullptr if the data is not cached.
+  const Entry * Find(const SampleHash & hash, uint32_t length) const;
+
+  /// Returns true if the data of a sample is stored at the place of an entry.
+  /// @param fd the file descriptor of the previous output opened for reading.
+  /// @param entry the place of the sample data in the previous output.
+  /// @param sample the sample.
+  /// @return true if the bytes at the place are the data points of the sample in little-endian order.
+  /// @throws std::ios_base::failure The file could not be read.
+  static bool HasSameData(int fd, const Entry & entry, const SFSample & sample);
+
+  /// Replaces the entries with the places of the samples in a newly written file.
+  /// @param filename the name of the written file.
+  /// @param keys the keys of the samples.
+  /// @param entries the places of the samples.
+  /// @throws std::ios_base::failure The file could not be examined.
+  void Reset(const std::string & filename,
+      const std::vector<uint64_t> & keys,
+      const std::vector<Entry> & entries);
+
+  /// The name of the file that the entries refer to.
+  std::string filename_;
+
+  /// The size of the file when it was written, in terms of bytes.
+  uint64_t file_size_;
+
+  /// The modification time of the file when it was written, in nanoseconds since the epoch.
+  int64_t file_mtime_;
+
+  /// The places of the sample data, by their keys.
+  std::unordered_map<uint64_t, Entry> entries_;
+
+  /// The number of samples copied from the previous output by the last write.
+  size_t num_copied_samples_;
+
+  /// The number of samples serialized from their data by the last write.
+  size_t num_serialized_samples_;
+
+  /// True if the cached bytes are compared with the sample data before they are copied.
+  bool verify_data_;
+};
+
+} // namespace sf2cute
+
+#endif // SF2CUTE_BUILD_CACHE_HPP_
@@ -10,6 +10,7 @@
 #include <memory>
 #include <utility>
 #include <functional>
+#include <future>
 #include <vector>
 #include <unordered_map>
 
@@ -23,6 +24,7 @@ class SFInstrument;
 class SFPresetZone;
 class SFPreset;
 class SoundFont;
+class OutputSink;
 
 /// The SoundFont class represents a SoundFont file.
 class SoundFont {
@@ -396,6 +398,16 @@ public:
   /// @throws std::ios_base::failure An I/O error occurred.
   void Write(const std::string & filename);
 
+  /// Writes the SoundFont to a file in the background.
+  ///
+  /// The serialization overlaps with the file output on a dedicated I/O thread.
+  /// @param filename the name of the file to write to.
+  /// @return the future that becomes ready when the file is written.
+  /// It rethrows the structural errors and the I/O errors of the write.
+  /// @remarks The SoundFont must not be modified nor destructed until the future becomes ready.
+  /// Use SoundFontWriter to configure the buffers.
+  std::future<void> WriteAsync(const std::string & filename);
+
   /// Writes the SoundFont to an output stream.
   /// @param out the output stream to write to.
   void Write(std::ostream & out);
@@ -403,6 +415,26 @@ public:
   /// @copydoc SoundFont::Write(std::ostream &)
   void Write(std::ostream && out);
 
+  /// Writes the SoundFont to an output sink.
+  /// @param out the output sink to write to.
+  /// @throws std::logic_error The SoundFont has a structural error.
+  /// @throws std::ios_base::failure An I/O error occurred.
+  void Write(OutputSink & out);
+
+  /// Writes the SoundFont to a new memory buffer.
+  /// @return the bytes of the SoundFont file.
+  /// @throws std::logic_error The SoundFont has a structural error.
+  /// @remarks The buffer is allocated once with the exact file size.
+  std::vector<char> WriteToBuffer();
+
+  /// Writes the SoundFont to a caller-supplied memory area.
+  /// @param data the pointer to the memory area.
+  /// @param capacity the size of the memory area, in terms of bytes.
+  /// @return the number of bytes written, that is, the size of the SoundFont file.
+  /// @throws std::logic_error The SoundFont has a structural error,
+  /// or the memory area is too small (std::length_error).
+  std::vector<char>::size_type WriteToBuffer(void * data, std::vector<char>::size_type capacity);
+
 private:
   /// The default value of the target sound engine.
   static constexpr auto kDefaultTargetSoundEngine = "EMU8000";
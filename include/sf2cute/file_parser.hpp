@@ -0,0 +1,235 @@
+/// @file
+/// SoundFont 2 File parser classes header.
+///
+/// @author gocha <https://github.com/gocha>
+
+#ifndef SF2CUTE_FILE_PARSER_HPP_
+#define SF2CUTE_FILE_PARSER_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <istream>
+
+#include "types.hpp"
+#include "generator_item.hpp"
+#include "modulator_item.hpp"
+
+namespace sf2cute {
+
+/// Values that represents the level of the hydra that a bag, generator or modulator belongs to.
+enum class SFHydraLevel : uint8_t {
+  /// The preset level (pbag, pgen and pmod chunks).
+  kPreset = 0,
+  /// The instrument level (ibag, igen and imod chunks).
+  kInstrument = 1
+};
+
+/// The SFParsedPresetHeader struct represents a record of "phdr" chunk.
+struct SFParsedPresetHeader {
+  /// The name of the preset.
+  std::string name;
+
+  /// The MIDI preset number.
+  uint16_t preset_number;
+
+  /// The MIDI bank number.
+  uint16_t bank;
+
+  /// The index of the first preset bag of the preset.
+  uint16_t bag_index;
+
+  /// The library value (reserved).
+  uint32_t library;
+
+  /// The genre value (reserved).
+  uint32_t genre;
+
+  /// The morphology value (reserved).
+  uint32_t morphology;
+};
+
+/// The SFParsedBag struct represents a record of "pbag" or "ibag" chunk.
+struct SFParsedBag {
+  /// The index of the first generator of the zone.
+  uint16_t generator_index;
+
+  /// The index of the first modulator of the zone.
+  uint16_t modulator_index;
+};
+
+/// The SFParsedInstrument struct represents a record of "inst" chunk.
+struct SFParsedInstrument {
+  /// The name of the instrument.
+  std::string name;
+
+  /// The index of the first instrument bag of the instrument.
+  uint16_t bag_index;
+};
+
+/// The SFParsedSampleHeader struct represents a record of "shdr" chunk.
+struct SFParsedSampleHeader {
+  /// The name of the sample.
+  std::string name;
+
+  /// The index of the first data point in the sample data, in sample data points.
+  uint32_t start;
+
+  /// The index next to the last data point in the sample data, in sample data points.
+  uint32_t end;
+
+  /// The beginning index of the loop in the sample data, in sample data points, inclusive.
+  uint32_t start_loop;
+
+  /// The ending index of the loop in the sample data, in sample data points, exclusive.
+  uint32_t end_loop;
+
+  /// The sample rate, in hertz.
+  uint32_t sample_rate;
+
+  /// The MIDI key number of the recorded pitch of the sample.
+  uint8_t original_key;
+
+  /// The pitch correction that should be applied to the sample, in cents.
+  int8_t correction;
+
+  /// The index of the associated right or left stereo sample.
+  uint16_t sample_link;
+
+  /// Both the type of sample and the whether the sample is located in RAM or ROM memory.
+  /// The value is kept as stored, including the flags that SFSampleLink does not name.
+  SFSampleLink type;
+};
+
+/// The SFParseHandler class represents an interface that receives the records parsed by SoundFontParser.
+///
+/// Each callback is called in file order, once for each chunk or record.
+/// The hydra records are passed as stored, including the terminator records,
+/// and the indices between them are not checked.
+/// @remarks The objects passed to a callback are valid only during the call.
+/// Throw an exception from a callback to stop parsing.
+class SFParseHandler {
+public:
+  /// Destructs the SFParseHandler.
+  virtual ~SFParseHandler() = default;
+
+  /// Called for a chunk with a string in "INFO" chunk.
+  /// @param name the name of the chunk (FourCC).
+  /// @param text the string, which ends at the first null character.
+  /// @remarks The default implementation does nothing.
+  virtual void OnInfo(const std::string & name, const std::string & text);
+
+  /// Called for a chunk with a version number in "INFO" chunk ("ifil" or "iver").
+  /// @param name the name of the chunk (FourCC).
+  /// @param version the version number.
+  /// @remarks The default implementation does nothing.
+  virtual void OnVersion(const std::string & name, const SFVersionTag & version);
+
+  /// Called for a chunk in "sdta" chunk, such as "smpl" and "sm24". The data is skipped.
+  /// @param name the name of the chunk (FourCC).
+  /// @param offset the offset of the chunk data from the beginning of the file, in terms of bytes.
+  /// @param size the length of the chunk data, in terms of bytes.
+  /// @remarks The default implementation does nothing.
+  virtual void OnSampleData(const std::string & name, uint64_t offset, uint32_t size);
+
+  /// Called for a record of "phdr" chunk.
+  /// @param index the index of the record.
+  /// @param header the record.
+  /// @remarks The default implementation does nothing.
+  virtual void OnPresetHeader(size_t index, const SFParsedPresetHeader & header);
+
+  /// Called for a record of "pbag" or "ibag" chunk.
+  /// @param level the level of the chunk.
+  /// @param index the index of the record.
+  /// @param bag the record.
+  /// @remarks The default implementation does nothing.
+  virtual void OnBag(SFHydraLevel level, size_t index, const SFParsedBag & bag);
+
+  /// Called for a record of "pmod" or "imod" chunk.
+  /// @param level the level of the chunk.
+  /// @param index the index of the record.
+  /// @param modulator the record.
+  /// @remarks The default implementation does nothing.
+  virtual void OnModulator(SFHydraLevel level, size_t index, const SFModulatorItem & modulator);
+
+  /// Called for a record of "pgen" or "igen" chunk.
+  /// @param level the level of the chunk.
+  /// @param index the index of the record.
+  /// @param generator the record.
+  /// @remarks The default implementation does nothing.
+  virtual void OnGenerator(SFHydraLevel level, size_t index, const SFGeneratorItem & generator);
+
+  /// Called for a record of "inst" chunk.
+  /// @param index the index of the record.
+  /// @param instrument the record.
+  /// @remarks The default implementation does nothing.
+  virtual void OnInstrument(size_t index, const SFParsedInstrument & instrument);
+
+  /// Called for a record of "shdr" chunk.
+  /// @param index the index of the record.
+  /// @param header the record.
+  /// @remarks The default implementation does nothing.
+  virtual void OnSampleHeader(size_t index, const SFParsedSampleHeader & header);
+};
+
+/// The SoundFontParser class represents an event-driven SoundFont parser.
+///
+/// The parser reads a SoundFont 2 file in one forward pass, and passes each chunk
+/// and hydra record to SFParseHandler as it goes, without building a SoundFont.
+/// The sample data is skipped, and the memory used does not depend on the file size.
+/// @remarks A string longer than the limit of the specification (65,536 bytes) is truncated.
+class SoundFontParser {
+public:
+  /// The maximum length of a string passed to SFParseHandler::OnInfo(), in terms of bytes.
+  static constexpr size_t kMaxInfoTextLength = 65536;
+
+  /// Constructs a new SoundFontParser.
+  SoundFontParser() = default;
+
+  /// Constructs a new copy of specified SoundFontParser.
+  /// @param origin a SoundFontParser object.
+  SoundFontParser(const SoundFontParser & origin) = default;
+
+  /// Copy-assigns a new value to the SoundFontParser, replacing its current contents.
+  /// @param origin a SoundFontParser object.
+  SoundFontParser & operator=(const SoundFontParser & origin) = default;
+
+  /// Acquires the contents of specified SoundFontParser.
+  /// @param origin a SoundFontParser object.
+  SoundFontParser(SoundFontParser && origin) = default;
+
+  /// Move-assigns a new value to the SoundFontParser, replacing its current contents.
+  /// @param origin a SoundFontParser object.
+  SoundFontParser & operator=(SoundFontParser && origin) = default;
+
+  /// Destructs the SoundFontParser.
+  ~SoundFontParser() = default;
+
+  /// Parses a file.
+  /// @param filename the name of the file to parse.
+  /// @param handler the handler that receives the records.
+  /// @throws std::ios_base::failure An I/O error occurred, or the file is not a valid SoundFont 2 file.
+  /// @remarks The file is mapped into memory where the POSIX file I/O functions are available.
+  void Parse(const std::string & filename, SFParseHandler & handler);
+
+  /// Parses an input stream.
+  /// @param in the input stream to parse. The sample data is skipped by seeking
+  /// if the stream supports it, and by reading otherwise.
+  /// @param handler the handler that receives the records.
+  /// @throws std::ios_base::failure An I/O error occurred, or the stream is not a valid SoundFont 2 file.
+  void Parse(std::istream & in, SFParseHandler & handler);
+
+  /// @copydoc SoundFontParser::Parse(std::istream &, SFParseHandler &)
+  void Parse(std::istream && in, SFParseHandler & handler);
+
+  /// Parses memory.
+  /// @param data the pointer to the bytes of the SoundFont file.
+  /// @param size the size of the SoundFont file, in terms of bytes.
+  /// @param handler the handler that receives the records.
+  /// @throws std::ios_base::failure The bytes are not a valid SoundFont 2 file.
+  void Parse(const void * data, size_t size, SFParseHandler & handler);
+};
+
+} // namespace sf2cute
+
+#endif // SF2CUTE_FILE_PARSER_HPP_
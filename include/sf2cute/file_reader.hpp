@@ -0,0 +1,194 @@
+/// @file
+/// SoundFont 2 File reader class header.
+///
+/// @author gocha <https://github.com/gocha>
+
+#ifndef SF2CUTE_FILE_READER_HPP_
+#define SF2CUTE_FILE_READER_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <istream>
+#include <vector>
+
+#include "types.hpp"
+#include "file.hpp"
+
+namespace sf2cute {
+
+/// The SFPresetSummary struct represents the identity of a preset read by SoundFontReader::ReadSummary().
+struct SFPresetSummary {
+  /// The name of the preset.
+  std::string name;
+
+  /// The MIDI preset number.
+  uint16_t preset_number;
+
+  /// The MIDI bank number.
+  uint16_t bank;
+};
+
+/// The SFFileSummary struct represents the metadata of a SoundFont file read by SoundFontReader::ReadSummary().
+///
+/// @remarks The strings are empty if the file does not have the chunks.
+struct SFFileSummary {
+  /// The SoundFont version (ifil).
+  SFVersionTag version;
+
+  /// The target sound engine name (isng).
+  std::string sound_engine;
+
+  /// The SoundFont bank name (INAM).
+  std::string bank_name;
+
+  /// The Sound ROM name (irom).
+  std::string rom_name;
+
+  /// True if the file has a Sound ROM version.
+  bool has_rom_version;
+
+  /// The Sound ROM version (iver).
+  SFVersionTag rom_version;
+
+  /// The date of creation of the bank (ICRD).
+  std::string creation_date;
+
+  /// The sound designers and engineers for the bank (IENG).
+  std::string engineers;
+
+  /// The product for which the bank was intended (IPRD).
+  std::string product;
+
+  /// The copyright message (ICOP).
+  std::string copyright;
+
+  /// The comments on the bank (ICMT).
+  std::string comment;
+
+  /// The SoundFont tools used to create and alter the bank (ISFT).
+  std::string software;
+
+  /// The presets, in file order, excluding the terminator record.
+  std::vector<SFPresetSummary> presets;
+};
+
+/// The SoundFontReader class represents a SoundFont reader.
+///
+/// The reader builds a SoundFont from a SoundFont 2 file: the INFO chunk becomes the
+/// properties of the SoundFont, and the hydra (pdta) chunks become its presets, instruments
+/// and samples, with the zones that the bag indices point to. Every RIFF chunk is visited
+/// in place, and each hydra record is decoded once, so the hydra is read in linear time.
+/// @remarks The terminal instrument and sampleID generators become the links of the zones,
+/// and the zones that the specification tells to ignore, such as a non-first zone
+/// without the terminal generator, are skipped.
+class SoundFontReader {
+public:
+  /// Constructs a new SoundFontReader.
+  SoundFontReader();
+
+  /// Constructs a new copy of specified SoundFontReader.
+  /// @param origin a SoundFontReader object.
+  SoundFontReader(const SoundFontReader & origin) = default;
+
+  /// Copy-assigns a new value to the SoundFontReader, replacing its current contents.
+  /// @param origin a SoundFontReader object.
+  SoundFontReader & operator=(const SoundFontReader & origin) = default;
+
+  /// Acquires the contents of specified SoundFontReader.
+  /// @param origin a SoundFontReader object.
+  SoundFontReader(SoundFontReader && origin) = default;
+
+  /// Move-assigns a new value to the SoundFontReader, replacing its current contents.
+  /// @param origin a SoundFontReader object.
+  SoundFontReader & operator=(SoundFontReader && origin) = default;
+
+  /// Destructs the SoundFontReader.
+  ~SoundFontReader() = default;
+
+  /// Returns the number of threads used to decode the samples and the hydra.
+  /// @return the number of threads.
+  unsigned num_threads() const noexcept {
+    return num_threads_;
+  }
+
+  /// Sets the number of threads used to decode the samples and the hydra.
+  ///
+  /// If more than one thread is used, the samples, the instruments and the presets are each
+  /// decoded concurrently from their own records and bag ranges, and are collected in file order.
+  /// The result is the same as the one decoded on a single thread.
+  /// @param num_threads the number of threads. 1 (the default) decodes
+  /// on the calling thread, and 0 uses every hardware thread.
+  /// @remarks If more than one record is invalid, the error that is reported may differ from run to run.
+  void set_num_threads(unsigned num_threads) noexcept {
+    num_threads_ = num_threads;
+  }
+
+  /// Returns true if the sample data is left in the file until it is used.
+  /// @return true if the sample data is left in the file until it is used.
+  bool lazy_sample_data() const noexcept {
+    return lazy_sample_data_;
+  }
+
+  /// Sets whether the sample data is left in the file until it is used.
+  ///
+  /// If enabled, Read(const std::string &) does not read the sample data. Each sample
+  /// records where its data is in the smpl chunk instead (SFSample::file_source()),
+  /// and SFSample::data() reads it on the first access. SoundFontWriter copies
+  /// the data straight from the file, so a SoundFont can be rewritten without holding
+  /// its sample data in memory. The samples keep the file open while they refer to it.
+  /// @param lazy_sample_data true to leave the sample data in the file.
+  /// @remarks It applies only where the POSIX file I/O functions are available.
+  /// The 24-bit samples are always read, since the lower 8 bits are in a separate chunk.
+  /// If the SoundFont is written to the file it was read from, SoundFontWriter unlinks the file
+  /// before it creates the new output, and the samples keep reading the old file.
+  void set_lazy_sample_data(bool lazy_sample_data) noexcept {
+    lazy_sample_data_ = lazy_sample_data;
+  }
+
+  /// Reads a SoundFont from a file.
+  /// @param filename the name of the file to read from.
+  /// @return the SoundFont.
+  /// @throws std::ios_base::failure An I/O error occurred, or the file is not a valid SoundFont 2 file.
+  /// @remarks The file is mapped into memory where the POSIX file I/O functions are available.
+  SoundFont Read(const std::string & filename);
+
+  /// Reads the metadata of a file, without reading the sample data or the rest of the hydra.
+  ///
+  /// Only the INFO chunk and the phdr chunk are read. The other chunks, including the sample data,
+  /// are skipped by their chunk sizes, so that the time taken does not depend on the size of the bank.
+  /// @param filename the name of the file to read from.
+  /// @return the metadata of the file.
+  /// @throws std::ios_base::failure An I/O error occurred, or the file has no INFO chunk or phdr chunk.
+  /// @remarks The chunks are read with pread(2) where the POSIX file I/O functions are available.
+  /// The version is not checked, so that SoundFont 3 files can be listed as well.
+  SFFileSummary ReadSummary(const std::string & filename);
+
+  /// Reads a SoundFont from an input stream.
+  /// @param in the input stream to read from. The rest of the stream is read.
+  /// @return the SoundFont.
+  /// @throws std::ios_base::failure An I/O error occurred, or the stream is not a valid SoundFont 2 file.
+  SoundFont Read(std::istream & in);
+
+  /// @copydoc SoundFontReader::Read(std::istream &)
+  SoundFont Read(std::istream && in);
+
+  /// Reads a SoundFont from memory.
+  /// @param data the pointer to the bytes of the SoundFont file.
+  /// @param size the size of the SoundFont file, in terms of bytes.
+  /// @return the SoundFont. It does not refer to the memory.
+  /// @throws std::ios_base::failure The bytes are not a valid SoundFont 2 file.
+  /// @remarks The sample data is always read, whatever lazy_sample_data() is.
+  SoundFont Read(const void * data, size_t size);
+
+private:
+  /// The number of threads used to decode the samples and the hydra.
+  unsigned num_threads_;
+
+  /// True if the sample data is left in the file until it is used.
+  bool lazy_sample_data_;
+};
+
+} // namespace sf2cute
+
+#endif // SF2CUTE_FILE_READER_HPP_
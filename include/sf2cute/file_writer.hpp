@@ -0,0 +1,490 @@
+/// @file
+/// SoundFont 2 File writer class header.
+///
+/// @author gocha <https://github.com/gocha>
+
+#ifndef SF2CUTE_FILE_WRITER_HPP_
+#define SF2CUTE_FILE_WRITER_HPP_
+
+#include <algorithm>
+#include <future>
+#include <memory>
+#include <string>
+#include <ostream>
+#include <vector>
+
+#include "types.hpp"
+#include "modulator.hpp"
+#include "output_sink.hpp"
+#include "sample.hpp"
+#include "write_digest.hpp"
+
+namespace sf2cute {
+
+class SFSample;
+class SFInstrumentZone;
+class SFInstrument;
+class SFPresetZone;
+class SFPreset;
+class SoundFont;
+
+class SFWriteObserver;
+class SFBuildCache;
+class SFSampleEncoder;
+class RIFFChunkInterface;
+class RIFF;
+class SFHydraLayout;
+class SFEncodedSamplePool;
+
+/// Values that represent how SoundFontWriter writes a file.
+enum class SFFileWriteMode {
+  /// Writes the file sequentially through a user-space buffer.
+  kBuffered,
+  /// Resizes the file to its final size in advance, maps it into memory,
+  /// and serializes every chunk directly into the mapping.
+  /// @remarks This mode falls back to kBuffered where memory mapping is not available.
+  kMemoryMapped,
+  /// Resizes the file to its final size in advance, computes the offset of every chunk,
+  /// and writes the chunks and the sample ranges at their offsets on num_threads() threads.
+  /// @remarks This mode falls back to kBuffered where positional writes are not available.
+  kPositional,
+  /// Writes the file sequentially with direct I/O (O_DIRECT) from page-aligned buffers,
+  /// so that a large file does not fill the page cache. The unaligned tail of the file
+  /// is written through the page cache.
+  /// @remarks This mode writes through the page cache where the platform
+  /// or the file system does not support direct I/O.
+  kDirect
+};
+
+/// Values that represent how SoundFontWriter commits a written file to the storage device.
+enum class SFSyncPolicy {
+  /// Leaves the write-back to the operating system.
+  kNone,
+  /// Waits until the file data reach the storage device (msync or fdatasync).
+  kData,
+  /// Waits until both the file data and the file metadata reach the storage device (fsync).
+  kFull
+};
+
+/// The SoundFontWriter class represents a SoundFont writer.
+class SoundFontWriter {
+public:
+  /// Constructs a new empty SoundFontWriter.
+  SoundFontWriter();
+
+  /// Constructs a new SoundFontWriter using specified file.
+  /// @param file the input SoundFont object.
+  SoundFontWriter(const SoundFont & file);
+
+  /// Constructs a new copy of specified SoundFontWriter.
+  /// @param origin a SoundFontWriter object.
+  SoundFontWriter(const SoundFontWriter & origin) = default;
+
+  /// Copy-assigns a new value to the SoundFontWriter, replacing its current contents.
+  /// @param origin a SoundFontWriter object.
+  SoundFontWriter & operator=(const SoundFontWriter & origin) = default;
+
+  /// Acquires the contents of specified SoundFontWriter.
+  /// @param origin a SoundFontWriter object.
+  SoundFontWriter(SoundFontWriter && origin) = default;
+
+  /// Move-assigns a new value to the SoundFontWriter, replacing its current contents.
+  /// @param origin a SoundFontWriter object.
+  SoundFontWriter & operator=(SoundFontWriter && origin) = default;
+
+  /// Destructs the SoundFontWriter.
+  ~SoundFontWriter() = default;
+
+  /// Returns the input SoundFont object.
+  /// @return the input SoundFont object.
+  const SoundFont & file() const noexcept {
+    return *file_;
+  }
+
+  /// Sets the input SoundFont object.
+  /// @param file the input SoundFont object.
+  void set_file(const SoundFont & file) {
+    file_ = &file;
+  }
+
+  /// Returns how the writer writes a file.
+  /// @return how the writer writes a file.
+  SFFileWriteMode file_write_mode() const noexcept {
+    return file_write_mode_;
+  }
+
+  /// Sets how the writer writes a file.
+  /// @param file_write_mode how the writer writes a file.
+  void set_file_write_mode(SFFileWriteMode file_write_mode) noexcept {
+    file_write_mode_ = file_write_mode;
+  }
+
+  /// Returns how the writer commits a written file to the storage device.
+  /// @return how the writer commits a written file to the storage device.
+  SFSyncPolicy sync_policy() const noexcept {
+    return sync_policy_;
+  }
+
+  /// Sets how the writer commits a written file to the storage device.
+  /// @param sync_policy how the writer commits a written file to the storage device.
+  void set_sync_policy(SFSyncPolicy sync_policy) noexcept {
+    sync_policy_ = sync_policy;
+  }
+
+  /// Returns the number of threads used to serialize the hydra (pdta) sub-chunks,
+  /// or to write the file in SFFileWriteMode::kPositional mode.
+  /// @return the number of threads.
+  unsigned num_threads() const noexcept {
+    return num_threads_;
+  }
+
+  /// Sets the number of threads used to serialize the hydra (pdta) sub-chunks,
+  /// or to write the file in SFFileWriteMode::kPositional mode.
+  ///
+  /// If more than one thread is used, the nine hydra sub-chunks are serialized
+  /// concurrently into memory buffers, and the buffers are written in order.
+  /// In SFFileWriteMode::kPositional mode, the threads write the chunks
+  /// and the sample ranges directly at their file offsets instead.
+  /// The SoundFont must not be modified while it is written.
+  /// @param num_threads the number of threads. 1 (the default) serializes
+  /// the sub-chunks on the calling thread, and 0 uses every hardware thread.
+  void set_num_threads(unsigned num_threads) noexcept {
+    num_threads_ = num_threads;
+  }
+
+  /// Returns the observer that the chunk writes are reported to.
+  /// @return the pointer to the observer, or nullptr if the writes are not observed.
+  SFWriteObserver * observer() const noexcept {
+    return observer_;
+  }
+
+  /// Sets the observer that the chunk writes are reported to.
+  ///
+  /// The observer gets the begin and end of the INFO chunk, the smpl chunk
+  /// and each hydra chunk, such as phdr and shdr.
+  /// @param observer the pointer to the observer, or nullptr to stop observing.
+  /// The observer must outlive the writes.
+  void set_observer(SFWriteObserver * observer) noexcept {
+    observer_ = observer;
+  }
+
+  /// Returns true if the writer hashes the bytes while it writes them.
+  /// @return true if the writer hashes the bytes while it writes them.
+  bool compute_digests() const noexcept {
+    return compute_digests_;
+  }
+
+  /// Sets whether the writer hashes the bytes while it writes them.
+  ///
+  /// If enabled, each write computes the XXH64 hashes of the whole file,
+  /// the INFO, smpl and hydra chunks, and the data of each sample, and stores them to digests().
+  /// The bytes are hashed on their way to the output, so the file is never read back.
+  /// @param compute_digests true to hash the bytes.
+  /// @remarks SFFileWriteMode::kPositional writes sequentially while digests are computed,
+  /// since the hash of the whole file needs the bytes in order. The sample data in a file
+  /// passes through user space to be hashed. Update() does not compute digests.
+  void set_compute_digests(bool compute_digests) noexcept {
+    compute_digests_ = compute_digests;
+  }
+
+  /// Returns the hashes computed by the last write.
+  /// @return the hashes computed by the last write, if compute_digests() is true.
+  /// @remarks WriteAsync() computes the hashes on a copy of the writer, and does not update them.
+  const SFWriteDigests & digests() const noexcept {
+    return digests_;
+  }
+
+  /// Returns true if the writer writes reproducible output.
+  /// @return true if the writer writes reproducible output.
+  bool reproducible() const noexcept {
+    return reproducible_;
+  }
+
+  /// Sets whether the writer writes reproducible output.
+  ///
+  /// If enabled, a name or an INFO string is written up to its first null character,
+  /// and the rest of its field is filled with zeros, so that the characters after an embedded
+  /// null character, which a reader never sees, do not reach the output. The generators are
+  /// always written in canonical order, and the modulators of each zone in the order they were
+  /// added in, which a linked modulator refers to by index.
+  /// @param reproducible true to write reproducible output.
+  /// @remarks The INFO chunk is written as set. Leave the creation date empty,
+  /// or set it to a fixed value, to get the same bytes from one build to another.
+  void set_reproducible(bool reproducible) noexcept {
+    reproducible_ = reproducible;
+  }
+
+  /// Returns true if the identical sample data are written only once.
+  /// @return true if the identical sample data are written only once.
+  bool deduplicate_samples() const noexcept {
+    return deduplicate_samples_;
+  }
+
+  /// Sets whether the identical sample data are written only once.
+  ///
+  /// If enabled, the data points of a sample that are identical to the ones of a preceding sample
+  /// are not written to the sample pool. The sample header points to the data points of
+  /// the preceding sample instead, with its own loop points.
+  /// @param deduplicate_samples true to write the identical sample data only once.
+  /// @remarks The samples whose data are stored in a file are always written.
+  void set_deduplicate_samples(bool deduplicate_samples) noexcept {
+    deduplicate_samples_ = deduplicate_samples;
+  }
+
+  /// Returns the build cache used by Write().
+  /// @return the pointer to the build cache, or nullptr if every sample is serialized.
+  SFBuildCache * build_cache() const noexcept {
+    return build_cache_;
+  }
+
+  /// Sets the build cache used by Write().
+  ///
+  /// Write() copies the data of the samples found in the cache from the previous output
+  /// at the same file name, and then updates the cache with the places of the samples in the new file.
+  /// Save the cache with SFBuildCache::Save(), and load it for the next build with SFBuildCache::Load().
+  /// @param build_cache the pointer to the build cache, or nullptr to serialize every sample.
+  /// The build cache must outlive the writes.
+  /// @remarks The new output is written to a temporary file next to it (filename + ".tmp"),
+  /// which then replaces the previous output, so that a failed write keeps the previous output.
+  void set_build_cache(SFBuildCache * build_cache) noexcept {
+    build_cache_ = build_cache;
+  }
+
+  /// Returns the encoder that compresses the sample data.
+  /// @return the pointer to the encoder, or nullptr if the sample data are written uncompressed.
+  SFSampleEncoder * sample_encoder() const noexcept {
+    return sample_encoder_;
+  }
+
+  /// Sets the encoder that compresses the sample data.
+  ///
+  /// If set, the writer writes a SoundFont 3 (SF3) file: the "smpl" chunk holds the compressed data
+  /// of each sample, and each sample header points to the compressed data by byte offsets.
+  /// The samples are compressed on num_threads() threads before the file is written.
+  /// @param sample_encoder the pointer to the encoder, or nullptr to write the sample data uncompressed.
+  /// The encoder must outlive the writes.
+  /// @remarks The lower 8 bits of 24-bit sample data are not written, since SF3 has no "sm24" chunk.
+  /// build_cache() is not used while an encoder is set.
+  void set_sample_encoder(SFSampleEncoder * sample_encoder) noexcept {
+    sample_encoder_ = sample_encoder;
+  }
+
+  /// Returns the size of each buffer used by WriteAsync().
+  /// @return the size of each buffer, in terms of bytes.
+  OutputSink::size_type async_buffer_size() const noexcept {
+    return async_buffer_size_;
+  }
+
+  /// Sets the size of each buffer used by WriteAsync().
+  /// @param async_buffer_size the size of each buffer, in terms of bytes.
+  void set_async_buffer_size(OutputSink::size_type async_buffer_size) noexcept {
+    async_buffer_size_ = async_buffer_size;
+  }
+
+  /// Returns the number of buffers used by WriteAsync().
+  /// @return the number of buffers.
+  OutputSink::size_type num_async_buffers() const noexcept {
+    return num_async_buffers_;
+  }
+
+  /// Sets the number of buffers used by WriteAsync().
+  /// @param num_async_buffers the number of buffers. At least two buffers are used.
+  void set_num_async_buffers(OutputSink::size_type num_async_buffers) noexcept {
+    num_async_buffers_ = num_async_buffers;
+  }
+
+  /// Writes the SoundFont to a file.
+  /// @param filename the name of the file to write to.
+  /// @remarks The file is written as specified by file_write_mode() and sync_policy().
+  /// The cached sample data are copied from the previous output if build_cache() is set.
+  void Write(const std::string & filename);
+
+  /// Updates an existing SoundFont file in place, rewriting only its INFO and pdta chunks.
+  ///
+  /// The sdta chunk, which holds the sample data, is left untouched. Each rewritten chunk
+  /// is written at its old place if it fits there, and the space left over becomes a JUNK chunk.
+  /// Otherwise, the old place becomes a JUNK chunk, and the chunk is moved to the end of the file.
+  /// The last chunk of the file is always rewritten at its place, and the file is resized.
+  /// @param filename the name of the file to update.
+  /// @throws std::ios_base::failure An I/O error occurred, or the file is not a SoundFont file.
+  /// @remarks The samples must be the same as when the file was written, in the same order.
+  /// Only the size of the sample pool is checked: if it differs, the whole file is rewritten by Write().
+  /// The whole file is rewritten by Write() as well where the POSIX file I/O functions are not available.
+  /// The file is committed as specified by sync_policy().
+  void Update(const std::string & filename);
+
+  /// Writes the SoundFont to a file in the background.
+  ///
+  /// The SoundFont is serialized on a background thread into one buffer,
+  /// while a dedicated I/O thread writes the previous buffer to the file.
+  /// The settings of the writer are copied, so the writer can be reused or destructed meanwhile.
+  /// @param filename the name of the file to write to.
+  /// @return the future that becomes ready when the file is written.
+  /// It rethrows the structural errors and the I/O errors of the write.
+  /// @remarks The SoundFont and the observer must not be modified nor destructed
+  /// until the future becomes ready. The file is written as specified by sync_policy().
+  /// In the modes other than SFFileWriteMode::kBuffered, or if build_cache() is set,
+  /// the file is written by Write() on the background thread instead.
+  std::future<void> WriteAsync(const std::string & filename);
+
+  /// Writes the SoundFont to an output stream.
+  /// @param out the output stream to write to.
+  void Write(std::ostream & out);
+
+  /// @copydoc SoundFontWriter::Write(std::ostream &)
+  void Write(std::ostream && out);
+
+  /// Writes the SoundFont to an output sink.
+  /// @param out the output sink to write to.
+  void Write(OutputSink & out);
+
+  /// Returns the size of the serialized SoundFont.
+  /// @return the size of the SoundFont file, in terms of bytes.
+  OutputSink::size_type SerializedSize();
+
+  /// Serializes the SoundFont into memory.
+  /// @return the bytes of the SoundFont file.
+  /// @remarks The buffer is allocated once with the exact file size, and filled in a single pass.
+  std::vector<char> Serialize();
+
+  /// Serializes the SoundFont into a caller-supplied memory area.
+  /// @param data the pointer to the memory area.
+  /// @param capacity the size of the memory area, in terms of bytes.
+  /// @return the number of bytes written, that is, the size of the SoundFont file.
+  /// @throws std::length_error The memory area is too small. Nothing is written in that case.
+  OutputSink::size_type Serialize(void * data, OutputSink::size_type capacity);
+
+private:
+  /// Make the RIFF tree of the SoundFont.
+  /// @return the RIFF tree.
+  RIFF MakeRIFF();
+
+  /// Writes the SoundFont to a file through the double-buffered AsyncOutputSink.
+  /// @param filename the name of the file to write to.
+  void WriteDoubleBuffered(const std::string & filename);
+
+#ifdef SF2CUTE_HAS_POSIX_IO
+  /// Writes the SoundFont to a file, copying the cached sample data from the previous output.
+  /// @param filename the name of the file to write to.
+  void WriteWithBuildCache(const std::string & filename);
+
+  /// Returns true if the data of any sample is stored in the specified file.
+  /// @param filename the name of the file.
+  /// @return true if a sample has a file source that is the same file (device and inode number).
+  /// @throws std::ios_base::failure The file source of a sample could not be examined.
+  bool IsSampleSourceFile(const std::string & filename) const;
+
+  /// Writes the RIFF tree to a file through a memory mapping.
+  /// @param riff the RIFF tree.
+  /// @param fd the file descriptor opened for reading and writing.
+  void WriteMapped(const RIFF & riff, int fd);
+
+  /// Writes the RIFF tree to a file by writing each ranges at its offset concurrently.
+  /// @param riff the RIFF tree.
+  /// @param fd the file descriptor opened for writing.
+  void WritePositional(const RIFF & riff, int fd);
+
+  /// Commits a written file to the storage device as specified by sync_policy().
+  /// @param fd the file descriptor of the written file.
+  void SyncFile(int fd) const;
+#endif
+
+  /// Make an INFO chunk.
+  /// @return the INFO chunk.
+  std::unique_ptr<RIFFChunkInterface> MakeInfoListChunk();
+
+  /// Plans the hydra layout of the SoundFont, including the sample pool.
+  /// @return the hydra layout.
+  std::shared_ptr<const SFHydraLayout> MakeHydraLayout() const;
+
+  /// Compresses the sample data by sample_encoder().
+  /// @param layout the hydra layout.
+  /// @return the compressed sample pool, or nullptr if sample_encoder() is not set.
+  std::shared_ptr<const SFEncodedSamplePool> MakeEncodedSamplePool(
+      std::shared_ptr<const SFHydraLayout> layout) const;
+
+  /// Returns true if any sample has 24-bit sample data.
+  /// @return true if the sdta chunk has a sm24 chunk.
+  bool Has24BitSamples() const;
+
+  /// Make a sdta chunk.
+  /// @param layout the hydra layout.
+  /// @param encoded_samples the compressed sample pool, or nullptr to write the data points.
+  /// @return the sdta chunk.
+  std::unique_ptr<RIFFChunkInterface> MakeSdtaListChunk(std::shared_ptr<const SFHydraLayout> layout,
+      std::shared_ptr<const SFEncodedSamplePool> encoded_samples);
+
+  /// Make a pdta chunk.
+  /// @param layout the hydra layout.
+  /// @param encoded_samples the compressed sample pool, or nullptr if the data points are written.
+  /// @return the pdta chunk.
+  std::unique_ptr<RIFFChunkInterface> MakePdtaListChunk(std::shared_ptr<const SFHydraLayout> layout,
+      std::shared_ptr<const SFEncodedSamplePool> encoded_samples);
+
+  /// Wraps a chunk so that its writes are hashed and reported to the observer.
+  /// @param chunk the chunk.
+  /// @return the wrapped chunk, or the chunk itself if neither digests nor an observer are requested.
+  std::unique_ptr<RIFFChunkInterface> Observe(std::unique_ptr<RIFFChunkInterface> && chunk);
+
+  /// Writes the RIFF tree to an output sink, hashing the bytes if digests are computed.
+  /// @param riff the RIFF tree.
+  /// @param out the output sink to write to.
+  void WriteRIFF(const RIFF & riff, OutputSink & out);
+
+  /// Make a chunk with a version number.
+  /// @param name the name of the chunk.
+  /// @param version the version number.
+  static std::unique_ptr<RIFFChunkInterface> MakeVersionChunk(std::string name, SFVersionTag version);
+
+  /// Make a chunk with a string.
+  /// @param name the name of the chunk.
+  /// @param data the data string.
+  std::unique_ptr<RIFFChunkInterface> MakeZSTRChunk(std::string name, std::string data) const;
+
+  /// The input SoundFont object.
+  const SoundFont * file_;
+
+  /// How the writer writes a file.
+  SFFileWriteMode file_write_mode_;
+
+  /// How the writer commits a written file to the storage device.
+  SFSyncPolicy sync_policy_;
+
+  /// The number of threads used to serialize the hydra sub-chunks.
+  unsigned num_threads_;
+
+  /// The observer that the chunk writes are reported to.
+  SFWriteObserver * observer_;
+
+  /// True if the writer hashes the bytes while it writes them.
+  bool compute_digests_;
+
+  /// The hashes computed by the last write.
+  SFWriteDigests digests_;
+
+  /// True if the writer writes reproducible output.
+  bool reproducible_;
+
+  /// True if the identical sample data are written only once.
+  bool deduplicate_samples_;
+
+  /// The build cache used by Write().
+  SFBuildCache * build_cache_;
+
+  /// The encoder that compresses the sample data.
+  SFSampleEncoder * sample_encoder_;
+
+  /// The sources that override the data of the samples, with an element for each sample,
+  /// or an empty collection if every sample is written from itself.
+  std::vector<SFSampleFileSource> sample_sources_;
+
+  /// The size of each buffer used by WriteAsync().
+  OutputSink::size_type async_buffer_size_;
+
+  /// The number of buffers used by WriteAsync().
+  OutputSink::size_type num_async_buffers_;
+};
+
+} // namespace sf2cute
+
+#endif // SF2CUTE_FILE_WRITER_HPP_
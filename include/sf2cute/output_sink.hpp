@@ -0,0 +1,581 @@
+/// @file
+/// Output sink classes header.
+///
+/// The output sink classes are the byte destinations that the SoundFont writer serializes into.
+///
+/// @author gocha <https://github.com/gocha>
+
+#ifndef SF2CUTE_OUTPUT_SINK_HPP_
+#define SF2CUTE_OUTPUT_SINK_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <ios>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+/// Defined if the POSIX file I/O functions are available.
+#define SF2CUTE_HAS_POSIX_IO 1
+#endif
+
+namespace sf2cute {
+
+/// The OutputSink class represents an interface of byte destination.
+class OutputSink {
+public:
+  /// Unsigned integer type for the byte count.
+  using size_type = std::vector<char>::size_type;
+
+  /// Destructs the OutputSink.
+  virtual ~OutputSink() = default;
+
+  /// Writes a sequence of bytes.
+  /// @param data the pointer to the bytes to be written.
+  /// @param size the number of bytes to be written.
+  /// @throws std::ios_base::failure An I/O error occurred.
+  virtual void Write(const void * data, size_type size) = 0;
+
+  /// Writes a sequence of bytes read from a file.
+  /// @param fd the file descriptor opened for reading.
+  /// @param offset the file offset of the first byte to be written.
+  /// @param size the number of bytes to be written.
+  /// @throws std::ios_base::failure An I/O error occurred, or the file is too short.
+  /// @remarks The default implementation reads the file into a buffer, and writes the buffer.
+  /// It is not supported where the POSIX file I/O functions are not available.
+  virtual void WriteFromFile(int fd, uint64_t offset, size_type size);
+
+  /// Announces the number of bytes that will be written from now on.
+  /// @param size the number of bytes expected to be written.
+  /// @remarks The default implementation does nothing.
+  virtual void Reserve(size_type size);
+
+  /// Writes all buffered bytes to the underlying destination.
+  /// @throws std::ios_base::failure An I/O error occurred.
+  /// @remarks The default implementation does nothing.
+  virtual void Flush();
+
+  /// Returns the number of bytes written to this sink.
+  /// @return the number of bytes written to this sink.
+  virtual size_type position() const noexcept = 0;
+};
+
+/// The OStreamOutputSink class represents a byte destination backed by std::ostream.
+///
+/// @remarks The exception mask of the stream is set to badbit and failbit
+/// while the sink is alive, and restored when the sink is destructed.
+class OStreamOutputSink : public OutputSink {
+public:
+  /// Unsigned integer type for the byte count.
+  using size_type = OutputSink::size_type;
+
+  /// Constructs a new OStreamOutputSink using the specified output stream.
+  /// @param out the output stream.
+  explicit OStreamOutputSink(std::ostream & out);
+
+  /// OStreamOutputSink cannot be copied.
+  OStreamOutputSink(const OStreamOutputSink & origin) = delete;
+
+  /// OStreamOutputSink cannot be copied.
+  OStreamOutputSink & operator=(const OStreamOutputSink & origin) = delete;
+
+  /// Destructs the OStreamOutputSink, and restores the exception mask of the stream.
+  virtual ~OStreamOutputSink() override;
+
+  /// @copydoc OutputSink::Write()
+  virtual void Write(const void * data, size_type size) override;
+
+  /// @copydoc OutputSink::Flush()
+  virtual void Flush() override;
+
+  /// @copydoc OutputSink::position()
+  virtual size_type position() const noexcept override {
+    return position_;
+  }
+
+private:
+  /// The output stream.
+  std::ostream * out_;
+
+  /// The exception mask of the stream before the construction.
+  std::ios_base::iostate old_exception_bits_;
+
+  /// The number of bytes written to this sink.
+  size_type position_;
+};
+
+/// The MemoryOutputSink class represents a byte destination backed by a growable memory buffer.
+class MemoryOutputSink : public OutputSink {
+public:
+  /// Unsigned integer type for the byte count.
+  using size_type = OutputSink::size_type;
+
+  /// Constructs a new empty MemoryOutputSink.
+  MemoryOutputSink() = default;
+
+  /// Constructs a new copy of specified MemoryOutputSink.
+  /// @param origin a MemoryOutputSink object.
+  MemoryOutputSink(const MemoryOutputSink & origin) = default;
+
+  /// Copy-assigns a new value to the MemoryOutputSink, replacing its current contents.
+  /// @param origin a MemoryOutputSink object.
+  MemoryOutputSink & operator=(const MemoryOutputSink & origin) = default;
+
+  /// Acquires the contents of specified MemoryOutputSink.
+  /// @param origin a MemoryOutputSink object.
+  MemoryOutputSink(MemoryOutputSink && origin) = default;
+
+  /// Move-assigns a new value to the MemoryOutputSink, replacing its current contents.
+  /// @param origin a MemoryOutputSink object.
+  MemoryOutputSink & operator=(MemoryOutputSink && origin) = default;
+
+  /// Destructs the MemoryOutputSink.
+  virtual ~MemoryOutputSink() override = default;
+
+  /// @copydoc OutputSink::Write()
+  virtual void Write(const void * data, size_type size) override;
+
+  /// Reserves the memory buffer for the bytes that will be written from now on.
+  /// @param size the number of bytes expected to be written.
+  virtual void Reserve(size_type size) override {
+    data_.reserve(data_.size() + size);
+  }
+
+  /// @copydoc OutputSink::position()
+  virtual size_type position() const noexcept override {
+    return data_.size();
+  }
+
+  /// Returns the bytes written to this sink.
+  /// @return the bytes written to this sink.
+  const std::vector<char> & data() const noexcept {
+    return data_;
+  }
+
+  /// Moves the bytes out of this sink, and leaves the sink empty.
+  /// @return the bytes written to this sink.
+  std::vector<char> TakeData() noexcept {
+    std::vector<char> data(std::move(data_));
+    data_.clear();
+    return data;
+  }
+
+private:
+  /// The bytes written to this sink.
+  std::vector<char> data_;
+};
+
+/// The FixedBufferOutputSink class represents a byte destination backed by
+/// a caller-supplied memory area of fixed size.
+class FixedBufferOutputSink : public OutputSink {
+public:
+  /// Unsigned integer type for the byte count.
+  using size_type = OutputSink::size_type;
+
+  /// Constructs a new FixedBufferOutputSink using the specified memory area.
+  /// @param data the pointer to the memory area.
+  /// @param capacity the size of the memory area, in terms of bytes.
+  FixedBufferOutputSink(void * data, size_type capacity) noexcept :
+      data_(static_cast<char *>(data)),
+      capacity_(capacity),
+      position_(0) {
+  }
+
+  /// Constructs a new copy of specified FixedBufferOutputSink.
+  /// @param origin a FixedBufferOutputSink object.
+  FixedBufferOutputSink(const FixedBufferOutputSink & origin) = default;
+
+  /// Copy-assigns a new value to the FixedBufferOutputSink, replacing its current contents.
+  /// @param origin a FixedBufferOutputSink object.
+  FixedBufferOutputSink & operator=(const FixedBufferOutputSink & origin) = default;
+
+  /// Destructs the FixedBufferOutputSink.
+  virtual ~FixedBufferOutputSink() override = default;
+
+  /// Writes a sequence of bytes.
+  /// @param data the pointer to the bytes to be written.
+  /// @param size the number of bytes to be written.
+  /// @throws std::ios_base::failure The memory area is too small.
+  virtual void Write(const void * data, size_type size) override;
+
+  /// @copydoc OutputSink::position()
+  virtual size_type position() const noexcept override {
+    return position_;
+  }
+
+  /// Returns the size of the memory area.
+  /// @return the size of the memory area, in terms of bytes.
+  size_type capacity() const noexcept {
+    return capacity_;
+  }
+
+private:
+  /// The pointer to the memory area.
+  char * data_;
+
+  /// The size of the memory area.
+  size_type capacity_;
+
+  /// The number of bytes written to this sink.
+  size_type position_;
+};
+
+/// The AsyncOutputSink class represents a byte destination that passes the bytes
+/// to another sink on a dedicated I/O thread.
+///
+/// The sink fills one of its buffers while the I/O thread writes the full ones,
+/// so that the serialization overlaps with the output.
+/// @remarks An I/O error of the destination is rethrown by the next call to Write() or Flush().
+class AsyncOutputSink : public OutputSink {
+public:
+  /// Unsigned integer type for the byte count.
+  using size_type = OutputSink::size_type;
+
+  /// The default buffer size, in terms of bytes.
+  static constexpr size_type kDefaultBufferSize = 1024 * 1024;
+
+  /// The default number of buffers.
+  static constexpr size_type kDefaultNumBuffers = 2;
+
+  /// Constructs a new AsyncOutputSink, and starts its I/O thread.
+  /// @param out the destination sink. It must outlive this sink,
+  /// and must not be used by others until this sink is destructed.
+  /// @param buffer_size the size of each buffer, in terms of bytes.
+  /// @param num_buffers the number of buffers. At least two buffers are used.
+  explicit AsyncOutputSink(OutputSink & out,
+      size_type buffer_size = kDefaultBufferSize,
+      size_type num_buffers = kDefaultNumBuffers);
+
+  /// AsyncOutputSink cannot be copied.
+  AsyncOutputSink(const AsyncOutputSink & origin) = delete;
+
+  /// AsyncOutputSink cannot be copied.
+  AsyncOutputSink & operator=(const AsyncOutputSink & origin) = delete;
+
+  /// Destructs the AsyncOutputSink, writes the buffered bytes, and stops the I/O thread.
+  /// @remarks Errors are ignored. Call Flush() beforehand to get them.
+  virtual ~AsyncOutputSink() override;
+
+  /// @copydoc OutputSink::Write()
+  virtual void Write(const void * data, size_type size) override;
+
+  /// Waits until the I/O thread writes all buffered bytes, and flushes the destination sink.
+  /// @throws std::ios_base::failure An I/O error occurred.
+  virtual void Flush() override;
+
+  /// @copydoc OutputSink::position()
+  virtual size_type position() const noexcept override {
+    return position_;
+  }
+
+  /// Returns the size of each buffer.
+  /// @return the size of each buffer, in terms of bytes.
+  size_type buffer_size() const noexcept {
+    return buffer_size_;
+  }
+
+private:
+  /// Passes the current buffer to the I/O thread, and waits for a free buffer.
+  void SubmitBuffer();
+
+  /// Rethrows the error of the I/O thread, if any.
+  /// @param lock the lock of the mutex.
+  void RethrowError(std::unique_lock<std::mutex> & lock);
+
+  /// Writes the submitted buffers to the destination sink until the sink is stopped.
+  void Run();
+
+  /// The destination sink.
+  OutputSink * out_;
+
+  /// The size of each buffer.
+  size_type buffer_size_;
+
+  /// The buffer being filled.
+  std::vector<char> buffer_;
+
+  /// The number of bytes written to this sink.
+  size_type position_;
+
+  /// The mutex that guards the members below.
+  std::mutex mutex_;
+
+  /// The condition variable that signals the changes of the members below.
+  std::condition_variable condition_;
+
+  /// The buffers waiting for the I/O thread, in order.
+  std::deque<std::vector<char>> pending_buffers_;
+
+  /// The buffers that can be filled.
+  std::vector<std::vector<char>> free_buffers_;
+
+  /// True while the I/O thread is writing a buffer.
+  bool writing_;
+
+  /// True if the I/O thread must stop.
+  bool stopping_;
+
+  /// The error of the I/O thread.
+  std::exception_ptr error_;
+
+  /// The I/O thread.
+  std::thread thread_;
+};
+
+#ifdef SF2CUTE_HAS_POSIX_IO
+
+/// The FileDescriptorOutputSink class represents a byte destination backed by a POSIX file descriptor.
+///
+/// The sink collects small writes into its own buffer and passes large writes straight to write(2).
+/// @remarks The sink does not close the file descriptor.
+class FileDescriptorOutputSink : public OutputSink {
+public:
+  /// Unsigned integer type for the byte count.
+  using size_type = OutputSink::size_type;
+
+  /// The default buffer size, in terms of bytes.
+  static constexpr size_type kDefaultBufferSize = 1024 * 1024;
+
+  /// Constructs a new FileDescriptorOutputSink using the specified file descriptor.
+  /// @param fd the file descriptor opened for writing.
+  /// @param buffer_size the buffer size, in terms of bytes.
+  explicit FileDescriptorOutputSink(int fd,
+      size_type buffer_size = kDefaultBufferSize);
+
+  /// FileDescriptorOutputSink cannot be copied.
+  FileDescriptorOutputSink(const FileDescriptorOutputSink & origin) = delete;
+
+  /// FileDescriptorOutputSink cannot be copied.
+  FileDescriptorOutputSink & operator=(const FileDescriptorOutputSink & origin) = delete;
+
+  /// Destructs the FileDescriptorOutputSink, and writes the buffered bytes.
+  /// @remarks Errors are ignored. Call Flush() beforehand to get them.
+  virtual ~FileDescriptorOutputSink() override;
+
+  /// @copydoc OutputSink::Write()
+  virtual void Write(const void * data, size_type size) override;
+
+  /// Writes a sequence of bytes read from a file.
+  ///
+  /// The bytes are copied in the kernel (copy_file_range or sendfile) where possible,
+  /// without passing through user space. Otherwise they are copied through a buffer.
+  /// @param fd the file descriptor opened for reading.
+  /// @param offset the file offset of the first byte to be written.
+  /// @param size the number of bytes to be written.
+  /// @throws std::ios_base::failure An I/O error occurred, or the file is too short.
+  virtual void WriteFromFile(int fd, uint64_t offset, size_type size) override;
+
+  /// @copydoc OutputSink::Flush()
+  virtual void Flush() override;
+
+  /// @copydoc OutputSink::position()
+  virtual size_type position() const noexcept override {
+    return position_;
+  }
+
+  /// Returns the file descriptor.
+  /// @return the file descriptor.
+  int fd() const noexcept {
+    return fd_;
+  }
+
+private:
+  /// The file descriptor.
+  int fd_;
+
+  /// The buffer.
+  std::vector<char> buffer_;
+
+  /// The number of bytes stored in the buffer.
+  size_type buffer_length_;
+
+  /// The number of bytes written to this sink.
+  size_type position_;
+};
+
+/// The DirectFileOutputSink class represents a byte destination backed by a POSIX file descriptor
+/// opened for direct I/O (O_DIRECT), which bypasses the page cache.
+///
+/// The sink collects the bytes into a page-aligned buffer, and writes whole aligned blocks.
+/// The unaligned tail is written through the page cache by Flush().
+/// If the file system refuses an aligned direct write, the sink turns direct I/O off
+/// and goes on writing through the page cache.
+/// @remarks The sink does not close the file descriptor. The file offset must be aligned
+/// when the sink is constructed.
+class DirectFileOutputSink : public OutputSink {
+public:
+  /// Unsigned integer type for the byte count.
+  using size_type = OutputSink::size_type;
+
+  /// The alignment of the buffer, the file offsets and the write sizes, in terms of bytes.
+  static constexpr size_type kAlignment = 4096;
+
+  /// The default buffer size, in terms of bytes.
+  static constexpr size_type kDefaultBufferSize = 1024 * 1024;
+
+  /// Constructs a new DirectFileOutputSink using the specified file descriptor.
+  /// @param fd the file descriptor opened for writing, usually with O_DIRECT.
+  /// @param buffer_size the buffer size, in terms of bytes.
+  /// It is rounded up to a multiple of kAlignment.
+  explicit DirectFileOutputSink(int fd,
+      size_type buffer_size = kDefaultBufferSize);
+
+  /// DirectFileOutputSink cannot be copied.
+  DirectFileOutputSink(const DirectFileOutputSink & origin) = delete;
+
+  /// DirectFileOutputSink cannot be copied.
+  DirectFileOutputSink & operator=(const DirectFileOutputSink & origin) = delete;
+
+  /// Destructs the DirectFileOutputSink, and writes the buffered bytes.
+  /// @remarks Errors are ignored. Call Flush() beforehand to get them.
+  virtual ~DirectFileOutputSink() override;
+
+  /// @copydoc OutputSink::Write()
+  virtual void Write(const void * data, size_type size) override;
+
+  /// Writes all buffered bytes to the file.
+  ///
+  /// The aligned part is written directly, and the unaligned tail is written through the page cache.
+  /// Since the file offset is unaligned after that, the later bytes are written through the page cache too.
+  /// @throws std::ios_base::failure An I/O error occurred.
+  virtual void Flush() override;
+
+  /// @copydoc OutputSink::position()
+  virtual size_type position() const noexcept override {
+    return position_;
+  }
+
+  /// Returns the file descriptor.
+  /// @return the file descriptor.
+  int fd() const noexcept {
+    return fd_;
+  }
+
+  /// Returns true if the sink writes with direct I/O.
+  /// @return true if the sink writes with direct I/O.
+  bool is_direct() const noexcept {
+    return direct_;
+  }
+
+private:
+  /// Writes bytes to the file, falling back to the page cache if direct I/O is refused.
+  /// @param data the pointer to the bytes to be written.
+  /// @param size the number of bytes to be written.
+  void WriteBlock(const char * data, size_type size);
+
+  /// Turns direct I/O off for the file descriptor.
+  void DisableDirectIO();
+
+  /// The file descriptor.
+  int fd_;
+
+  /// True if the file descriptor is in direct I/O mode.
+  bool direct_;
+
+  /// The storage of the buffer, with room for the alignment.
+  std::vector<char> storage_;
+
+  /// The page-aligned buffer inside the storage.
+  char * buffer_;
+
+  /// The size of the buffer.
+  size_type buffer_size_;
+
+  /// The number of bytes stored in the buffer.
+  size_type buffer_length_;
+
+  /// The number of bytes written to this sink.
+  size_type position_;
+};
+
+/// The PositionalFileOutputSink class represents a byte destination that starts
+/// at a fixed offset of a POSIX file descriptor.
+///
+/// The sink writes with pwrite(2), so that several sinks can share a file descriptor
+/// and write different ranges of the file at the same time.
+/// @remarks The sink does not close the file descriptor, nor move its file offset.
+class PositionalFileOutputSink : public OutputSink {
+public:
+  /// Unsigned integer type for the byte count.
+  using size_type = OutputSink::size_type;
+
+  /// The default buffer size, in terms of bytes.
+  static constexpr size_type kDefaultBufferSize = 1024 * 1024;
+
+  /// Constructs a new PositionalFileOutputSink using the specified file descriptor.
+  /// @param fd the file descriptor opened for writing.
+  /// @param offset the absolute file offset of the first byte to be written.
+  /// @param buffer_size the buffer size, in terms of bytes.
+  PositionalFileOutputSink(int fd, uint64_t offset,
+      size_type buffer_size = kDefaultBufferSize);
+
+  /// PositionalFileOutputSink cannot be copied.
+  PositionalFileOutputSink(const PositionalFileOutputSink & origin) = delete;
+
+  /// PositionalFileOutputSink cannot be copied.
+  PositionalFileOutputSink & operator=(const PositionalFileOutputSink & origin) = delete;
+
+  /// Destructs the PositionalFileOutputSink, and writes the buffered bytes.
+  /// @remarks Errors are ignored. Call Flush() beforehand to get them.
+  virtual ~PositionalFileOutputSink() override;
+
+  /// @copydoc OutputSink::Write()
+  virtual void Write(const void * data, size_type size) override;
+
+  /// Writes a sequence of bytes read from a file.
+  ///
+  /// The bytes are copied in the kernel (copy_file_range or sendfile) where possible,
+  /// without passing through user space. Otherwise they are copied through a buffer.
+  /// @param fd the file descriptor opened for reading.
+  /// @param offset the file offset of the first byte to be written.
+  /// @param size the number of bytes to be written.
+  /// @throws std::ios_base::failure An I/O error occurred, or the file is too short.
+  virtual void WriteFromFile(int fd, uint64_t offset, size_type size) override;
+
+  /// @copydoc OutputSink::Flush()
+  virtual void Flush() override;
+
+  /// @copydoc OutputSink::position()
+  virtual size_type position() const noexcept override {
+    return position_;
+  }
+
+  /// Returns the file descriptor.
+  /// @return the file descriptor.
+  int fd() const noexcept {
+    return fd_;
+  }
+
+  /// Returns the absolute file offset of the first byte written to this sink.
+  /// @return the absolute file offset of the first byte written to this sink.
+  uint64_t offset() const noexcept {
+    return offset_;
+  }
+
+private:
+  /// The file descriptor.
+  int fd_;
+
+  /// The absolute file offset of the first byte written to this sink.
+  uint64_t offset_;
+
+  /// The buffer.
+  std::vector<char> buffer_;
+
+  /// The number of bytes stored in the buffer.
+  size_type buffer_length_;
+
+  /// The number of bytes written to this sink.
+  size_type position_;
+};
+
+#endif // SF2CUTE_HAS_POSIX_IO
+
+} // namespace sf2cute
+
+#endif // SF2CUTE_OUTPUT_SINK_HPP_
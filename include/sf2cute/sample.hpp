@@ -6,9 +6,12 @@
 #ifndef SF2CUTE_SAMPLE_HPP_
 #define SF2CUTE_SAMPLE_HPP_
 
+#include <stddef.h>
 #include <stdint.h>
 #include <algorithm>
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <utility>
 #include <vector>
 
@@ -20,12 +23,34 @@ class SFSample;
 class SoundFont;
 class SoundFontWriter;
 
+/// The SFSampleFileSource struct represents sample data stored in a file
+/// as raw little-endian 16-bit data points.
+///
+/// @remarks The file is read when the sample is written, or when its data is accessed.
+/// The file descriptor must stay open and unchanged until then, either by the caller
+/// or by the owner that the source holds.
+struct SFSampleFileSource {
+  /// The file descriptor opened for reading.
+  int fd;
+
+  /// The offset of the first data point in the file, in terms of bytes.
+  uint64_t offset;
+
+  /// The length of the data, in sample data points.
+  uint32_t length;
+
+  /// The object that keeps the file descriptor open, or nullptr if the caller keeps it open.
+  std::shared_ptr<const void> owner = nullptr;
+};
+
 /// The SFSample class represents a sample header and data.
 ///
 /// @remarks This class represents the official sfSample type and
-/// sample data stored in "smpl" chunk.
+/// sample data stored in "smpl" chunk, and "sm24" chunk for 24-bit sample data.
 /// @see "6.1 Sample Data Format in the smpl Sub-chunk".
 /// In SoundFont Technical Specification 2.04.
+/// @see "6.2 Sample Data Format in the sm24 Sub-chunk".
+/// In SoundFont Technical Specification 2.04.
 /// @see "7.10 The SHDR Sub-chunk".
 /// In SoundFont Technical Specification 2.04.
 class SFSample {
@@ -82,6 +107,22 @@ public:
       std::weak_ptr<SFSample> link,
       SFSampleLink type);
 
+  /// Constructs a new SFSample whose data is stored in a file.
+  /// @param name the name of the sample.
+  /// @param file_source the file that stores the sample data.
+  /// @param start_loop the beginning index of the loop, in sample data points, inclusive.
+  /// @param end_loop the ending index of the loop, in sample data points, exclusive.
+  /// @param sample_rate the sample rate, in hertz.
+  /// @param original_key the MIDI key number of the recorded pitch of the sample.
+  /// @param correction the pitch correction that should be applied to the sample, in cents.
+  SFSample(std::string name,
+      SFSampleFileSource file_source,
+      uint32_t start_loop,
+      uint32_t end_loop,
+      uint32_t sample_rate,
+      uint8_t original_key,
+      int8_t correction);
+
   /// Constructs a new copy of specified SFSample.
   /// @param origin a SFSample object.
   SFSample(const SFSample & origin);
@@ -92,11 +133,11 @@ public:
 
   /// Acquires the contents of specified SFSample.
   /// @param origin a SFSample object.
-  SFSample(SFSample && origin) = default;
+  SFSample(SFSample && origin) noexcept;
 
   /// Move-assigns a new value to the SFSample, replacing its current contents.
   /// @param origin a SFSample object.
-  SFSample & operator=(SFSample && origin) = default;
+  SFSample & operator=(SFSample && origin) noexcept;
 
   /// Destructs the SFSample.
   ~SFSample() = default;
@@ -220,10 +261,94 @@ public:
 
   /// Returns the sample data.
   /// @return the sample data.
-  const std::vector<int16_t> & data() const noexcept {
+  /// @throws std::ios_base::failure The data stored in a file could not be read.
+  /// @remarks The data stored in a file is read on the first access, and kept in memory
+  /// afterwards. It is read only once, even if several threads access it at the same time.
+  const std::vector<int16_t> & data() const {
+    if (has_file_source_ && !file_data_loaded_.load(std::memory_order_acquire)) {
+      LoadFileData();
+    }
     return data_;
   }
 
+  /// Returns the lower 8 bits of each 24-bit sample data point.
+  /// @return the lower 8 bits of each sample data point, or an empty collection for 16-bit sample data.
+  /// @remarks data() holds the upper 16 bits of each 24-bit sample data point.
+  const std::vector<uint8_t> & low_byte_data() const noexcept {
+    return low_byte_data_;
+  }
+
+  /// Returns true if the sample data has 24 bits per data point.
+  /// @return true if the sample data has 24 bits per data point.
+  bool has_24bit_data() const noexcept {
+    return !low_byte_data_.empty();
+  }
+
+  /// Sets 24-bit sample data stored in 32-bit integers.
+  ///
+  /// The data points are split into the upper 16 bits, stored to data(),
+  /// and the lower 8 bits, stored to low_byte_data(), in one pass.
+  /// @param data the sample data points, each of which must be within the signed 24-bit range.
+  void set_data24(const std::vector<int32_t> & data);
+
+  /// Sets packed 24-bit sample data.
+  ///
+  /// The data points are split into the upper 16 bits, stored to data(),
+  /// and the lower 8 bits, stored to low_byte_data(), in one pass.
+  /// @param data the pointer to the sample data points, each of which is 3 bytes long in little-endian order.
+  /// @param length the number of sample data points.
+  void set_packed_data24(const void * data, size_t length);
+
+  /// Discards the lower 8 bits of the 24-bit sample data, leaving the upper 16 bits.
+  void reset_low_byte_data() noexcept {
+    low_byte_data_.clear();
+    low_byte_data_.shrink_to_fit();
+  }
+
+  /// Returns the length of the sample data, wherever it is stored.
+  /// @return the length of the sample data, in sample data points.
+  std::vector<int16_t>::size_type data_length() const noexcept {
+    return has_file_source_ ? file_source_.length : data_.size();
+  }
+
+  /// Returns true if the sample data is stored in a file.
+  /// @return true if the sample data is stored in a file.
+  bool has_file_source() const noexcept {
+    return has_file_source_;
+  }
+
+  /// Returns the file that stores the sample data.
+  /// @return the file that stores the sample data.
+  /// @remarks The result is meaningful only if has_file_source() returns true.
+  const SFSampleFileSource & file_source() const noexcept {
+    return file_source_;
+  }
+
+  /// Returns true if the sample data stored in a file has been read into memory.
+  /// @return true if the sample data stored in a file has been read into memory.
+  bool has_loaded_file_data() const noexcept {
+    return has_file_source_ && file_data_loaded_.load(std::memory_order_acquire);
+  }
+
+  /// Sets the file that stores the sample data, and releases the sample data in memory.
+  /// @param file_source the file that stores the sample data.
+  void set_file_source(SFSampleFileSource file_source) {
+    file_source_ = std::move(file_source);
+    has_file_source_ = true;
+    file_data_loaded_.store(false, std::memory_order_release);
+    data_.clear();
+    data_.shrink_to_fit();
+    reset_low_byte_data();
+  }
+
+  /// Resets the file that stores the sample data. The sample data becomes empty.
+  void reset_file_source() noexcept {
+    file_source_ = SFSampleFileSource();
+    has_file_source_ = false;
+    data_.clear();
+    data_.shrink_to_fit();
+  }
+
   /// Returns true if this sample has a parent file.
   /// @return true if this sample has a parent file.
   bool has_parent_file() const noexcept {
@@ -248,6 +373,15 @@ private:
     parent_file_ = nullptr;
   }
 
+  /// Reads the sample data from the file that stores it, unless it has been read.
+  /// @throws std::ios_base::failure An I/O error occurred.
+  void LoadFileData() const;
+
+  /// Copies the sample data of another sample, if it is in memory.
+  /// @param origin the sample to copy the sample data from.
+  /// @remarks The lock of origin is held while the data stored in a file is copied.
+  void CopyDataFrom(const SFSample & origin);
+
   /// The name of sample.
   std::string name_;
 
@@ -272,8 +406,24 @@ private:
   /// Both the type of sample and the whether the sample is located in RAM or ROM memory.
   SFSampleLink type_;
 
-  /// The sample data.
-  std::vector<int16_t> data_;
+  /// The sample data, or the upper 16 bits of 24-bit sample data.
+  /// It is filled on the first access if the data is stored in a file.
+  mutable std::vector<int16_t> data_;
+
+  /// The lower 8 bits of 24-bit sample data.
+  std::vector<uint8_t> low_byte_data_;
+
+  /// The file that stores the sample data.
+  SFSampleFileSource file_source_;
+
+  /// True if the sample data is stored in a file.
+  bool has_file_source_;
+
+  /// True if the sample data stored in a file has been read into data_.
+  mutable std::atomic<bool> file_data_loaded_;
+
+  /// The mutex that lets only one thread read the sample data stored in a file.
+  mutable std::mutex file_data_mutex_;
 
   /// The parent file.
   SoundFont * parent_file_;
@@ -0,0 +1,51 @@
+/// @file
+/// SoundFont sample encoder interface header.
+///
+/// @author gocha <https://github.com/gocha>
+
+#ifndef SF2CUTE_SAMPLE_ENCODER_HPP_
+#define SF2CUTE_SAMPLE_ENCODER_HPP_
+
+#include <stdint.h>
+#include <vector>
+
+namespace sf2cute {
+
+class SFSample;
+
+/// The SFSampleEncoder class represents an interface that compresses sample data for SF3 files.
+///
+/// When SoundFontWriter has an encoder, it writes an SF3 file: the "smpl" chunk holds
+/// the compressed data of each sample, and each sample header points to it by byte offsets.
+/// @remarks The library does not bundle a codec. An implementation wraps one,
+/// typically an Ogg Vorbis encoder (libvorbisenc), since the players support it.
+/// @see https://github.com/FluidSynth/fluidsynth/wiki/SoundFont3Format
+class SFSampleEncoder {
+public:
+  /// The sample type flag of Ogg Vorbis compressed sample data.
+  static constexpr uint16_t kVorbisSampleType = 0x10;
+
+  /// Destructs the SFSampleEncoder.
+  virtual ~SFSampleEncoder() = default;
+
+  /// Returns the sample type flag of the compressed sample data.
+  /// @return the flag that is combined with the sample type of each sample header.
+  /// @remarks The default implementation returns kVorbisSampleType.
+  virtual uint16_t sample_type_flag() const noexcept {
+    return kVorbisSampleType;
+  }
+
+  /// Compresses the data of a sample.
+  /// @param sample the sample, which holds the sample rate and the other properties.
+  /// @param data the sample data points. They are read from the file if the sample data is stored in a file.
+  /// @return the compressed sample data.
+  /// @throws std::exception The sample data could not be compressed.
+  /// @remarks This function is called from the worker threads of SoundFontWriter concurrently,
+  /// when SoundFontWriter writes with more than one thread. An implementation must be thread-safe in that case.
+  /// The lower 8 bits of 24-bit sample data are available by SFSample::low_byte_data().
+  virtual std::vector<char> Encode(const SFSample & sample, const std::vector<int16_t> & data) = 0;
+};
+
+} // namespace sf2cute
+
+#endif // SF2CUTE_SAMPLE_ENCODER_HPP_
@@ -0,0 +1,49 @@
+/// @file
+/// SoundFont write digest structs header.
+///
+/// @author gocha <https://github.com/gocha>
+
+#ifndef SF2CUTE_WRITE_DIGEST_HPP_
+#define SF2CUTE_WRITE_DIGEST_HPP_
+
+#include <stdint.h>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace sf2cute {
+
+/// The SFContentDigest struct represents the XXH64 hash of a part of a written SoundFont.
+struct SFContentDigest {
+  /// The name of the part, such as a chunk name (FourCC) or a sample name.
+  std::string name;
+
+  /// The number of bytes hashed.
+  uint64_t size;
+
+  /// The XXH64 hash (seed 0) of the bytes.
+  uint64_t digest;
+};
+
+/// The SFWriteDigests struct represents the hashes computed while a SoundFont is written.
+struct SFWriteDigests {
+  /// The hash of the whole file.
+  SFContentDigest file;
+
+  /// The hashes of the chunks, including their chunk headers, in file order.
+  std::vector<SFContentDigest> chunks;
+
+  /// The hashes of the sample data points, excluding the terminator samples, in sample order.
+  std::vector<SFContentDigest> samples;
+
+  /// Writes the hashes as a text manifest.
+  ///
+  /// Each line has the hash algorithm, the hash in hexadecimal, the size,
+  /// the kind of the part ("file", "chunk" or "sample") and its name.
+  /// @param out the output stream to write to.
+  void WriteManifest(std::ostream & out) const;
+};
+
+} // namespace sf2cute
+
+#endif // SF2CUTE_WRITE_DIGEST_HPP_
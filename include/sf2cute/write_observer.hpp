@@ -0,0 +1,113 @@
+/// @file
+/// SoundFont write observer classes header.
+///
+/// @author gocha <https://github.com/gocha>
+
+#ifndef SF2CUTE_WRITE_OBSERVER_HPP_
+#define SF2CUTE_WRITE_OBSERVER_HPP_
+
+#include <stdint.h>
+#include <chrono>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace sf2cute {
+
+/// The SFChunkWriteStats struct represents the measurement of a chunk write.
+struct SFChunkWriteStats {
+  /// The name of the chunk (FourCC). The list type is used for a "LIST" chunk.
+  std::string name;
+
+  /// The number of bytes written, including the chunk header.
+  uint64_t bytes_written;
+
+  /// The number of items of the chunk, such as records or samples, or 0 if the chunk has no items.
+  uint64_t num_items;
+
+  /// The time taken to write the chunk, measured by the monotonic clock.
+  std::chrono::steady_clock::duration duration;
+};
+
+/// The SFWriteObserver class represents an interface that observes the chunk writes of SoundFontWriter.
+///
+/// @remarks The callbacks are called from the worker threads as well,
+/// when SoundFontWriter writes with more than one thread.
+/// An implementation must be thread-safe in that case.
+class SFWriteObserver {
+public:
+  /// Destructs the SFWriteObserver.
+  virtual ~SFWriteObserver() = default;
+
+  /// Called before a chunk is written.
+  /// @param name the name of the chunk (FourCC).
+  /// @param size the length of the chunk including the chunk header, in terms of bytes.
+  /// @param num_items the number of items of the chunk, or 0 if the chunk has no items.
+  /// @remarks The default implementation does nothing.
+  virtual void OnChunkBegin(const std::string & name, uint64_t size, uint64_t num_items);
+
+  /// Called after a chunk is written.
+  /// @param stats the measurement of the chunk write.
+  /// @remarks The default implementation does nothing.
+  virtual void OnChunkEnd(const SFChunkWriteStats & stats);
+};
+
+/// The SFWriteStatistics class represents a write observer that aggregates the measurements by chunk name.
+class SFWriteStatistics : public SFWriteObserver {
+public:
+  /// The SFWriteStatistics::Entry struct represents the aggregated measurements of a chunk name.
+  struct Entry {
+    /// The name of the chunk (FourCC).
+    std::string name;
+
+    /// The number of writes.
+    uint64_t count;
+
+    /// The total number of bytes written.
+    uint64_t bytes_written;
+
+    /// The total number of items written.
+    uint64_t num_items;
+
+    /// The total time taken.
+    std::chrono::steady_clock::duration duration;
+  };
+
+  /// Constructs a new empty SFWriteStatistics.
+  SFWriteStatistics() = default;
+
+  /// SFWriteStatistics cannot be copied.
+  SFWriteStatistics(const SFWriteStatistics & origin) = delete;
+
+  /// SFWriteStatistics cannot be copied.
+  SFWriteStatistics & operator=(const SFWriteStatistics & origin) = delete;
+
+  /// Destructs the SFWriteStatistics.
+  virtual ~SFWriteStatistics() override = default;
+
+  /// @copydoc SFWriteObserver::OnChunkEnd()
+  virtual void OnChunkEnd(const SFChunkWriteStats & stats) override;
+
+  /// Returns the aggregated measurements.
+  /// @return the aggregated measurements, in the order that each chunk name was first seen.
+  std::vector<Entry> entries() const;
+
+  /// Removes all the measurements.
+  void Clear();
+
+  /// Prints the aggregated measurements as a table.
+  /// @param out the output stream to print to.
+  void PrintSummary(std::ostream & out) const;
+
+private:
+  /// The mutex that guards the entries.
+  mutable std::mutex mutex_;
+
+  /// The aggregated measurements.
+  std::vector<Entry> entries_;
+};
+
+} // namespace sf2cute
+
+#endif // SF2CUTE_WRITE_OBSERVER_HPP_
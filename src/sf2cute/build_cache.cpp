@@ -0,0 +1,258 @@
+/// @file
+/// SoundFont build cache class implementation.
+///
+/// @author gocha <https://github.com/gocha>
+
+#include <sf2cute/build_cache.hpp>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <ios>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <sf2cute/output_sink.hpp>
+#include <sf2cute/sample.hpp>
+
+#include "byteio.hpp"
+#include "xxhash64.hpp"
+
+#ifdef SF2CUTE_HAS_POSIX_IO
+#include <sys/stat.h>
+
+#include "file_descriptor.hpp"
+#endif
+
+namespace sf2cute {
+
+namespace {
+
+/// The first line of an index file.
+constexpr const char * kIndexSignature = "sf2cute-build-cache 2";
+
+/// The first line of an index file of any version.
+constexpr const char * kIndexSignaturePrefix = "sf2cute-build-cache ";
+
+/// Throws std::ios_base::failure for a malformed index file.
+/// @param filename the name of the index file.
+/// @throws std::ios_base::failure always.
+[[noreturn]] void ThrowMalformedIndexError(const std::string & filename) {
+  std::ostringstream message_builder;
+  message_builder << "The build cache index \"" << filename << "\" is malformed.";
+  throw std::ios_base::failure(message_builder.str(), std::make_error_code(std::io_errc::stream));
+}
+
+#ifdef SF2CUTE_HAS_POSIX_IO
+/// Returns the modification time of a file.
+/// @param st the status of the file.
+/// @return the modification time, in nanoseconds since the epoch.
+int64_t GetModificationTime(const struct stat & st) noexcept {
+#if defined(__APPLE__)
+  return int64_t(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+  return int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+}
+#endif
+
+} // namespace
+
+/// Constructs a new empty SFBuildCache.
+SFBuildCache::SFBuildCache() :
+    file_size_(0),
+    file_mtime_(0),
+    num_copied_samples_(0),
+    num_serialized_samples_(0),
+    verify_data_(false) {
+}
+
+/// Removes all the entries, so that the next write serializes every sample.
+void SFBuildCache::Clear() {
+  filename_.clear();
+  file_size_ = 0;
+  file_mtime_ = 0;
+  entries_.clear();
+}
+
+/// Loads the index of a previous build.
+void SFBuildCache::Load(const std::string & filename) {
+  Clear();
+
+  std::ifstream in(filename);
+  if (!in.is_open()) {
+    // The first build has no index.
+    return;
+  }
+
+  std::string line;
+  if (!std::getline(in, line) || line.compare(0, strlen(kIndexSignaturePrefix), kIndexSignaturePrefix) != 0) {
+    ThrowMalformedIndexError(filename);
+  }
+  if (line != kIndexSignature) {
+    // The index of another version is ignored, and every sample is serialized once.
+    return;
+  }
+
+  // file <size> <modification time> <name>
+  std::string tag;
+  std::string output_filename;
+  if (!(in >> tag >> file_size_ >> file_mtime_) || tag != "file" ||
+      in.get() != ' ' || !std::getline(in, output_filename)) {
+    Clear();
+    ThrowMalformedIndexError(filename);
+  }
+
+  // sample <key> <check> <length> <offset>
+  uint64_t key;
+  Entry entry;
+  while (in >> tag >> std::hex >> key >> entry.check >> std::dec >> entry.length >> entry.offset) {
+    if (tag != "sample") {
+      Clear();
+      ThrowMalformedIndexError(filename);
+    }
+    entries_[key] = entry;
+  }
+  if (in.bad() || !in.eof()) {
+    Clear();
+    ThrowMalformedIndexError(filename);
+  }
+
+  filename_ = std::move(output_filename);
+}
+
+/// Saves the index of the last build.
+void SFBuildCache::Save(const std::string & filename) const {
+  // Write the index to a temporary file, and rename it over the previous index,
+  // so that a failed save leaves the previous index in place.
+  const std::string temporary_filename = filename + ".tmp";
+  std::ofstream out;
+  out.exceptions(std::ios::badbit | std::ios::failbit);
+  out.open(temporary_filename);
+
+  out << kIndexSignature << "\n";
+  out << "file " << file_size_ << " " << file_mtime_ << " " << filename_ << "\n";
+  for (const auto & entry : entries_) {
+    out << "sample " << std::hex << std::setfill('0') << std::setw(16) << entry.first
+      << " " << std::setw(16) << entry.second.check
+      << std::dec << " " << entry.second.length << " " << entry.second.offset << "\n";
+  }
+  out.close();
+
+  if (::rename(temporary_filename.c_str(), filename.c_str()) != 0) {
+    ::remove(temporary_filename.c_str());
+    throw std::ios_base::failure("Could not replace the index file \"" + filename + "\".",
+      std::make_error_code(std::io_errc::stream));
+  }
+}
+
+/// Returns the key of the data of a sample.
+uint64_t SFBuildCache::GetSampleKey(const SFSample & sample) {
+  return HashSample(sample).key;
+}
+
+/// Returns the hashes of the data of a sample, computed in one pass.
+SFBuildCache::SampleHash SFBuildCache::HashSample(const SFSample & sample) {
+  // Feed both hashes block by block, so that each block is read from the cache the second time.
+  constexpr size_t kBlockLength = 4096;
+  const std::vector<int16_t> & data = sample.data();
+  std::array<char, sizeof(int16_t) * kBlockLength> buffer;
+  XXH64 key_hash;
+  XXH64 check_hash(kCheckSeed);
+  for (size_t offset = 0; offset < data.size(); offset += kBlockLength) {
+    const size_t length = std::min(kBlockLength, data.size() - offset);
+    const char * bytes = reinterpret_cast<const char *>(&data[offset]);
+    if (!IsLittleEndianHost()) {
+      // Swap the bytes through a small buffer.
+      WriteInt16LArray(buffer.data(), &data[offset], length);
+      bytes = buffer.data();
+    }
+    key_hash.Update(bytes, length * sizeof(int16_t));
+    check_hash.Update(bytes, length * sizeof(int16_t));
+  }
+  return SampleHash{key_hash.Digest(), check_hash.Digest()};
+}
+
+/// Returns true if the entries refer to the specified file.
+bool SFBuildCache::Matches(const std::string & filename, int fd) const {
+#ifdef SF2CUTE_HAS_POSIX_IO
+  struct stat st;
+  if (filename_.empty() || filename != filename_ || ::fstat(fd, &st) != 0) {
+    return false;
+  }
+  return uint64_t(st.st_size) == file_size_ && GetModificationTime(st) == file_mtime_;
+#else
+  static_cast<void>(filename);
+  static_cast<void>(fd);
+  return false;
+#endif
+}
+
+/// Finds the place of a sample data in the previous output.
+const SFBuildCache::Entry * SFBuildCache::Find(const SampleHash & hash, uint32_t length) const {
+  const auto entry = entries_.find(hash.key);
+  if (entry == entries_.end() || entry->second.length != length || entry->second.check != hash.check) {
+    return nullptr;
+  }
+  return &entry->second;
+}
+
+/// Returns true if the data of a sample is stored at the place of an entry.
+bool SFBuildCache::HasSameData(int fd, const Entry & entry, const SFSample & sample) {
+  const std::vector<int16_t> & data = sample.data();
+  if (data.size() != entry.length) {
+    return false;
+  }
+
+#ifdef SF2CUTE_HAS_POSIX_IO
+  // Compare the data points block by block in the file byte order.
+  constexpr size_t kBlockLength = 32 * 1024;
+  std::vector<char> cached_bytes(sizeof(int16_t) * std::min(kBlockLength, data.size()));
+  std::vector<char> bytes(cached_bytes.size());
+  for (size_t offset = 0; offset < data.size(); offset += kBlockLength) {
+    const size_t length = std::min(kBlockLength, data.size() - offset);
+    PReadAll(fd, cached_bytes.data(), length * sizeof(int16_t),
+      entry.offset + sizeof(int16_t) * uint64_t(offset));
+    WriteInt16LArray(bytes.data(), &data[offset], length);
+    if (memcmp(cached_bytes.data(), bytes.data(), length * sizeof(int16_t)) != 0) {
+      return false;
+    }
+  }
+  return true;
+#else
+  static_cast<void>(fd);
+  return false;
+#endif
+}
+
+/// Replaces the entries with the places of the samples in a newly written file.
+void SFBuildCache::Reset(const std::string & filename,
+    const std::vector<uint64_t> & keys,
+    const std::vector<Entry> & entries) {
+  Clear();
+
+#ifdef SF2CUTE_HAS_POSIX_IO
+  struct stat st;
+  if (::stat(filename.c_str(), &st) != 0) {
+    ThrowSystemError("Could not examine the written file");
+  }
+
+  filename_ = filename;
+  file_size_ = uint64_t(st.st_size);
+  file_mtime_ = GetModificationTime(st);
+  for (size_t index = 0; index < keys.size(); index++) {
+    entries_[keys[index]] = entries[index];
+  }
+#else
+  static_cast<void>(keys);
+  static_cast<void>(entries);
+#endif
+}
+
+} // namespace sf2cute
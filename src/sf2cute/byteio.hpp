@@ -7,9 +7,18 @@
 #define SF2CUTE_BYTEIO_HPP_
 
 #include <stdint.h>
+#include <stddef.h>
+#include <iterator>
 
 namespace sf2cute {
 
+/// Returns true if the host stores integers in little-endian order.
+/// @return true if the host is a little-endian machine.
+inline bool IsLittleEndianHost() noexcept {
+  const uint16_t value = 1;
+  return *reinterpret_cast<const uint8_t *>(&value) == 1;
+}
+
 /// Writes an 8-bit integer.
 /// @param out the output iterator.
 /// @param value the number to be written.
@@ -63,6 +72,52 @@ OutputIterator WriteInt32L(OutputIterator out, uint32_t value) {
   return out;
 }
 
+/// Writes an array of 16-bit integers in little-endian order.
+/// @param out the pointer to the destination buffer, at least 2 * count bytes long.
+/// @param values the pointer to the numbers to be written.
+/// @param count the number of elements.
+///
+/// @remarks The loop body has no dependency between iterations,
+/// so that the compiler can turn it into a vectorized byte swap.
+inline void WriteInt16LArray(char * out, const int16_t * values, size_t count) noexcept {
+  for (size_t index = 0; index < count; index++) {
+    const uint16_t value = static_cast<uint16_t>(values[index]);
+    out[index * 2] = static_cast<char>(value & 0xff);
+    out[index * 2 + 1] = static_cast<char>((value >> 8) & 0xff);
+  }
+}
+
+/// Reads a 16-bit integer in little-endian order.
+/// @param in the pointer to the bytes to be read.
+/// @return the number read.
+inline uint16_t ReadInt16L(const char * in) noexcept {
+  return static_cast<uint16_t>(static_cast<uint8_t>(in[0]) |
+    (static_cast<uint8_t>(in[1]) << 8));
+}
+
+/// Reads an array of 16-bit integers in little-endian order.
+/// @param values the pointer to the destination numbers.
+/// @param in the pointer to the bytes to be read, at least 2 * count bytes long.
+/// @param count the number of elements.
+///
+/// @remarks The loop body has no dependency between iterations,
+/// so that the compiler can turn it into a vectorized byte swap.
+inline void ReadInt16LArray(int16_t * values, const char * in, size_t count) noexcept {
+  for (size_t index = 0; index < count; index++) {
+    values[index] = static_cast<int16_t>(ReadInt16L(&in[index * 2]));
+  }
+}
+
+/// Reads a 32-bit integer in little-endian order.
+/// @param in the pointer to the bytes to be read.
+/// @return the number read.
+inline uint32_t ReadInt32L(const char * in) noexcept {
+  return static_cast<uint32_t>(static_cast<uint8_t>(in[0])) |
+    (static_cast<uint32_t>(static_cast<uint8_t>(in[1])) << 8) |
+    (static_cast<uint32_t>(static_cast<uint8_t>(in[2])) << 16) |
+    (static_cast<uint32_t>(static_cast<uint8_t>(in[3])) << 24);
+}
+
 /// Writes an 8-bit integer.
 /// @param out the output destination object.
 /// @param value the number to be written.
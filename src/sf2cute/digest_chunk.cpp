@@ -0,0 +1,36 @@
+/// @file
+/// Digest RIFF chunk class implementation.
+///
+/// @author gocha <https://github.com/gocha>
+
+#include "digest_chunk.hpp"
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "hashing_output_sink.hpp"
+
+namespace sf2cute {
+
+/// Constructs a new DigestChunk.
+DigestChunk::DigestChunk(std::unique_ptr<RIFFChunkInterface> && chunk,
+    std::vector<SFContentDigest> & digests, size_t index) :
+    chunk_(std::move(chunk)),
+    digests_(&digests),
+    index_(index) {
+}
+
+/// Writes the decorated chunk, and stores the hash of the written bytes.
+void DigestChunk::Write(OutputSink & out) const {
+  HashingOutputSink hashing_out(out);
+  chunk_->Write(hashing_out);
+
+  // Each chunk has its own element, so that chunks written concurrently do not race.
+  SFContentDigest & digest = (*digests_)[index_];
+  digest.size = hashing_out.position();
+  digest.digest = hashing_out.digest();
+}
+
+} // namespace sf2cute
@@ -0,0 +1,77 @@
+/// @file
+/// Digest RIFF chunk class header.
+///
+/// @author gocha <https://github.com/gocha>
+
+#ifndef SF2CUTE_DIGEST_CHUNK_HPP_
+#define SF2CUTE_DIGEST_CHUNK_HPP_
+
+#include <stddef.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sf2cute/write_digest.hpp>
+
+#include "riff.hpp"
+
+namespace sf2cute {
+
+/// The DigestChunk class represents a RIFF chunk decorator that hashes
+/// the bytes of the decorated chunk while they are written.
+class DigestChunk : public RIFFChunkInterface {
+public:
+  /// Unsigned integer type for the chunk size.
+  using size_type = RIFFChunkInterface::size_type;
+
+  /// Constructs a new DigestChunk.
+  /// @param chunk the chunk to be decorated.
+  /// @param digests the collection that receives the hash. It must outlive this chunk.
+  /// @param index the index of the hash in the collection.
+  DigestChunk(std::unique_ptr<RIFFChunkInterface> && chunk,
+      std::vector<SFContentDigest> & digests, size_t index);
+
+  /// DigestChunk cannot be copied.
+  DigestChunk(const DigestChunk & origin) = delete;
+
+  /// DigestChunk cannot be copied.
+  DigestChunk & operator=(const DigestChunk & origin) = delete;
+
+  /// Destructs the DigestChunk.
+  virtual ~DigestChunk() override = default;
+
+  /// @copydoc RIFFChunkInterface::name()
+  virtual std::string name() const override {
+    return chunk_->name();
+  }
+
+  /// @copydoc RIFFChunkInterface::size()
+  virtual size_type size() const noexcept override {
+    return chunk_->size();
+  }
+
+  /// @copydoc RIFFChunkInterface::num_items()
+  virtual size_type num_items() const noexcept override {
+    return chunk_->num_items();
+  }
+
+  /// Writes the decorated chunk, and stores the hash of the written bytes.
+  /// @param out the output sink.
+  /// @throws std::length_error The chunk size exceeds the maximum.
+  /// @throws std::ios_base::failure An I/O error occurred.
+  virtual void Write(OutputSink & out) const override;
+
+private:
+  /// The decorated chunk.
+  std::unique_ptr<RIFFChunkInterface> chunk_;
+
+  /// The collection that receives the hash.
+  std::vector<SFContentDigest> * digests_;
+
+  /// The index of the hash in the collection.
+  size_t index_;
+};
+
+} // namespace sf2cute
+
+#endif // SF2CUTE_DIGEST_CHUNK_HPP_
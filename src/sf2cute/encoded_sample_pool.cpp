@@ -0,0 +1,80 @@
+/// @file
+/// SoundFont compressed sample pool class implementation.
+///
+/// @author gocha <https://github.com/gocha>
+
+#include "encoded_sample_pool.hpp"
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+#include <sstream>
+#include <stdexcept>
+
+#include <sf2cute/output_sink.hpp>
+#include <sf2cute/sample.hpp>
+#include <sf2cute/sample_encoder.hpp>
+
+#include "byteio.hpp"
+#include "parallel.hpp"
+
+namespace sf2cute {
+
+/// Compresses the samples of the specified hydra layout.
+SFEncodedSamplePool::SFEncodedSamplePool(std::shared_ptr<const SFHydraLayout> layout,
+    SFSampleEncoder & encoder, unsigned num_threads) :
+    layout_(std::move(layout)),
+    sample_data_(layout_->samples().size()),
+    sample_offsets_(layout_->samples().size()),
+    sample_end_offsets_(layout_->samples().size()),
+    sample_type_flag_(encoder.sample_type_flag()),
+    size_(0) {
+  // Compress the samples concurrently. Each sample is independent of the others.
+  const std::vector<uint16_t> & origin_indices = layout_->sample_origin_indices();
+  ParallelFor(samples().size(), num_threads, [&](size_t index) {
+    if (origin_indices[index] == index) {
+      const SFSample & sample = *samples()[index];
+      sample_data_[index] = sample.has_file_source() ?
+        encoder.Encode(sample, ReadSampleData(sample)) :
+        encoder.Encode(sample, sample.data());
+    }
+  });
+
+  // Place the compressed data in order. A shared sample follows its origin.
+  uint64_t offset = 0;
+  for (size_t index = 0; index < samples().size(); index++) {
+    const size_t origin_index = origin_indices[index];
+    if (origin_index != index) {
+      sample_offsets_[index] = sample_offsets_[origin_index];
+      sample_end_offsets_[index] = sample_end_offsets_[origin_index];
+      continue;
+    }
+
+    const uint64_t end_offset = offset + sample_data_[index].size();
+    if (end_offset > UINT32_MAX) {
+      std::ostringstream message_builder;
+      message_builder << "The compressed sample pool size exceeds the maximum at sample \""
+        << samples()[index]->name() << "\".";
+      throw std::length_error(message_builder.str());
+    }
+    sample_offsets_[index] = uint32_t(offset);
+    sample_end_offsets_[index] = uint32_t(end_offset);
+    offset = end_offset;
+  }
+  size_ = uint32_t(offset);
+}
+
+/// Reads the data points of a sample.
+std::vector<int16_t> SFEncodedSamplePool::ReadSampleData(const SFSample & sample) {
+  // The data in a file is in the file byte order.
+  const SFSampleFileSource & source = sample.file_source();
+  MemoryOutputSink bytes;
+  bytes.Reserve(sizeof(int16_t) * OutputSink::size_type(source.length));
+  bytes.WriteFromFile(source.fd, source.offset, sizeof(int16_t) * OutputSink::size_type(source.length));
+
+  std::vector<int16_t> data(source.length);
+  ReadInt16LArray(data.data(), bytes.data().data(), data.size());
+  return data;
+}
+
+} // namespace sf2cute
@@ -0,0 +1,112 @@
+/// @file
+/// SoundFont compressed sample pool class header.
+///
+/// @author gocha <https://github.com/gocha>
+
+#ifndef SF2CUTE_ENCODED_SAMPLE_POOL_HPP_
+#define SF2CUTE_ENCODED_SAMPLE_POOL_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+#include "hydra_layout.hpp"
+
+namespace sf2cute {
+
+class SFSample;
+class SFSampleEncoder;
+
+/// The SFEncodedSamplePool class represents the compressed sample data of an SF3 "smpl" chunk.
+///
+/// Every sample is compressed once, when the pool is constructed, so that the size of
+/// the "smpl" chunk and the byte offsets in the sample headers are known before any byte is written.
+class SFEncodedSamplePool {
+public:
+  /// Compresses the samples of the specified hydra layout.
+  ///
+  /// A sample that shares the data points of another sample (SFHydraLayout::sample_origin_indices())
+  /// is not compressed, and shares the compressed data of the other sample.
+  /// @param layout the hydra layout.
+  /// @param encoder the sample encoder.
+  /// @param num_threads the number of threads that compress the samples. 0 uses every hardware thread.
+  /// @throws std::length_error The sample pool size exceeds the maximum.
+  /// @throws std::ios_base::failure The sample data could not be read from a file.
+  /// @throws std::exception The encoder failed.
+  SFEncodedSamplePool(std::shared_ptr<const SFHydraLayout> layout,
+      SFSampleEncoder & encoder, unsigned num_threads);
+
+  /// Returns the samples of the pool.
+  /// @return the samples of the pool.
+  const std::vector<std::shared_ptr<SFSample>> & samples() const {
+    return layout_->samples();
+  }
+
+  /// Returns the hydra layout of the pool.
+  /// @return the hydra layout of the pool.
+  const SFHydraLayout & layout() const noexcept {
+    return *layout_;
+  }
+
+  /// Returns the compressed data of a sample.
+  /// @param index the index of the sample.
+  /// @return the compressed data, or an empty collection if the sample shares the data of another sample.
+  const std::vector<char> & sample_data(size_t index) const noexcept {
+    return sample_data_[index];
+  }
+
+  /// Returns the byte offset of the compressed data of each sample in the pool.
+  /// @return the byte offset of each sample. A sample that shares the data
+  /// of another sample has the offset of the other sample.
+  const std::vector<uint32_t> & sample_offsets() const noexcept {
+    return sample_offsets_;
+  }
+
+  /// Returns the byte offset next to the compressed data of each sample in the pool.
+  /// @return the byte offset next to the compressed data of each sample.
+  const std::vector<uint32_t> & sample_end_offsets() const noexcept {
+    return sample_end_offsets_;
+  }
+
+  /// Returns the sample type flag of the compressed data.
+  /// @return the flag that is combined with the sample type of each sample header.
+  uint16_t sample_type_flag() const noexcept {
+    return sample_type_flag_;
+  }
+
+  /// Returns the size of the pool.
+  /// @return the total size of the compressed data, in terms of bytes.
+  uint32_t size() const noexcept {
+    return size_;
+  }
+
+private:
+  /// Reads the data points of a sample.
+  /// @param sample the sample.
+  /// @return the data points of the sample.
+  /// @throws std::ios_base::failure The sample data could not be read from a file.
+  static std::vector<int16_t> ReadSampleData(const SFSample & sample);
+
+  /// The hydra layout of the pool.
+  std::shared_ptr<const SFHydraLayout> layout_;
+
+  /// The compressed data of each sample.
+  std::vector<std::vector<char>> sample_data_;
+
+  /// The byte offset of the compressed data of each sample.
+  std::vector<uint32_t> sample_offsets_;
+
+  /// The byte offset next to the compressed data of each sample.
+  std::vector<uint32_t> sample_end_offsets_;
+
+  /// The sample type flag of the compressed data.
+  uint16_t sample_type_flag_;
+
+  /// The total size of the compressed data.
+  uint32_t size_;
+};
+
+} // namespace sf2cute
+
+#endif // SF2CUTE_ENCODED_SAMPLE_POOL_HPP_
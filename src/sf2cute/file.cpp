@@ -10,6 +10,7 @@
 #include <stdexcept>
 #include <unordered_map>
 #include <fstream>
+#include <future>
 
 #include <sf2cute/sample.hpp>
 #include <sf2cute/generator_item.hpp>
@@ -18,8 +19,7 @@
 #include <sf2cute/instrument.hpp>
 #include <sf2cute/preset_zone.hpp>
 #include <sf2cute/preset.hpp>
-
-#include "file_writer.hpp"
+#include <sf2cute/file_writer.hpp>
 
 namespace sf2cute {
 
@@ -380,6 +380,12 @@ void SoundFont::Write(const std::string & filename) {
   writer.Write(filename);
 }
 
+/// Writes the SoundFont to a file in the background.
+std::future<void> SoundFont::WriteAsync(const std::string & filename) {
+  SoundFontWriter writer(*this);
+  return writer.WriteAsync(filename);
+}
+
 /// Writes the SoundFont to an output stream.
 void SoundFont::Write(std::ostream & out) {
   SoundFontWriter writer(*this);
@@ -391,6 +397,24 @@ void SoundFont::Write(std::ostream && out) {
   Write(out);
 }
 
+/// Writes the SoundFont to an output sink.
+void SoundFont::Write(OutputSink & out) {
+  SoundFontWriter writer(*this);
+  writer.Write(out);
+}
+
+/// Writes the SoundFont to a new memory buffer.
+std::vector<char> SoundFont::WriteToBuffer() {
+  SoundFontWriter writer(*this);
+  return writer.Serialize();
+}
+
+/// Writes the SoundFont to a caller-supplied memory area.
+std::vector<char>::size_type SoundFont::WriteToBuffer(void * data, std::vector<char>::size_type capacity) {
+  SoundFontWriter writer(*this);
+  return writer.Serialize(data, capacity);
+}
+
 /// Sets backward references of every children elements.
 void SoundFont::SetBackwardReferences() noexcept {
   // Set backward reference from presets to the file.
@@ -0,0 +1,228 @@
+/// @file
+/// POSIX file descriptor helper implementation.
+///
+/// @author gocha <https://github.com/gocha>
+
+#include "file_descriptor.hpp"
+
+#ifdef SF2CUTE_HAS_POSIX_IO
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+
+#include <ios>
+#include <string>
+#include <system_error>
+
+#if defined(__linux__) && defined(__GLIBC__) && \
+    (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 27))
+/// Defined if copy_file_range(2) is available.
+#define SF2CUTE_HAS_COPY_FILE_RANGE 1
+#endif
+
+namespace sf2cute {
+
+namespace {
+
+/// Returns true if the error means that the kernel cannot copy between the files.
+/// @param error_number the errno value.
+/// @return true if the caller should copy the bytes by itself.
+bool IsCopyUnsupportedError(int error_number) noexcept {
+  return error_number == EXDEV || error_number == EINVAL || error_number == ENOSYS ||
+    error_number == EOPNOTSUPP || error_number == EBADF;
+}
+
+} // namespace
+
+/// Constructs a new FileDescriptor that owns nothing.
+FileDescriptor::FileDescriptor() noexcept :
+    fd_(-1) {
+}
+
+/// Opens the specified file.
+FileDescriptor::FileDescriptor(const std::string & filename, int flags, int mode) {
+  do {
+    fd_ = ::open(filename.c_str(), flags, mode);
+  } while (fd_ == -1 && errno == EINTR);
+
+  if (fd_ == -1) {
+    ThrowSystemError("Could not open \"" + filename + "\"");
+  }
+}
+
+/// Acquires the file descriptor of specified FileDescriptor.
+FileDescriptor::FileDescriptor(FileDescriptor && origin) noexcept :
+    fd_(origin.fd_) {
+  origin.fd_ = -1;
+}
+
+/// Move-assigns a new value to the FileDescriptor, closing its current file.
+FileDescriptor & FileDescriptor::operator=(FileDescriptor && origin) noexcept {
+  if (this != &origin) {
+    if (fd_ != -1) {
+      ::close(fd_);
+    }
+    fd_ = origin.fd_;
+    origin.fd_ = -1;
+  }
+  return *this;
+}
+
+/// Destructs the FileDescriptor, and closes the file.
+FileDescriptor::~FileDescriptor() {
+  if (fd_ != -1) {
+    ::close(fd_);
+  }
+}
+
+/// Closes the file.
+void FileDescriptor::Close() {
+  if (fd_ != -1) {
+    const int fd = fd_;
+    fd_ = -1;
+    if (::close(fd) != 0 && errno != EINTR) {
+      ThrowSystemError("Could not close the file");
+    }
+  }
+}
+
+/// Opens the specified file for direct I/O (O_DIRECT), which bypasses the page cache.
+FileDescriptor OpenFileForDirectIO(const std::string & filename, int flags, int mode) {
+#ifdef O_DIRECT
+  try {
+    return FileDescriptor(filename, flags | O_DIRECT, mode);
+  }
+  catch (const std::ios_base::failure & e) {
+    // Some file systems, such as tmpfs, refuse O_DIRECT with EINVAL.
+    if (e.code() != std::errc::invalid_argument) {
+      throw;
+    }
+  }
+#endif
+  return FileDescriptor(filename, flags, mode);
+}
+
+/// Throws std::ios_base::failure for the current errno value.
+void ThrowSystemError(const std::string & what) {
+  const int error_number = errno;
+  throw std::ios_base::failure(what + ": " + ::strerror(error_number),
+    std::error_code(error_number, std::generic_category()));
+}
+
+/// Writes all bytes to a file descriptor, retrying partial writes.
+void WriteAll(int fd, const void * data, size_t size) {
+  const char * bytes = static_cast<const char *>(data);
+  while (size != 0) {
+    const ssize_t written = ::write(fd, bytes, size);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      ThrowSystemError("Could not write to the file");
+    }
+    bytes += written;
+    size -= size_t(written);
+  }
+}
+
+/// Writes all bytes to a file descriptor at the specified offset, retrying partial writes.
+void PWriteAll(int fd, const void * data, size_t size, uint64_t offset) {
+  const char * bytes = static_cast<const char *>(data);
+  while (size != 0) {
+    const ssize_t written = ::pwrite(fd, bytes, size, off_t(offset));
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      ThrowSystemError("Could not write to the file");
+    }
+    bytes += written;
+    size -= size_t(written);
+    offset += uint64_t(written);
+  }
+}
+
+/// Copies bytes from a file to another in the kernel, without passing them through user space.
+size_t CopyFileData(int in_fd, uint64_t in_offset, int out_fd, const uint64_t * out_offset, size_t size) {
+  size_t copied = 0;
+
+#ifdef SF2CUTE_HAS_COPY_FILE_RANGE
+  while (copied < size) {
+    loff_t in_position = loff_t(in_offset + copied);
+    loff_t out_position = out_offset != nullptr ? loff_t(*out_offset + copied) : 0;
+    const ssize_t result = ::copy_file_range(in_fd, &in_position,
+      out_fd, out_offset != nullptr ? &out_position : nullptr, size - copied, 0);
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (IsCopyUnsupportedError(errno)) {
+        break;
+      }
+      ThrowSystemError("Could not copy the file data");
+    }
+    if (result == 0) {
+      return copied;
+    }
+    copied += size_t(result);
+  }
+#endif
+
+#ifdef __linux__
+  // sendfile(2) always writes at the current file offset.
+  while (out_offset == nullptr && copied < size) {
+    off_t in_position = off_t(in_offset + copied);
+    const ssize_t result = ::sendfile(out_fd, in_fd, &in_position, size - copied);
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (IsCopyUnsupportedError(errno)) {
+        break;
+      }
+      ThrowSystemError("Could not copy the file data");
+    }
+    if (result == 0) {
+      return copied;
+    }
+    copied += size_t(result);
+  }
+#endif
+
+  static_cast<void>(in_fd);
+  static_cast<void>(in_offset);
+  static_cast<void>(out_fd);
+  return copied;
+}
+
+/// Reads exactly the specified number of bytes from a file descriptor at the specified offset.
+void PReadAll(int fd, void * data, size_t size, uint64_t offset) {
+  char * bytes = static_cast<char *>(data);
+  while (size != 0) {
+    const ssize_t read_size = ::pread(fd, bytes, size, off_t(offset));
+    if (read_size < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      ThrowSystemError("Could not read from the file");
+    }
+    if (read_size == 0) {
+      throw std::ios_base::failure("Unexpected end of file.",
+        std::make_error_code(std::io_errc::stream));
+    }
+    bytes += read_size;
+    size -= size_t(read_size);
+    offset += uint64_t(read_size);
+  }
+}
+
+} // namespace sf2cute
+
+#endif // SF2CUTE_HAS_POSIX_IO
@@ -0,0 +1,125 @@
+/// @file
+/// POSIX file descriptor helper header.
+///
+/// @author gocha <https://github.com/gocha>
+
+#ifndef SF2CUTE_FILE_DESCRIPTOR_HPP_
+#define SF2CUTE_FILE_DESCRIPTOR_HPP_
+
+#include <sf2cute/output_sink.hpp>
+
+#ifdef SF2CUTE_HAS_POSIX_IO
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+
+namespace sf2cute {
+
+/// The FileDescriptor class owns a POSIX file descriptor.
+class FileDescriptor {
+public:
+  /// Constructs a new FileDescriptor that owns nothing.
+  FileDescriptor() noexcept;
+
+  /// Opens the specified file.
+  /// @param filename the name of the file.
+  /// @param flags the flags passed to open(2).
+  /// @param mode the permission bits used when the file is created.
+  /// @throws std::ios_base::failure The file could not be opened.
+  FileDescriptor(const std::string & filename, int flags, int mode = 0666);
+
+  /// FileDescriptor cannot be copied.
+  FileDescriptor(const FileDescriptor & origin) = delete;
+
+  /// FileDescriptor cannot be copied.
+  FileDescriptor & operator=(const FileDescriptor & origin) = delete;
+
+  /// Acquires the file descriptor of specified FileDescriptor.
+  /// @param origin a FileDescriptor object.
+  FileDescriptor(FileDescriptor && origin) noexcept;
+
+  /// Move-assigns a new value to the FileDescriptor, closing its current file.
+  /// @param origin a FileDescriptor object.
+  FileDescriptor & operator=(FileDescriptor && origin) noexcept;
+
+  /// Destructs the FileDescriptor, and closes the file. Errors are ignored.
+  ~FileDescriptor();
+
+  /// Returns the file descriptor.
+  /// @return the file descriptor, or -1 if nothing is owned.
+  int get() const noexcept {
+    return fd_;
+  }
+
+  /// Returns true if a file is owned.
+  /// @return true if a file is owned.
+  bool is_open() const noexcept {
+    return fd_ != -1;
+  }
+
+  /// Closes the file.
+  /// @throws std::ios_base::failure An I/O error occurred.
+  void Close();
+
+private:
+  /// The file descriptor.
+  int fd_;
+};
+
+/// Opens the specified file for direct I/O (O_DIRECT), which bypasses the page cache.
+/// @param filename the name of the file.
+/// @param flags the flags passed to open(2), besides O_DIRECT.
+/// @param mode the permission bits used when the file is created.
+/// @return the opened file. It is opened without O_DIRECT
+/// if the platform or the file system does not support direct I/O.
+/// @throws std::ios_base::failure The file could not be opened.
+FileDescriptor OpenFileForDirectIO(const std::string & filename, int flags, int mode = 0666);
+
+/// Throws std::ios_base::failure for the current errno value.
+/// @param what the description of the failed operation.
+/// @throws std::ios_base::failure always.
+[[noreturn]] void ThrowSystemError(const std::string & what);
+
+/// Writes all bytes to a file descriptor, retrying partial writes.
+/// @param fd the file descriptor.
+/// @param data the pointer to the bytes to be written.
+/// @param size the number of bytes to be written.
+/// @throws std::ios_base::failure An I/O error occurred.
+void WriteAll(int fd, const void * data, size_t size);
+
+/// Writes all bytes to a file descriptor at the specified offset, retrying partial writes.
+/// @param fd the file descriptor.
+/// @param data the pointer to the bytes to be written.
+/// @param size the number of bytes to be written.
+/// @param offset the file offset to write to.
+/// @throws std::ios_base::failure An I/O error occurred.
+void PWriteAll(int fd, const void * data, size_t size, uint64_t offset);
+
+/// Copies bytes from a file to another in the kernel, without passing them through user space.
+///
+/// The copy uses copy_file_range(2), or sendfile(2) if out_offset is nullptr.
+/// @param in_fd the file descriptor to read from.
+/// @param in_offset the file offset to read from.
+/// @param out_fd the file descriptor to write to.
+/// @param out_offset the pointer to the file offset to write to,
+/// or nullptr to write at the current file offset of out_fd and advance it.
+/// @param size the number of bytes to be copied.
+/// @return the number of bytes copied. It is less than size if the kernel cannot copy
+/// between the files or the input file ends, and the caller must copy the rest by itself.
+/// @throws std::ios_base::failure An I/O error occurred.
+size_t CopyFileData(int in_fd, uint64_t in_offset, int out_fd, const uint64_t * out_offset, size_t size);
+
+/// Reads exactly the specified number of bytes from a file descriptor at the specified offset.
+/// @param fd the file descriptor.
+/// @param data the pointer to the destination buffer.
+/// @param size the number of bytes to be read.
+/// @param offset the file offset to read from.
+/// @throws std::ios_base::failure An I/O error occurred, or the file is too short.
+void PReadAll(int fd, void * data, size_t size, uint64_t offset);
+
+} // namespace sf2cute
+
+#endif // SF2CUTE_HAS_POSIX_IO
+
+#endif // SF2CUTE_FILE_DESCRIPTOR_HPP_
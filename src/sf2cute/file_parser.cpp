@@ -0,0 +1,552 @@
+/// @file
+/// SoundFont 2 File parser classes implementation.
+///
+/// @author gocha <https://github.com/gocha>
+
+#include <sf2cute/file_parser.hpp>
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+
+#include <sf2cute/generator_item.hpp>
+#include <sf2cute/modulator_item.hpp>
+#include <sf2cute/output_sink.hpp>
+
+#ifdef SF2CUTE_HAS_POSIX_IO
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+#include "byteio.hpp"
+#include "file_descriptor.hpp"
+#include "memory_mapped_file.hpp"
+#include "packed_record.hpp"
+
+namespace sf2cute {
+
+namespace {
+
+/// Throws std::ios_base::failure for a malformed SoundFont file.
+/// @param what the description of the problem.
+/// @throws std::ios_base::failure always.
+[[noreturn]] void ThrowInvalidFileError(const std::string & what) {
+  throw std::ios_base::failure(what, std::make_error_code(std::io_errc::stream));
+}
+
+/// The SFParseInput class represents the bytes that the parser reads forward.
+class SFParseInput {
+public:
+  /// The maximum number of bytes that can be read at once.
+  static constexpr size_t kMaxReadSize = 64 * 1024;
+
+  /// Constructs a new SFParseInput.
+  SFParseInput() noexcept :
+      position_(0) {
+  }
+
+  /// Destructs the SFParseInput.
+  virtual ~SFParseInput() = default;
+
+  /// Reads the next bytes.
+  /// @param size the number of bytes to be read, up to kMaxReadSize.
+  /// @return the pointer to the bytes, which is valid until the next call.
+  /// @throws std::ios_base::failure An I/O error occurred, or the input is too short.
+  virtual const char * Read(size_t size) = 0;
+
+  /// Skips the next bytes.
+  /// @param size the number of bytes to be skipped.
+  /// @throws std::ios_base::failure An I/O error occurred, or the input is too short.
+  virtual void Skip(uint64_t size) = 0;
+
+  /// Returns the number of bytes read or skipped so far.
+  /// @return the offset of the next byte from the beginning of the input.
+  uint64_t position() const noexcept {
+    return position_;
+  }
+
+protected:
+  /// The offset of the next byte from the beginning of the input.
+  uint64_t position_;
+};
+
+/// The SFMemoryParseInput class represents the bytes in memory that the parser reads forward.
+class SFMemoryParseInput : public SFParseInput {
+public:
+  /// Constructs a new SFMemoryParseInput.
+  /// @param data the pointer to the bytes.
+  /// @param size the number of bytes.
+  SFMemoryParseInput(const char * data, size_t size) noexcept :
+      data_(data),
+      size_(size) {
+  }
+
+  /// @copydoc SFParseInput::Read()
+  virtual const char * Read(size_t size) override {
+    Skip(size);
+    return &data_[position_ - size];
+  }
+
+  /// @copydoc SFParseInput::Skip()
+  virtual void Skip(uint64_t size) override {
+    if (size > size_ - position_) {
+      ThrowInvalidFileError("The file is truncated.");
+    }
+    position_ += size;
+  }
+
+private:
+  /// The pointer to the bytes.
+  const char * data_;
+
+  /// The number of bytes.
+  uint64_t size_;
+};
+
+/// The SFStreamParseInput class represents an input stream that the parser reads forward through a buffer.
+class SFStreamParseInput : public SFParseInput {
+public:
+  /// Constructs a new SFStreamParseInput.
+  /// @param in the input stream. Its exceptions are masked until the SFStreamParseInput is destructed.
+  explicit SFStreamParseInput(std::istream & in) :
+      in_(&in),
+      old_exception_bits_(in.exceptions()),
+      buffer_(kMaxReadSize),
+      buffer_begin_(0),
+      buffer_end_(0) {
+    // The end of the stream is detected by the number of bytes read.
+    in.exceptions(std::ios::goodbit);
+  }
+
+  /// Destructs the SFStreamParseInput, and restores the exception mask of the stream.
+  virtual ~SFStreamParseInput() override {
+    try {
+      in_->exceptions(old_exception_bits_);
+    }
+    catch (const std::exception &) {
+      // The stream has reached its end, or the caller has got the exception from Read() or Skip().
+    }
+  }
+
+  /// @copydoc SFParseInput::Read()
+  virtual const char * Read(size_t size) override {
+    if (buffer_end_ - buffer_begin_ < size) {
+      // Move the rest of the buffer to the front, and fill the buffer.
+      memmove(buffer_.data(), &buffer_[buffer_begin_], buffer_end_ - buffer_begin_);
+      buffer_end_ -= buffer_begin_;
+      buffer_begin_ = 0;
+      in_->read(&buffer_[buffer_end_], std::streamsize(buffer_.size() - buffer_end_));
+      buffer_end_ += size_t(in_->gcount());
+      CheckStream();
+      if (buffer_end_ < size) {
+        ThrowInvalidFileError("The file is truncated.");
+      }
+    }
+
+    const char * data = &buffer_[buffer_begin_];
+    buffer_begin_ += size;
+    position_ += size;
+    return data;
+  }
+
+  /// @copydoc SFParseInput::Skip()
+  virtual void Skip(uint64_t size) override {
+    // Skip the buffered bytes first.
+    const size_t buffered_size = size_t(std::min<uint64_t>(size, buffer_end_ - buffer_begin_));
+    buffer_begin_ += buffered_size;
+    position_ += buffered_size;
+    size -= buffered_size;
+    if (size == 0) {
+      return;
+    }
+
+    // Seek over the rest, or read through it if the stream cannot seek.
+    if (!in_->seekg(std::streamoff(size), std::ios::cur)) {
+      in_->clear(in_->rdstate() & std::ios::badbit);
+      for (uint64_t rest = size; rest != 0; ) {
+        const std::streamsize length = std::streamsize(std::min<uint64_t>(rest, buffer_.size()));
+        in_->read(buffer_.data(), length);
+        CheckStream();
+        if (in_->gcount() != length) {
+          ThrowInvalidFileError("The file is truncated.");
+        }
+        rest -= uint64_t(length);
+      }
+    }
+    position_ += size;
+  }
+
+private:
+  /// Throws std::ios_base::failure if the stream has an I/O error.
+  /// @throws std::ios_base::failure The stream has an I/O error.
+  void CheckStream() const {
+    if (in_->bad()) {
+      throw std::ios_base::failure("Could not read the stream.", std::make_error_code(std::io_errc::stream));
+    }
+  }
+
+  /// The input stream.
+  std::istream * in_;
+
+  /// The exception mask of the input stream before parsing.
+  std::ios::iostate old_exception_bits_;
+
+  /// The buffer of the bytes read ahead.
+  std::vector<char> buffer_;
+
+  /// The index of the first unread byte in the buffer.
+  size_t buffer_begin_;
+
+  /// The index next to the last byte in the buffer.
+  size_t buffer_end_;
+};
+
+/// The RIFFChunkHeader struct represents the header of a chunk that the parser has read.
+struct RIFFChunkHeader {
+  /// The name of the chunk (FourCC).
+  std::string name;
+
+  /// The length of the chunk data, in terms of bytes.
+  uint32_t size;
+};
+
+/// Reads the header of the next chunk within a parent chunk.
+/// @param in the input.
+/// @param rest the number of bytes left in the parent chunk. The header is subtracted from it.
+/// @param header the header of the chunk, as output.
+/// @return true if a chunk is read, false if the parent chunk has no more chunks.
+/// @throws std::ios_base::failure The chunk is truncated.
+bool ReadChunkHeader(SFParseInput & in, uint64_t & rest, RIFFChunkHeader & header) {
+  if (rest < 8) {
+    in.Skip(rest);
+    rest = 0;
+    return false;
+  }
+
+  const char * data = in.Read(8);
+  header.name.assign(data, 4);
+  header.size = ReadInt32L(&data[4]);
+  rest -= 8;
+  if (header.size > rest) {
+    ThrowInvalidFileError("The file has a truncated chunk.");
+  }
+  return true;
+}
+
+/// Skips the padding byte after a chunk. The padding byte of the last chunk may be missing.
+/// @param in the input.
+/// @param size the length of the chunk data, in terms of bytes.
+/// @param rest the number of bytes left in the parent chunk. The padding byte is subtracted from it.
+void SkipChunkPadding(SFParseInput & in, uint32_t size, uint64_t & rest) {
+  if (size % 2 != 0 && rest != 0) {
+    in.Skip(1);
+    rest--;
+  }
+}
+
+/// Parses the sub-chunks of "INFO" chunk.
+/// @param in the input.
+/// @param size the length of the chunk data excluding the list type, in terms of bytes.
+/// @param handler the handler that receives the records.
+void ParseInfoList(SFParseInput & in, uint64_t size, SFParseHandler & handler) {
+  const size_t max_text_length = SoundFontParser::kMaxInfoTextLength;
+  RIFFChunkHeader header;
+  std::string text;
+  while (ReadChunkHeader(in, size, header)) {
+    if (header.name == "ifil" || header.name == "iver") {
+      if (header.size < 4) {
+        std::ostringstream message_builder;
+        message_builder << "The " << header.name << " chunk is too short.";
+        ThrowInvalidFileError(message_builder.str());
+      }
+      const char * data = in.Read(4);
+      handler.OnVersion(header.name, SFVersionTag(ReadInt16L(&data[0]), ReadInt16L(&data[2])));
+      in.Skip(header.size - 4);
+    }
+    else {
+      // The string ends at the first null character, and is truncated to the limit.
+      const size_t length = std::min<size_t>(header.size, max_text_length);
+      const char * data = in.Read(length);
+      text.assign(data, std::find(data, data + length, '\0'));
+      handler.OnInfo(header.name, text);
+      in.Skip(header.size - length);
+    }
+    size -= header.size;
+    SkipChunkPadding(in, header.size, size);
+  }
+}
+
+/// Parses the sub-chunks of "sdta" chunk. The sample data is skipped.
+/// @param in the input.
+/// @param size the length of the chunk data excluding the list type, in terms of bytes.
+/// @param handler the handler that receives the records.
+void ParseSdtaList(SFParseInput & in, uint64_t size, SFParseHandler & handler) {
+  RIFFChunkHeader header;
+  while (ReadChunkHeader(in, size, header)) {
+    handler.OnSampleData(header.name, in.position(), header.size);
+    in.Skip(header.size);
+    size -= header.size;
+    SkipChunkPadding(in, header.size, size);
+  }
+}
+
+/// Parses the records of a hydra chunk.
+/// @param in the input.
+/// @param header the header of the chunk.
+/// @param record_size the size of each record, in terms of bytes.
+/// @param on_record the function that is called with the index and the bytes of each record.
+/// @throws std::ios_base::failure The chunk size is not a multiple of the record size.
+template <typename Function>
+void ParseRecords(SFParseInput & in, const RIFFChunkHeader & header, size_t record_size, Function on_record) {
+  if (header.size % record_size != 0) {
+    std::ostringstream message_builder;
+    message_builder << "The " << header.name << " chunk has an invalid size (" << header.size << " bytes).";
+    ThrowInvalidFileError(message_builder.str());
+  }
+
+  const size_t num_records = header.size / record_size;
+  for (size_t index = 0; index < num_records; index++) {
+    on_record(index, in.Read(record_size));
+  }
+}
+
+/// Parses the sub-chunks of "pdta" chunk.
+/// @param in the input.
+/// @param size the length of the chunk data excluding the list type, in terms of bytes.
+/// @param handler the handler that receives the records.
+void ParsePdtaList(SFParseInput & in, uint64_t size, SFParseHandler & handler) {
+  // The records are decoded into the same objects, so that their strings are allocated only once.
+  SFParsedPresetHeader preset_header{};
+  SFParsedInstrument instrument{};
+  SFParsedSampleHeader sample_header{};
+
+  RIFFChunkHeader header;
+  while (ReadChunkHeader(in, size, header)) {
+    const SFHydraLevel level = header.name[0] == 'p' ? SFHydraLevel::kPreset : SFHydraLevel::kInstrument;
+    if (header.name == "phdr") {
+      ParseRecords(in, header, SFPresetHeaderRecord::kSize, [&](size_t index, const char * record) {
+        SFPresetHeaderRecord::PresetName::Load(record, preset_header.name);
+        preset_header.preset_number = SFPresetHeaderRecord::Preset::Load(record);
+        preset_header.bank = SFPresetHeaderRecord::Bank::Load(record);
+        preset_header.bag_index = SFPresetHeaderRecord::PresetBagIndex::Load(record);
+        preset_header.library = SFPresetHeaderRecord::Library::Load(record);
+        preset_header.genre = SFPresetHeaderRecord::Genre::Load(record);
+        preset_header.morphology = SFPresetHeaderRecord::Morphology::Load(record);
+        handler.OnPresetHeader(index, preset_header);
+      });
+    }
+    else if (header.name == "pbag" || header.name == "ibag") {
+      ParseRecords(in, header, SFBagRecord::kSize, [&](size_t index, const char * record) {
+        handler.OnBag(level, index, SFParsedBag{
+          SFBagRecord::GeneratorIndex::Load(record),
+          SFBagRecord::ModulatorIndex::Load(record)});
+      });
+    }
+    else if (header.name == "pmod" || header.name == "imod") {
+      ParseRecords(in, header, SFModListRecord::kSize, [&](size_t index, const char * record) {
+        handler.OnModulator(level, index, SFModulatorItem(
+          SFModulator(SFModListRecord::SourceOp::Load(record)),
+          SFGenerator(SFModListRecord::DestinationOp::Load(record)),
+          SFModListRecord::Amount::Load(record),
+          SFModulator(SFModListRecord::AmountSourceOp::Load(record)),
+          SFTransform(SFModListRecord::TransformOp::Load(record))));
+      });
+    }
+    else if (header.name == "pgen" || header.name == "igen") {
+      ParseRecords(in, header, SFGenListRecord::kSize, [&](size_t index, const char * record) {
+        GenAmountType amount;
+        amount.uvalue = SFGenListRecord::Amount::Load(record);
+        handler.OnGenerator(level, index, SFGeneratorItem(SFGenerator(SFGenListRecord::Op::Load(record)), amount));
+      });
+    }
+    else if (header.name == "inst") {
+      ParseRecords(in, header, SFInstRecord::kSize, [&](size_t index, const char * record) {
+        SFInstRecord::InstName::Load(record, instrument.name);
+        instrument.bag_index = SFInstRecord::InstBagIndex::Load(record);
+        handler.OnInstrument(index, instrument);
+      });
+    }
+    else if (header.name == "shdr") {
+      ParseRecords(in, header, SFSampleRecord::kSize, [&](size_t index, const char * record) {
+        SFSampleRecord::SampleName::Load(record, sample_header.name);
+        sample_header.start = SFSampleRecord::Start::Load(record);
+        sample_header.end = SFSampleRecord::End::Load(record);
+        sample_header.start_loop = SFSampleRecord::StartLoop::Load(record);
+        sample_header.end_loop = SFSampleRecord::EndLoop::Load(record);
+        sample_header.sample_rate = SFSampleRecord::SampleRate::Load(record);
+        sample_header.original_key = SFSampleRecord::OriginalKey::Load(record);
+        sample_header.correction = SFSampleRecord::Correction::Load(record);
+        sample_header.sample_link = SFSampleRecord::SampleLink::Load(record);
+        sample_header.type = SFSampleLink(SFSampleRecord::SampleType::Load(record));
+        handler.OnSampleHeader(index, sample_header);
+      });
+    }
+    else {
+      in.Skip(header.size);
+    }
+    size -= header.size;
+    SkipChunkPadding(in, header.size, size);
+  }
+}
+
+/// Parses a SoundFont file.
+/// @param in the input.
+/// @param handler the handler that receives the records.
+/// @throws std::ios_base::failure The input is not a valid SoundFont 2 file.
+void ParseSoundFont(SFParseInput & in, SFParseHandler & handler) {
+  const char * riff_header = in.Read(12);
+  if (memcmp(&riff_header[0], "RIFF", 4) != 0 || memcmp(&riff_header[8], "sfbk", 4) != 0) {
+    ThrowInvalidFileError("The file is not a SoundFont file.");
+  }
+  uint64_t size = ReadInt32L(&riff_header[4]);
+  if (size < 4) {
+    ThrowInvalidFileError("The file has a truncated RIFF chunk.");
+  }
+  size -= 4;
+
+  RIFFChunkHeader header;
+  while (ReadChunkHeader(in, size, header)) {
+    uint64_t list_size = header.size;
+    if (header.name == "LIST") {
+      if (list_size < 4) {
+        ThrowInvalidFileError("The file has a malformed LIST chunk.");
+      }
+      const std::string list_type(in.Read(4), 4);
+      list_size -= 4;
+      if (list_type == "INFO") {
+        ParseInfoList(in, list_size, handler);
+      }
+      else if (list_type == "sdta") {
+        ParseSdtaList(in, list_size, handler);
+      }
+      else if (list_type == "pdta") {
+        ParsePdtaList(in, list_size, handler);
+      }
+      else {
+        in.Skip(list_size);
+      }
+    }
+    else {
+      in.Skip(list_size);
+    }
+    size -= header.size;
+    SkipChunkPadding(in, header.size, size);
+  }
+}
+
+} // namespace
+
+/// Called for a chunk with a string in "INFO" chunk.
+void SFParseHandler::OnInfo(const std::string & name, const std::string & text) {
+  // Nothing to handle by default.
+  static_cast<void>(name);
+  static_cast<void>(text);
+}
+
+/// Called for a chunk with a version number in "INFO" chunk.
+void SFParseHandler::OnVersion(const std::string & name, const SFVersionTag & version) {
+  // Nothing to handle by default.
+  static_cast<void>(name);
+  static_cast<void>(version);
+}
+
+/// Called for a chunk in "sdta" chunk.
+void SFParseHandler::OnSampleData(const std::string & name, uint64_t offset, uint32_t size) {
+  // Nothing to handle by default.
+  static_cast<void>(name);
+  static_cast<void>(offset);
+  static_cast<void>(size);
+}
+
+/// Called for a record of "phdr" chunk.
+void SFParseHandler::OnPresetHeader(size_t index, const SFParsedPresetHeader & header) {
+  // Nothing to handle by default.
+  static_cast<void>(index);
+  static_cast<void>(header);
+}
+
+/// Called for a record of "pbag" or "ibag" chunk.
+void SFParseHandler::OnBag(SFHydraLevel level, size_t index, const SFParsedBag & bag) {
+  // Nothing to handle by default.
+  static_cast<void>(level);
+  static_cast<void>(index);
+  static_cast<void>(bag);
+}
+
+/// Called for a record of "pmod" or "imod" chunk.
+void SFParseHandler::OnModulator(SFHydraLevel level, size_t index, const SFModulatorItem & modulator) {
+  // Nothing to handle by default.
+  static_cast<void>(level);
+  static_cast<void>(index);
+  static_cast<void>(modulator);
+}
+
+/// Called for a record of "pgen" or "igen" chunk.
+void SFParseHandler::OnGenerator(SFHydraLevel level, size_t index, const SFGeneratorItem & generator) {
+  // Nothing to handle by default.
+  static_cast<void>(level);
+  static_cast<void>(index);
+  static_cast<void>(generator);
+}
+
+/// Called for a record of "inst" chunk.
+void SFParseHandler::OnInstrument(size_t index, const SFParsedInstrument & instrument) {
+  // Nothing to handle by default.
+  static_cast<void>(index);
+  static_cast<void>(instrument);
+}
+
+/// Called for a record of "shdr" chunk.
+void SFParseHandler::OnSampleHeader(size_t index, const SFParsedSampleHeader & header) {
+  // Nothing to handle by default.
+  static_cast<void>(index);
+  static_cast<void>(header);
+}
+
+/// Parses a file.
+void SoundFontParser::Parse(const std::string & filename, SFParseHandler & handler) {
+#ifdef SF2CUTE_HAS_POSIX_IO
+  FileDescriptor file(filename, O_RDONLY);
+  struct stat st;
+  if (::fstat(file.get(), &st) != 0) {
+    ThrowSystemError("Could not get the file status");
+  }
+
+  // The pages of the sample data are skipped, and never touched.
+  const MemoryMappedFile mapping(file.get(), size_t(st.st_size), false);
+  Parse(mapping.data(), mapping.size(), handler);
+#else
+  std::ifstream in;
+
+  in.exceptions(std::ios::badbit | std::ios::failbit);
+  in.open(filename, std::ios::binary);
+  in.exceptions(std::ios::badbit);
+
+  Parse(in, handler);
+#endif
+}
+
+/// Parses an input stream.
+void SoundFontParser::Parse(std::istream & in, SFParseHandler & handler) {
+  SFStreamParseInput input(in);
+  ParseSoundFont(input, handler);
+}
+
+/// Parses an input stream.
+void SoundFontParser::Parse(std::istream && in, SFParseHandler & handler) {
+  Parse(in, handler);
+}
+
+/// Parses memory.
+void SoundFontParser::Parse(const void * data, size_t size, SFParseHandler & handler) {
+  SFMemoryParseInput input(static_cast<const char *>(data), size);
+  ParseSoundFont(input, handler);
+}
+
+} // namespace sf2cute
@@ -0,0 +1,835 @@
+/// @file
+/// SoundFont 2 File reader class implementation.
+///
+/// @author gocha <https://github.com/gocha>
+
+#include <sf2cute/file_reader.hpp>
+
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <system_error>
+
+#include <sf2cute/file.hpp>
+#include <sf2cute/generator_item.hpp>
+#include <sf2cute/instrument.hpp>
+#include <sf2cute/instrument_zone.hpp>
+#include <sf2cute/modulator_item.hpp>
+#include <sf2cute/output_sink.hpp>
+#include <sf2cute/preset.hpp>
+#include <sf2cute/preset_zone.hpp>
+#include <sf2cute/sample.hpp>
+
+#ifdef SF2CUTE_HAS_POSIX_IO
+#include <fcntl.h>
+#include <sys/stat.h>
+#endif
+
+#include "byteio.hpp"
+#include "file_descriptor.hpp"
+#include "memory_mapped_file.hpp"
+#include "packed_record.hpp"
+#include "parallel.hpp"
+
+namespace sf2cute {
+
+namespace {
+
+/// The RIFFChunkView struct represents a chunk of a RIFF file in memory.
+struct RIFFChunkView {
+  /// The name of the chunk (FourCC). The list type is used for a "LIST" chunk.
+  std::string name;
+
+  /// The pointer to the chunk data. The list type of a "LIST" chunk is excluded.
+  const char * data;
+
+  /// The length of the chunk data, in terms of bytes.
+  size_t size;
+};
+
+/// The SFHydraChunks struct represents the sub-chunks of a "pdta" chunk.
+struct SFHydraChunks {
+  /// The phdr chunk.
+  RIFFChunkView phdr;
+
+  /// The pbag chunk.
+  RIFFChunkView pbag;
+
+  /// The pmod chunk.
+  RIFFChunkView pmod;
+
+  /// The pgen chunk.
+  RIFFChunkView pgen;
+
+  /// The inst chunk.
+  RIFFChunkView inst;
+
+  /// The ibag chunk.
+  RIFFChunkView ibag;
+
+  /// The imod chunk.
+  RIFFChunkView imod;
+
+  /// The igen chunk.
+  RIFFChunkView igen;
+
+  /// The shdr chunk.
+  RIFFChunkView shdr;
+};
+
+/// Throws std::ios_base::failure for a malformed SoundFont file.
+/// @param what the description of the problem.
+/// @throws std::ios_base::failure always.
+[[noreturn]] void ThrowInvalidFileError(const std::string & what) {
+  throw std::ios_base::failure(what, std::make_error_code(std::io_errc::stream));
+}
+
+/// Splits the data of a RIFF or LIST chunk into its sub-chunks, without copying them.
+/// @param data the pointer to the chunk data, next to the form type or the list type.
+/// @param size the length of the chunk data, in terms of bytes.
+/// @return the sub-chunks, in file order.
+/// @throws std::ios_base::failure A sub-chunk is truncated or malformed.
+std::vector<RIFFChunkView> ReadRIFFChunkViews(const char * data, size_t size) {
+  std::vector<RIFFChunkView> chunks;
+  size_t offset = 0;
+  while (size - offset >= 8) {
+    const char * header = &data[offset];
+    const size_t data_size = ReadInt32L(&header[4]);
+    if (data_size > size - offset - 8) {
+      ThrowInvalidFileError("The file has a truncated chunk.");
+    }
+
+    RIFFChunkView chunk{std::string(header, 4), &header[8], data_size};
+    if (chunk.name == "LIST") {
+      if (data_size < 4) {
+        ThrowInvalidFileError("The file has a malformed LIST chunk.");
+      }
+      chunk.name.assign(&header[8], 4);
+      chunk.data += 4;
+      chunk.size -= 4;
+    }
+    chunks.push_back(std::move(chunk));
+
+    // The padding byte of the last chunk may be missing.
+    offset += std::min(size - offset, 8 + data_size + (data_size % 2));
+  }
+  return chunks;
+}
+
+/// Finds a chunk by its name.
+/// @param chunks the chunks.
+/// @param name the name of the chunk.
+/// @return the pointer to the first chunk of the name, or nullptr if no such chunk is found.
+const RIFFChunkView * FindRIFFChunkView(const std::vector<RIFFChunkView> & chunks, const std::string & name) {
+  const auto chunk = std::find_if(chunks.begin(), chunks.end(),
+    [&](const RIFFChunkView & chunk) { return chunk.name == name; });
+  return chunk != chunks.end() ? &*chunk : nullptr;
+}
+
+/// Finds a mandatory chunk by its name.
+/// @param chunks the chunks.
+/// @param name the name of the chunk.
+/// @return the first chunk of the name.
+/// @throws std::ios_base::failure No such chunk is found.
+const RIFFChunkView & GetRIFFChunkView(const std::vector<RIFFChunkView> & chunks, const std::string & name) {
+  const RIFFChunkView * chunk = FindRIFFChunkView(chunks, name);
+  if (chunk == nullptr) {
+    std::ostringstream message_builder;
+    message_builder << "The file has no " << name << " chunk.";
+    ThrowInvalidFileError(message_builder.str());
+  }
+  return *chunk;
+}
+
+/// Returns the string of a chunk with a string.
+/// @param chunk the chunk.
+/// @return the string, which ends at the first null character.
+std::string ReadZSTR(const RIFFChunkView & chunk) {
+  return std::string(chunk.data, std::find(chunk.data, chunk.data + chunk.size, '\0'));
+}
+
+/// Returns the version number of a chunk with a version number.
+/// @param chunk the chunk.
+/// @return the version number.
+/// @throws std::ios_base::failure The chunk is too short.
+SFVersionTag ReadVersion(const RIFFChunkView & chunk) {
+  if (chunk.size < 4) {
+    std::ostringstream message_builder;
+    message_builder << "The " << chunk.name << " chunk is too short.";
+    ThrowInvalidFileError(message_builder.str());
+  }
+  return SFVersionTag(ReadInt16L(&chunk.data[0]), ReadInt16L(&chunk.data[2]));
+}
+
+/// Returns the number of records of a hydra chunk.
+/// @param chunk the chunk.
+/// @param record_size the size of each record, in terms of bytes.
+/// @return the number of records, including the terminator record.
+/// @throws std::ios_base::failure The chunk size is not a positive multiple of the record size.
+size_t GetNumRecords(const RIFFChunkView & chunk, size_t record_size) {
+  if (chunk.size == 0 || chunk.size % record_size != 0) {
+    std::ostringstream message_builder;
+    message_builder << "The " << chunk.name << " chunk has an invalid size (" << chunk.size << " bytes).";
+    ThrowInvalidFileError(message_builder.str());
+  }
+  return chunk.size / record_size;
+}
+
+/// Checks that the indices stored in a hydra chunk are non-decreasing and within range.
+/// @param chunk the chunk that stores the indices, including the terminator record.
+/// @param record_size the size of each record, in terms of bytes.
+/// @param field_offset the offset of the index field in each record.
+/// @param num_items the number of records of the chunk that the indices point to,
+/// including the terminator record.
+/// @throws std::ios_base::failure The indices are decreasing or out of range.
+void CheckRecordIndices(const RIFFChunkView & chunk, size_t record_size,
+    size_t field_offset, size_t num_items) {
+  uint16_t previous_index = 0;
+  for (size_t offset = field_offset; offset < chunk.size; offset += record_size) {
+    const uint16_t index = ReadInt16L(&chunk.data[offset]);
+    if (index < previous_index || index >= num_items) {
+      std::ostringstream message_builder;
+      message_builder << "The " << chunk.name << " chunk has an invalid index at record "
+        << (offset / record_size) << ".";
+      ThrowInvalidFileError(message_builder.str());
+    }
+    previous_index = index;
+  }
+}
+
+/// Decodes the generators of a bag.
+///
+/// The generators end at the link generator, and the generators next to it are ignored.
+/// The link generators of the other kind are ignored.
+/// @param gen_chunk the pgen or igen chunk.
+/// @param first the index of the first generator.
+/// @param last the index next to the last generator.
+/// @param link_op the generator that links the zone to an instrument or a sample.
+/// @param link_index the index that the link generator points to, as output. It is left untouched if the bag has no link.
+/// @return the generators, excluding the link generator.
+std::vector<SFGeneratorItem> ReadGenerators(const RIFFChunkView & gen_chunk,
+    size_t first, size_t last, SFGenerator link_op, int32_t & link_index) {
+  std::vector<SFGeneratorItem> generators;
+  generators.reserve(last - first);
+  for (size_t index = first; index < last; index++) {
+    const char * record = &gen_chunk.data[index * SFGenListRecord::kSize];
+    const SFGenerator op = SFGenerator(SFGenListRecord::Op::Load(record));
+    GenAmountType amount;
+    amount.uvalue = SFGenListRecord::Amount::Load(record);
+
+    if (op == link_op) {
+      link_index = amount.uvalue;
+      break;
+    }
+    if (op == SFGenerator::kInstrument || op == SFGenerator::kSampleID) {
+      continue;
+    }
+    generators.emplace_back(op, amount);
+  }
+  return generators;
+}
+
+/// Decodes the modulators of a bag.
+/// @param mod_chunk the pmod or imod chunk.
+/// @param first the index of the first modulator.
+/// @param last the index next to the last modulator.
+/// @return the modulators.
+std::vector<SFModulatorItem> ReadModulators(const RIFFChunkView & mod_chunk,
+    size_t first, size_t last) {
+  std::vector<SFModulatorItem> modulators;
+  modulators.reserve(last - first);
+  for (size_t index = first; index < last; index++) {
+    const char * record = &mod_chunk.data[index * SFModListRecord::kSize];
+    modulators.emplace_back(
+      SFModulator(SFModListRecord::SourceOp::Load(record)),
+      SFGenerator(SFModListRecord::DestinationOp::Load(record)),
+      SFModListRecord::Amount::Load(record),
+      SFModulator(SFModListRecord::AmountSourceOp::Load(record)),
+      SFTransform(SFModListRecord::TransformOp::Load(record)));
+  }
+  return modulators;
+}
+
+/// Reads the INFO chunk into a SoundFont.
+/// @param info the sub-chunks of the INFO chunk.
+/// @param file the SoundFont.
+/// @throws std::ios_base::failure The INFO chunk is malformed, or the version is not supported.
+void ReadInfo(const std::vector<RIFFChunkView> & info, SoundFont & file) {
+  // SoundFont 3 files have compressed samples, which cannot be decoded.
+  const SFVersionTag version = ReadVersion(GetRIFFChunkView(info, "ifil"));
+  if (version.major_version != 2) {
+    std::ostringstream message_builder;
+    message_builder << "The SoundFont version " << version.major_version << "."
+      << version.minor_version << " is not supported.";
+    ThrowInvalidFileError(message_builder.str());
+  }
+
+  for (const RIFFChunkView & chunk : info) {
+    if (chunk.name == "isng") {
+      file.set_sound_engine(ReadZSTR(chunk));
+    }
+    else if (chunk.name == "INAM") {
+      file.set_bank_name(ReadZSTR(chunk));
+    }
+    else if (chunk.name == "irom") {
+      file.set_rom_name(ReadZSTR(chunk));
+    }
+    else if (chunk.name == "iver") {
+      file.set_rom_version(ReadVersion(chunk));
+    }
+    else if (chunk.name == "ICRD") {
+      file.set_creation_date(ReadZSTR(chunk));
+    }
+    else if (chunk.name == "IENG") {
+      file.set_engineers(ReadZSTR(chunk));
+    }
+    else if (chunk.name == "IPRD") {
+      file.set_product(ReadZSTR(chunk));
+    }
+    else if (chunk.name == "ICOP") {
+      file.set_copyright(ReadZSTR(chunk));
+    }
+    else if (chunk.name == "ICMT") {
+      file.set_comment(ReadZSTR(chunk));
+    }
+    else if (chunk.name == "ISFT") {
+      file.set_software(ReadZSTR(chunk));
+    }
+  }
+}
+
+/// Reads the INFO chunk into a summary.
+/// @param info the sub-chunks of the INFO chunk.
+/// @param summary the summary.
+/// @throws std::ios_base::failure A chunk with a version number is too short.
+void ReadInfoSummary(const std::vector<RIFFChunkView> & info, SFFileSummary & summary) {
+  for (const RIFFChunkView & chunk : info) {
+    if (chunk.name == "ifil") {
+      summary.version = ReadVersion(chunk);
+    }
+    else if (chunk.name == "isng") {
+      summary.sound_engine = ReadZSTR(chunk);
+    }
+    else if (chunk.name == "INAM") {
+      summary.bank_name = ReadZSTR(chunk);
+    }
+    else if (chunk.name == "irom") {
+      summary.rom_name = ReadZSTR(chunk);
+    }
+    else if (chunk.name == "iver") {
+      summary.rom_version = ReadVersion(chunk);
+      summary.has_rom_version = true;
+    }
+    else if (chunk.name == "ICRD") {
+      summary.creation_date = ReadZSTR(chunk);
+    }
+    else if (chunk.name == "IENG") {
+      summary.engineers = ReadZSTR(chunk);
+    }
+    else if (chunk.name == "IPRD") {
+      summary.product = ReadZSTR(chunk);
+    }
+    else if (chunk.name == "ICOP") {
+      summary.copyright = ReadZSTR(chunk);
+    }
+    else if (chunk.name == "ICMT") {
+      summary.comment = ReadZSTR(chunk);
+    }
+    else if (chunk.name == "ISFT") {
+      summary.software = ReadZSTR(chunk);
+    }
+  }
+}
+
+/// Reads the preset headers into a summary.
+/// @param phdr the phdr chunk.
+/// @param summary the summary.
+/// @throws std::ios_base::failure The chunk size is invalid.
+void ReadPresetSummaries(const RIFFChunkView & phdr, SFFileSummary & summary) {
+  const size_t num_items = GetNumRecords(phdr, SFPresetHeaderRecord::kSize);
+  summary.presets.reserve(num_items - 1);
+  for (size_t index = 0; index + 1 < num_items; index++) {
+    const char * record = &phdr.data[index * SFPresetHeaderRecord::kSize];
+    summary.presets.push_back(SFPresetSummary{
+      SFPresetHeaderRecord::PresetName::Load(record),
+      SFPresetHeaderRecord::Preset::Load(record),
+      SFPresetHeaderRecord::Bank::Load(record)});
+  }
+}
+
+/// Reads the metadata of a SoundFont file, reading only the INFO chunk and the phdr chunk.
+/// @param file_size the size of the file, in terms of bytes.
+/// @param read_at the function that reads the bytes at an offset of the file,
+/// with the signature void(uint64_t offset, char * data, size_t size).
+/// @return the metadata of the file.
+/// @throws std::ios_base::failure The file is not a valid SoundFont file.
+template <typename ReadAt>
+SFFileSummary ReadFileSummary(uint64_t file_size, ReadAt read_at) {
+  char header[12];
+  if (file_size < 12) {
+    ThrowInvalidFileError("The file is not a SoundFont file.");
+  }
+  read_at(0, header, 12);
+  if (memcmp(&header[0], "RIFF", 4) != 0 || memcmp(&header[8], "sfbk", 4) != 0) {
+    ThrowInvalidFileError("The file is not a SoundFont file.");
+  }
+  const uint64_t riff_size = ReadInt32L(&header[4]);
+  if (riff_size < 4 || riff_size > file_size - 8) {
+    ThrowInvalidFileError("The file has a truncated RIFF chunk.");
+  }
+  const uint64_t riff_end = 8 + riff_size;
+
+  // Visit the top-level chunks by their sizes. The sample data is never read.
+  SFFileSummary summary{};
+  bool has_info = false;
+  bool has_phdr = false;
+  std::vector<char> data;
+  uint64_t offset = 12;
+  while (offset < riff_end && riff_end - offset >= 12 && !(has_info && has_phdr)) {
+    read_at(offset, header, 12);
+    const uint64_t size = ReadInt32L(&header[4]);
+    if (size > riff_end - offset - 8) {
+      ThrowInvalidFileError("The file has a truncated chunk.");
+    }
+
+    if (memcmp(&header[0], "LIST", 4) == 0) {
+      if (size < 4) {
+        ThrowInvalidFileError("The file has a malformed LIST chunk.");
+      }
+      if (memcmp(&header[8], "INFO", 4) == 0 && !has_info) {
+        data.resize(size_t(size - 4));
+        read_at(offset + 12, data.data(), data.size());
+        ReadInfoSummary(ReadRIFFChunkViews(data.data(), data.size()), summary);
+        has_info = true;
+      }
+      else if (memcmp(&header[8], "pdta", 4) == 0 && !has_phdr) {
+        // Visit the sub-chunks up to the phdr chunk, which is the first one in a valid file.
+        const uint64_t list_end = offset + 8 + size;
+        uint64_t sub_offset = offset + 12;
+        while (sub_offset < list_end && list_end - sub_offset >= 8) {
+          read_at(sub_offset, header, 8);
+          const uint64_t sub_size = ReadInt32L(&header[4]);
+          if (sub_size > list_end - sub_offset - 8) {
+            ThrowInvalidFileError("The file has a truncated chunk.");
+          }
+          if (memcmp(&header[0], "phdr", 4) == 0) {
+            data.resize(size_t(sub_size));
+            read_at(sub_offset + 8, data.data(), data.size());
+            ReadPresetSummaries(RIFFChunkView{"phdr", data.data(), data.size()}, summary);
+            has_phdr = true;
+            break;
+          }
+          sub_offset += 8 + sub_size + (sub_size % 2);
+        }
+      }
+    }
+    offset += 8 + size + (size % 2);
+  }
+
+  if (!has_info) {
+    ThrowInvalidFileError("The file has no INFO chunk.");
+  }
+  if (!has_phdr) {
+    ThrowInvalidFileError("The file has no phdr chunk.");
+  }
+  return summary;
+}
+
+/// Decodes the samples.
+/// @param chunks the hydra chunks.
+/// @param smpl the smpl chunk, or nullptr if the file has no sample data.
+/// @param sm24 the sm24 chunk, or nullptr if the file has no 24-bit sample data.
+/// @param smpl_source the file that stores the data of the smpl chunk, with the offset of the data,
+/// or nullptr to read the 16-bit samples into memory.
+/// @param num_threads the number of threads that decode the samples.
+/// @return the samples.
+/// @throws std::ios_base::failure A sample is out of the sample data, or is compressed.
+std::vector<std::shared_ptr<SFSample>> ReadSamples(const SFHydraChunks & chunks,
+    const RIFFChunkView * smpl, const RIFFChunkView * sm24,
+    const SFSampleFileSource * smpl_source, unsigned num_threads) {
+  const size_t num_samples = GetNumRecords(chunks.shdr, SFSampleRecord::kSize) - 1;
+  const size_t num_data_points = smpl != nullptr ? smpl->size / sizeof(int16_t) : 0;
+
+  // The sm24 chunk is ignored unless it covers every data point.
+  if (sm24 != nullptr && sm24->size < num_data_points) {
+    sm24 = nullptr;
+  }
+
+  // Each sample is decoded into its own place, so that the samples stay in file order.
+  std::vector<std::shared_ptr<SFSample>> samples(num_samples);
+  ParallelFor(num_samples, num_threads, [&](size_t index) {
+    const char * record = &chunks.shdr.data[index * SFSampleRecord::kSize];
+    std::string name = SFSampleRecord::SampleName::Load(record);
+    const uint32_t start = SFSampleRecord::Start::Load(record);
+    const uint32_t end = SFSampleRecord::End::Load(record);
+    const uint16_t type = SFSampleRecord::SampleType::Load(record);
+    if ((type & 0x10) != 0) {
+      std::ostringstream message_builder;
+      message_builder << "Sample \"" << name << "\" has compressed data, which is not supported.";
+      ThrowInvalidFileError(message_builder.str());
+    }
+    if (start > end || end > num_data_points) {
+      std::ostringstream message_builder;
+      message_builder << "Sample \"" << name << "\" points outside the sample data.";
+      ThrowInvalidFileError(message_builder.str());
+    }
+
+    // A sample whose lower 8 bits are all zero is kept in 16 bits.
+    const uint8_t * low_bytes = sm24 != nullptr ?
+      reinterpret_cast<const uint8_t *>(&sm24->data[start]) : nullptr;
+    const bool is_24bit = low_bytes != nullptr &&
+      std::any_of(low_bytes, low_bytes + (end - start), [](uint8_t value) { return value != 0; });
+
+    // The loop points are relative to the sample, and wrap around as they do when written.
+    const uint32_t start_loop = uint32_t(SFSampleRecord::StartLoop::Load(record) - start);
+    const uint32_t end_loop = uint32_t(SFSampleRecord::EndLoop::Load(record) - start);
+
+    // A 16-bit sample can be left in the file.
+    if (smpl_source != nullptr && !is_24bit) {
+      std::shared_ptr<SFSample> sample = SFSample::New(std::move(name),
+        SFSampleFileSource{smpl_source->fd, smpl_source->offset + sizeof(int16_t) * uint64_t(start),
+          end - start, smpl_source->owner},
+        start_loop,
+        end_loop,
+        SFSampleRecord::SampleRate::Load(record),
+        SFSampleRecord::OriginalKey::Load(record),
+        SFSampleRecord::Correction::Load(record));
+      sample->set_type(SFSampleLink(type));
+      samples[index] = std::move(sample);
+      return;
+    }
+
+    std::vector<int16_t> data(end - start);
+    if (!data.empty()) {
+      ReadInt16LArray(data.data(), &smpl->data[sizeof(int16_t) * start], data.size());
+    }
+
+    std::vector<int32_t> data24;
+    if (is_24bit) {
+      data24.resize(data.size());
+      for (size_t point = 0; point < data.size(); point++) {
+        data24[point] = int32_t(uint32_t(int32_t(data[point])) << 8) | low_bytes[point];
+      }
+      std::vector<int16_t>().swap(data);
+    }
+
+    std::shared_ptr<SFSample> sample = SFSample::New(std::move(name),
+      std::move(data),
+      start_loop,
+      end_loop,
+      SFSampleRecord::SampleRate::Load(record),
+      SFSampleRecord::OriginalKey::Load(record),
+      SFSampleRecord::Correction::Load(record),
+      std::weak_ptr<SFSample>(),
+      SFSampleLink(type));
+    if (!data24.empty()) {
+      sample->set_data24(data24);
+    }
+    samples[index] = std::move(sample);
+  });
+
+  // Resolve the stereo links once every sample exists. The ROM flag (0x8000) does not matter.
+  for (size_t index = 0; index < num_samples; index++) {
+    const char * record = &chunks.shdr.data[index * SFSampleRecord::kSize];
+    const uint16_t link = SFSampleRecord::SampleLink::Load(record);
+    const uint16_t type = SFSampleRecord::SampleType::Load(record);
+    if ((type & 0x7fff) != uint16_t(SFSampleLink::kMonoSample) &&
+        link < num_samples) {
+      samples[index]->set_link(samples[link]);
+    }
+  }
+  return samples;
+}
+
+/// Decodes the instruments.
+/// @param chunks the hydra chunks.
+/// @param samples the samples that the instrument zones point to.
+/// @param num_threads the number of threads that decode the instruments.
+/// @return the instruments.
+/// @throws std::ios_base::failure The indices are invalid.
+std::vector<std::shared_ptr<SFInstrument>> ReadInstruments(const SFHydraChunks & chunks,
+    const std::vector<std::shared_ptr<SFSample>> & samples, unsigned num_threads) {
+  const size_t num_items = GetNumRecords(chunks.inst, SFInstRecord::kSize);
+  const size_t num_bags = GetNumRecords(chunks.ibag, SFBagRecord::kSize);
+  const size_t num_generators = GetNumRecords(chunks.igen, SFGenListRecord::kSize);
+  const size_t num_modulators = GetNumRecords(chunks.imod, SFModListRecord::kSize);
+  CheckRecordIndices(chunks.inst, SFInstRecord::kSize, SFInstRecord::InstBagIndex::kOffset, num_bags);
+  CheckRecordIndices(chunks.ibag, SFBagRecord::kSize, SFBagRecord::GeneratorIndex::kOffset, num_generators);
+  CheckRecordIndices(chunks.ibag, SFBagRecord::kSize, SFBagRecord::ModulatorIndex::kOffset, num_modulators);
+
+  // The indices have been checked, so the instruments can be decoded independently
+  // from their own bag ranges. Each instrument is decoded into its own place,
+  // so that the instruments stay in file order.
+  std::vector<std::shared_ptr<SFInstrument>> instruments(num_items - 1);
+  ParallelFor(num_items - 1, num_threads, [&](size_t index) {
+    const char * record = &chunks.inst.data[index * SFInstRecord::kSize];
+    const size_t first_bag = SFInstRecord::InstBagIndex::Load(record);
+    const size_t last_bag = SFInstRecord::InstBagIndex::Load(record + SFInstRecord::kSize);
+
+    std::vector<SFInstrumentZone> zones;
+    zones.reserve(last_bag - first_bag);
+    std::unique_ptr<SFInstrumentZone> global_zone;
+    for (size_t bag = first_bag; bag < last_bag; bag++) {
+      const char * bag_record = &chunks.ibag.data[bag * SFBagRecord::kSize];
+      int32_t sample_index = -1;
+      std::vector<SFGeneratorItem> generators = ReadGenerators(chunks.igen,
+        SFBagRecord::GeneratorIndex::Load(bag_record),
+        SFBagRecord::GeneratorIndex::Load(bag_record + SFBagRecord::kSize),
+        SFGenerator::kSampleID, sample_index);
+      std::vector<SFModulatorItem> modulators = ReadModulators(chunks.imod,
+        SFBagRecord::ModulatorIndex::Load(bag_record),
+        SFBagRecord::ModulatorIndex::Load(bag_record + SFBagRecord::kSize));
+
+      if (sample_index == -1) {
+        // Only the first zone can be a global zone. The others are ignored.
+        if (bag == first_bag) {
+          global_zone = std::make_unique<SFInstrumentZone>(std::weak_ptr<SFSample>(),
+            std::move(generators), std::move(modulators));
+        }
+        continue;
+      }
+
+      if (size_t(sample_index) >= samples.size()) {
+        std::ostringstream message_builder;
+        message_builder << "Instrument zone points to an unknown sample (" << sample_index << ").";
+        ThrowInvalidFileError(message_builder.str());
+      }
+      zones.emplace_back(samples[sample_index], std::move(generators), std::move(modulators));
+    }
+
+    std::string name = SFInstRecord::InstName::Load(record);
+    instruments[index] = global_zone != nullptr ?
+      SFInstrument::New(std::move(name), std::move(zones), std::move(*global_zone)) :
+      SFInstrument::New(std::move(name), std::move(zones));
+  });
+  return instruments;
+}
+
+/// Decodes the presets.
+/// @param chunks the hydra chunks.
+/// @param instruments the instruments that the preset zones point to.
+/// @param num_threads the number of threads that decode the presets.
+/// @return the presets.
+/// @throws std::ios_base::failure The indices are invalid.
+std::vector<std::shared_ptr<SFPreset>> ReadPresets(const SFHydraChunks & chunks,
+    const std::vector<std::shared_ptr<SFInstrument>> & instruments, unsigned num_threads) {
+  const size_t num_items = GetNumRecords(chunks.phdr, SFPresetHeaderRecord::kSize);
+  const size_t num_bags = GetNumRecords(chunks.pbag, SFBagRecord::kSize);
+  const size_t num_generators = GetNumRecords(chunks.pgen, SFGenListRecord::kSize);
+  const size_t num_modulators = GetNumRecords(chunks.pmod, SFModListRecord::kSize);
+  CheckRecordIndices(chunks.phdr, SFPresetHeaderRecord::kSize, SFPresetHeaderRecord::PresetBagIndex::kOffset, num_bags);
+  CheckRecordIndices(chunks.pbag, SFBagRecord::kSize, SFBagRecord::GeneratorIndex::kOffset, num_generators);
+  CheckRecordIndices(chunks.pbag, SFBagRecord::kSize, SFBagRecord::ModulatorIndex::kOffset, num_modulators);
+
+  // The presets are decoded in the same way as the instruments.
+  std::vector<std::shared_ptr<SFPreset>> presets(num_items - 1);
+  ParallelFor(num_items - 1, num_threads, [&](size_t index) {
+    const char * record = &chunks.phdr.data[index * SFPresetHeaderRecord::kSize];
+    const size_t first_bag = SFPresetHeaderRecord::PresetBagIndex::Load(record);
+    const size_t last_bag = SFPresetHeaderRecord::PresetBagIndex::Load(record + SFPresetHeaderRecord::kSize);
+
+    std::vector<SFPresetZone> zones;
+    zones.reserve(last_bag - first_bag);
+    std::unique_ptr<SFPresetZone> global_zone;
+    for (size_t bag = first_bag; bag < last_bag; bag++) {
+      const char * bag_record = &chunks.pbag.data[bag * SFBagRecord::kSize];
+      int32_t instrument_index = -1;
+      std::vector<SFGeneratorItem> generators = ReadGenerators(chunks.pgen,
+        SFBagRecord::GeneratorIndex::Load(bag_record),
+        SFBagRecord::GeneratorIndex::Load(bag_record + SFBagRecord::kSize),
+        SFGenerator::kInstrument, instrument_index);
+      std::vector<SFModulatorItem> modulators = ReadModulators(chunks.pmod,
+        SFBagRecord::ModulatorIndex::Load(bag_record),
+        SFBagRecord::ModulatorIndex::Load(bag_record + SFBagRecord::kSize));
+
+      if (instrument_index == -1) {
+        // Only the first zone can be a global zone. The others are ignored.
+        if (bag == first_bag) {
+          global_zone = std::make_unique<SFPresetZone>(std::weak_ptr<SFInstrument>(),
+            std::move(generators), std::move(modulators));
+        }
+        continue;
+      }
+
+      if (size_t(instrument_index) >= instruments.size()) {
+        std::ostringstream message_builder;
+        message_builder << "Preset zone points to an unknown instrument (" << instrument_index << ").";
+        ThrowInvalidFileError(message_builder.str());
+      }
+      zones.emplace_back(instruments[instrument_index], std::move(generators), std::move(modulators));
+    }
+
+    std::string name = SFPresetHeaderRecord::PresetName::Load(record);
+    const uint16_t preset_number = SFPresetHeaderRecord::Preset::Load(record);
+    const uint16_t bank = SFPresetHeaderRecord::Bank::Load(record);
+    std::shared_ptr<SFPreset> preset = global_zone != nullptr ?
+      SFPreset::New(std::move(name), preset_number, bank, std::move(zones), std::move(*global_zone)) :
+      SFPreset::New(std::move(name), preset_number, bank, std::move(zones));
+    preset->set_library(SFPresetHeaderRecord::Library::Load(record));
+    preset->set_genre(SFPresetHeaderRecord::Genre::Load(record));
+    preset->set_morphology(SFPresetHeaderRecord::Morphology::Load(record));
+    presets[index] = std::move(preset);
+  });
+  return presets;
+}
+
+/// Reads a SoundFont from the bytes of a SoundFont file.
+/// @param bytes the pointer to the bytes of the SoundFont file.
+/// @param size the size of the SoundFont file, in terms of bytes.
+/// @param source the file that the bytes are mapped from, or nullptr to read the sample data into memory.
+/// @param num_threads the number of threads that decode the hydra.
+/// @return the SoundFont.
+/// @throws std::ios_base::failure The bytes are not a valid SoundFont 2 file.
+SoundFont ReadSoundFont(const char * bytes, size_t size, const SFSampleFileSource * source,
+    unsigned num_threads) {
+  if (size < 12 || memcmp(&bytes[0], "RIFF", 4) != 0 || memcmp(&bytes[8], "sfbk", 4) != 0) {
+    ThrowInvalidFileError("The file is not a SoundFont file.");
+  }
+  const size_t riff_size = ReadInt32L(&bytes[4]);
+  if (riff_size < 4 || riff_size > size - 8) {
+    ThrowInvalidFileError("The file has a truncated RIFF chunk.");
+  }
+
+  // Visit the chunks in place.
+  const std::vector<RIFFChunkView> chunks = ReadRIFFChunkViews(&bytes[12], riff_size - 4);
+  const std::vector<RIFFChunkView> info = ReadRIFFChunkViews(GetRIFFChunkView(chunks, "INFO").data,
+    GetRIFFChunkView(chunks, "INFO").size);
+  const RIFFChunkView * sdta_chunk = FindRIFFChunkView(chunks, "sdta");
+  const std::vector<RIFFChunkView> sdta = sdta_chunk != nullptr ?
+    ReadRIFFChunkViews(sdta_chunk->data, sdta_chunk->size) : std::vector<RIFFChunkView>();
+  const std::vector<RIFFChunkView> pdta = ReadRIFFChunkViews(GetRIFFChunkView(chunks, "pdta").data,
+    GetRIFFChunkView(chunks, "pdta").size);
+  const SFHydraChunks hydra{
+    GetRIFFChunkView(pdta, "phdr"),
+    GetRIFFChunkView(pdta, "pbag"),
+    GetRIFFChunkView(pdta, "pmod"),
+    GetRIFFChunkView(pdta, "pgen"),
+    GetRIFFChunkView(pdta, "inst"),
+    GetRIFFChunkView(pdta, "ibag"),
+    GetRIFFChunkView(pdta, "imod"),
+    GetRIFFChunkView(pdta, "igen"),
+    GetRIFFChunkView(pdta, "shdr")};
+
+  SoundFont file;
+  ReadInfo(info, file);
+
+  // The sample data is left in the file at the offset of the smpl chunk data.
+  const RIFFChunkView * smpl = FindRIFFChunkView(sdta, "smpl");
+  SFSampleFileSource smpl_source{-1, 0, 0};
+  if (source != nullptr && smpl != nullptr) {
+    smpl_source = SFSampleFileSource{source->fd, source->offset + uint64_t(smpl->data - bytes), 0, source->owner};
+  }
+
+  // Decode the hydra from the bottom up, so that each zone can point to its target.
+  const std::vector<std::shared_ptr<SFSample>> samples = ReadSamples(hydra,
+    smpl, FindRIFFChunkView(sdta, "sm24"), smpl_source.fd != -1 ? &smpl_source : nullptr, num_threads);
+  const std::vector<std::shared_ptr<SFInstrument>> instruments = ReadInstruments(hydra, samples, num_threads);
+  const std::vector<std::shared_ptr<SFPreset>> presets = ReadPresets(hydra, instruments, num_threads);
+
+  for (const auto & sample : samples) {
+    file.AddSample(sample);
+  }
+  for (const auto & instrument : instruments) {
+    file.AddInstrument(instrument);
+  }
+  for (const auto & preset : presets) {
+    file.AddPreset(preset);
+  }
+  return file;
+}
+
+} // namespace
+
+/// Constructs a new SoundFontReader.
+SoundFontReader::SoundFontReader() :
+    num_threads_(1),
+    lazy_sample_data_(false) {
+}
+
+/// Reads a SoundFont from a file.
+SoundFont SoundFontReader::Read(const std::string & filename) {
+#ifdef SF2CUTE_HAS_POSIX_IO
+  // The samples share the file while they leave their data in it.
+  const std::shared_ptr<FileDescriptor> file = std::make_shared<FileDescriptor>(filename, O_RDONLY);
+  struct stat st;
+  if (::fstat(file->get(), &st) != 0) {
+    ThrowSystemError("Could not get the file status");
+  }
+
+  // The chunks are decoded straight from the mapping, and the mapping is released afterwards.
+  // The pages of the sample data that is left in the file are never touched.
+  const MemoryMappedFile mapping(file->get(), size_t(st.st_size), false);
+  const SFSampleFileSource source{file->get(), 0, 0, file};
+  return ReadSoundFont(mapping.data(), mapping.size(),
+    lazy_sample_data() ? &source : nullptr, num_threads());
+#else
+  std::ifstream in;
+
+  in.exceptions(std::ios::badbit | std::ios::failbit);
+  in.open(filename, std::ios::binary);
+  in.exceptions(std::ios::badbit);
+
+  return Read(in);
+#endif
+}
+
+/// Reads the metadata of a file, without reading the sample data or the rest of the hydra.
+SFFileSummary SoundFontReader::ReadSummary(const std::string & filename) {
+#ifdef SF2CUTE_HAS_POSIX_IO
+  FileDescriptor file(filename, O_RDONLY);
+  struct stat st;
+  if (::fstat(file.get(), &st) != 0) {
+    ThrowSystemError("Could not get the file status");
+  }
+
+  return ReadFileSummary(uint64_t(st.st_size), [&](uint64_t offset, char * data, size_t size) {
+    PReadAll(file.get(), data, size, offset);
+  });
+#else
+  std::ifstream in;
+
+  in.exceptions(std::ios::badbit | std::ios::failbit);
+  in.open(filename, std::ios::binary);
+  in.seekg(0, std::ios::end);
+  const uint64_t file_size = uint64_t(in.tellg());
+
+  return ReadFileSummary(file_size, [&](uint64_t offset, char * data, size_t size) {
+    in.seekg(std::streamoff(offset));
+    in.read(data, std::streamsize(size));
+  });
+#endif
+}
+
+/// Reads a SoundFont from an input stream.
+SoundFont SoundFontReader::Read(std::istream & in) {
+  constexpr size_t kBlockSize = 64 * 1024;
+  std::vector<char> data;
+  while (in) {
+    const size_t size = data.size();
+    data.resize(size + kBlockSize);
+    in.read(&data[size], std::streamsize(kBlockSize));
+    data.resize(size + size_t(in.gcount()));
+  }
+  if (in.bad()) {
+    throw std::ios_base::failure("Could not read the stream.", std::make_error_code(std::io_errc::stream));
+  }
+  return Read(data.data(), data.size());
+}
+
+/// Reads a SoundFont from an input stream.
+SoundFont SoundFontReader::Read(std::istream && in) {
+  return Read(in);
+}
+
+/// Reads a SoundFont from memory.
+SoundFont SoundFontReader::Read(const void * data, size_t size) {
+  return ReadSoundFont(static_cast<const char *>(data), size, nullptr, num_threads());
+}
+
+} // namespace sf2cute
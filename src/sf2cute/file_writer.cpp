@@ -3,19 +3,42 @@
 ///
 /// @author gocha <https://github.com/gocha>
 
-#include "file_writer.hpp"
+#include <sf2cute/file_writer.hpp>
 
+#include <stdint.h>
+#include <string.h>
 #include <algorithm>
+#include <future>
 #include <string>
-#include <unordered_map>
+#include <vector>
 #include <fstream>
+#include <sstream>
 #include <stdexcept>
+#include <system_error>
 
+#include <sf2cute/build_cache.hpp>
 #include <sf2cute/file.hpp>
+#include <sf2cute/output_sink.hpp>
+
+#ifdef SF2CUTE_HAS_POSIX_IO
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 #include "byteio.hpp"
+#include "digest_chunk.hpp"
+#include "encoded_sample_pool.hpp"
+#include "file_descriptor.hpp"
+#include "hashing_output_sink.hpp"
+#include "hydra_layout.hpp"
+#include "instrumented_chunk.hpp"
+#include "memory_mapped_file.hpp"
+#include "parallel.hpp"
 #include "riff.hpp"
 #include "riff_smpl_chunk.hpp"
+#include "riff_sm24_chunk.hpp"
 #include "riff_phdr_chunk.hpp"
 #include "riff_pbag_chunk.hpp"
 #include "riff_pmod_chunk.hpp"
@@ -28,33 +51,298 @@
 
 namespace sf2cute {
 
+#ifdef SF2CUTE_HAS_POSIX_IO
+namespace {
+
+/// The RIFFChunkSlot struct represents the place of a top-level chunk in an existing RIFF file.
+struct RIFFChunkSlot {
+  /// The name of the chunk (FourCC). The list type is used for a "LIST" chunk.
+  std::string name;
+
+  /// The file offset of the chunk header.
+  uint64_t offset;
+
+  /// The length of the chunk including the chunk header and the padding byte, in terms of bytes.
+  uint64_t size;
+};
+
+/// Throws std::ios_base::failure for a malformed SoundFont file.
+/// @param what the description of the problem.
+/// @throws std::ios_base::failure always.
+[[noreturn]] void ThrowInvalidFileError(const std::string & what) {
+  throw std::ios_base::failure(what, std::make_error_code(std::io_errc::stream));
+}
+
+/// Reads the places of the top-level chunks of a SoundFont file.
+/// @param fd the file descriptor opened for reading.
+/// @param riff_end the file offset next to the end of the RIFF chunk, as output.
+/// @return the places of the top-level chunks, in file order.
+/// @throws std::ios_base::failure An I/O error occurred, or the file is not a SoundFont file.
+std::vector<RIFFChunkSlot> ReadRIFFChunkSlots(int fd, uint64_t & riff_end) {
+  char header[12];
+  PReadAll(fd, header, sizeof(header), 0);
+  if (memcmp(&header[0], "RIFF", 4) != 0 || memcmp(&header[8], "sfbk", 4) != 0) {
+    ThrowInvalidFileError("The file is not a SoundFont file.");
+  }
+  riff_end = 8 + uint64_t(ReadInt32L(&header[4]));
+
+  std::vector<RIFFChunkSlot> slots;
+  uint64_t offset = 12;
+  while (offset + 8 <= riff_end) {
+    PReadAll(fd, header, 8, offset);
+    const uint64_t data_size = ReadInt32L(&header[4]);
+    if (offset + 8 + data_size > riff_end) {
+      ThrowInvalidFileError("The file has a truncated chunk.");
+    }
+
+    RIFFChunkSlot slot{std::string(&header[0], 4), offset, 8 + data_size + (data_size % 2)};
+    if (slot.name == "LIST") {
+      if (data_size < 4) {
+        ThrowInvalidFileError("The file has a malformed LIST chunk.");
+      }
+      PReadAll(fd, header, 4, offset + 8);
+      slot.name.assign(&header[0], 4);
+    }
+
+    offset += slot.size;
+    slots.push_back(std::move(slot));
+  }
+  return slots;
+}
+
+/// Finds a top-level chunk of a SoundFont file.
+/// @param slots the places of the top-level chunks.
+/// @param name the name of the chunk.
+/// @return the index of the chunk.
+/// @throws std::ios_base::failure The file does not have the chunk.
+size_t FindRIFFChunkSlot(const std::vector<RIFFChunkSlot> & slots, const std::string & name) {
+  const auto slot = std::find_if(slots.begin(), slots.end(),
+    [&](const RIFFChunkSlot & slot) { return slot.name == name; });
+  if (slot == slots.end()) {
+    std::ostringstream message_builder;
+    message_builder << "The file has no " << name << " chunk.";
+    ThrowInvalidFileError(message_builder.str());
+  }
+  return size_t(std::distance(slots.begin(), slot));
+}
+
+/// Writes a chunk to a file at the specified offset.
+/// @param chunk the chunk.
+/// @param fd the file descriptor opened for writing.
+/// @param offset the file offset of the chunk.
+void WriteChunkAt(const RIFFChunkInterface & chunk, int fd, uint64_t offset) {
+  // The buffer size is copied, since std::min binds references and the constant has no definition.
+  const RIFFChunkInterface::size_type max_buffer_size = PositionalFileOutputSink::kDefaultBufferSize;
+  PositionalFileOutputSink out(fd, offset, std::min(chunk.size(), max_buffer_size));
+  chunk.Write(out);
+  out.Flush();
+}
+
+/// Turns a place of a file into a JUNK chunk by writing its chunk header.
+/// @param fd the file descriptor opened for writing.
+/// @param offset the file offset of the place.
+/// @param size the length of the place, at least 8 bytes.
+void WriteJunkChunkHeaderAt(int fd, uint64_t offset, uint64_t size) {
+  PositionalFileOutputSink out(fd, offset, 8);
+  RIFFChunk::WriteHeader(out, "JUNK", RIFFChunk::size_type(size - 8));
+  out.Flush();
+}
+
+} // namespace
+#endif
+
 /// Constructs a new empty SoundFontWriter.
 SoundFontWriter::SoundFontWriter() :
-    file_(nullptr) {
+    file_(nullptr),
+    file_write_mode_(SFFileWriteMode::kBuffered),
+    sync_policy_(SFSyncPolicy::kNone),
+    num_threads_(1),
+    observer_(nullptr),
+    compute_digests_(false),
+    reproducible_(false),
+    deduplicate_samples_(false),
+    build_cache_(nullptr),
+    sample_encoder_(nullptr),
+    async_buffer_size_(AsyncOutputSink::kDefaultBufferSize),
+    num_async_buffers_(AsyncOutputSink::kDefaultNumBuffers) {
 }
 
 /// Constructs a new SoundFontWriter using specified file.
 SoundFontWriter::SoundFontWriter(const SoundFont & file) :
-    file_(&file) {
+    file_(&file),
+    file_write_mode_(SFFileWriteMode::kBuffered),
+    sync_policy_(SFSyncPolicy::kNone),
+    num_threads_(1),
+    observer_(nullptr),
+    compute_digests_(false),
+    reproducible_(false),
+    deduplicate_samples_(false),
+    build_cache_(nullptr),
+    sample_encoder_(nullptr),
+    async_buffer_size_(AsyncOutputSink::kDefaultBufferSize),
+    num_async_buffers_(AsyncOutputSink::kDefaultNumBuffers) {
 }
 
 /// Writes the SoundFont to a file.
 void SoundFontWriter::Write(const std::string & filename) {
+#ifdef SF2CUTE_HAS_POSIX_IO
+  if (build_cache() != nullptr && sample_encoder() == nullptr) {
+    WriteWithBuildCache(filename);
+    return;
+  }
+
+  // A sample whose data is stored in the output file keeps reading the old file
+  // through its file descriptor after it is unlinked, and the new output is created at its name.
+  if (IsSampleSourceFile(filename) && ::unlink(filename.c_str()) != 0) {
+    ThrowSystemError("Could not replace \"" + filename + "\"");
+  }
+
+  RIFF riff = MakeRIFF();
+
+  if (file_write_mode() == SFFileWriteMode::kMemoryMapped) {
+    FileDescriptor file(filename, O_RDWR | O_CREAT | O_TRUNC);
+    WriteMapped(riff, file.get());
+    if (sync_policy() == SFSyncPolicy::kFull && ::fsync(file.get()) != 0) {
+      ThrowSystemError("Could not synchronize the file");
+    }
+    file.Close();
+  }
+  else if (file_write_mode() == SFFileWriteMode::kPositional && !compute_digests()) {
+    FileDescriptor file(filename, O_WRONLY | O_CREAT | O_TRUNC);
+    WritePositional(riff, file.get());
+    SyncFile(file.get());
+    file.Close();
+  }
+  else if (file_write_mode() == SFFileWriteMode::kDirect) {
+    FileDescriptor file = OpenFileForDirectIO(filename, O_WRONLY | O_CREAT | O_TRUNC);
+    DirectFileOutputSink out(file.get());
+    WriteRIFF(riff, out);
+    out.Flush();
+    SyncFile(file.get());
+    file.Close();
+  }
+  else {
+    FileDescriptor file(filename, O_WRONLY | O_CREAT | O_TRUNC);
+    FileDescriptorOutputSink out(file.get());
+    WriteRIFF(riff, out);
+    out.Flush();
+    SyncFile(file.get());
+    file.Close();
+  }
+#else
   std::ofstream out;
 
   out.exceptions(std::ios::badbit | std::ios::failbit);
   out.open(filename, std::ios::binary);
 
   Write(out);
+#endif
+}
+
+/// Updates an existing SoundFont file in place, rewriting only its INFO and pdta chunks.
+void SoundFontWriter::Update(const std::string & filename) {
+  // The hash of the whole file cannot be computed without reading it.
+  if (compute_digests()) {
+    SoundFontWriter writer(*this);
+    writer.set_compute_digests(false);
+    writer.Update(filename);
+    return;
+  }
+
+#ifdef SF2CUTE_HAS_POSIX_IO
+  FileDescriptor file(filename, O_RDWR);
+
+  uint64_t riff_end = 0;
+  const std::vector<RIFFChunkSlot> slots = ReadRIFFChunkSlots(file.get(), riff_end);
+  const size_t info_index = FindRIFFChunkSlot(slots, "INFO");
+  const size_t sdta_index = FindRIFFChunkSlot(slots, "sdta");
+  const size_t pdta_index = FindRIFFChunkSlot(slots, "pdta");
+
+  // The sample headers refer to the sample pool by offsets,
+  // so the sample pool must keep its size.
+  const std::shared_ptr<const SFHydraLayout> layout = MakeHydraLayout();
+  const std::shared_ptr<const SFEncodedSamplePool> encoded_samples = MakeEncodedSamplePool(layout);
+  if (MakeSdtaListChunk(layout, encoded_samples)->size() != slots[sdta_index].size) {
+    file.Close();
+    Write(filename);
+    return;
+  }
+
+  const std::unique_ptr<RIFFChunkInterface> info = Observe(MakeInfoListChunk());
+  const std::unique_ptr<RIFFChunkInterface> pdta = MakePdtaListChunk(layout, encoded_samples);
+
+  uint64_t file_end = riff_end;
+  const auto place_chunk = [&](size_t index, const RIFFChunkInterface & chunk) {
+    // The place of a chunk extends over the JUNK chunks that follow it.
+    const uint64_t slot_offset = slots[index].offset;
+    uint64_t slot_size = slots[index].size;
+    for (size_t next = index + 1; next < slots.size() && slots[next].name == "JUNK"; next++) {
+      slot_size += slots[next].size;
+    }
+
+    const uint64_t chunk_size = chunk.size();
+    if (slot_offset + slot_size == file_end) {
+      // The last chunk can grow and shrink at its place.
+      WriteChunkAt(chunk, file.get(), slot_offset);
+      file_end = slot_offset + chunk_size;
+    }
+    else if (chunk_size == slot_size || chunk_size + 8 <= slot_size) {
+      WriteChunkAt(chunk, file.get(), slot_offset);
+      if (chunk_size != slot_size) {
+        WriteJunkChunkHeaderAt(file.get(), slot_offset + chunk_size, slot_size - chunk_size);
+      }
+    }
+    else {
+      WriteJunkChunkHeaderAt(file.get(), slot_offset, slot_size);
+      WriteChunkAt(chunk, file.get(), file_end);
+      file_end += chunk_size;
+    }
+  };
+
+  // Place pdta first, so that pdta stays the last chunk if it is.
+  place_chunk(pdta_index, *pdta);
+  place_chunk(info_index, *info);
+
+  if (file_end != riff_end) {
+    // Throw exception if the RIFF size exceeds the maximum.
+    if (file_end - 8 > UINT32_MAX) {
+      throw std::length_error("The RIFF chunk size exceeds the maximum.");
+    }
+
+    char size_field[4];
+    WriteInt32L(size_field, uint32_t(file_end - 8));
+    PWriteAll(file.get(), size_field, sizeof(size_field), 4);
+
+    if (file_end < riff_end && ::ftruncate(file.get(), off_t(file_end)) != 0) {
+      ThrowSystemError("Could not resize the file");
+    }
+  }
+
+  SyncFile(file.get());
+  file.Close();
+#else
+  Write(filename);
+#endif
+}
+
+/// Writes the SoundFont to a file in the background.
+std::future<void> SoundFontWriter::WriteAsync(const std::string & filename) {
+  SoundFontWriter writer(*this);
+  return std::async(std::launch::async, [writer, filename]() mutable {
+    if (writer.file_write_mode() == SFFileWriteMode::kBuffered &&
+        (writer.build_cache() == nullptr || writer.sample_encoder() != nullptr)) {
+      writer.WriteDoubleBuffered(filename);
+    }
+    else {
+      writer.Write(filename);
+    }
+  });
 }
 
 /// Writes the SoundFont to an output stream.
 void SoundFontWriter::Write(std::ostream & out) {
-  RIFF riff("sfbk");
-  riff.AddChunk(MakeInfoListChunk());
-  riff.AddChunk(MakeSdtaListChunk());
-  riff.AddChunk(MakePdtaListChunk());
-  riff.Write(out);
+  OStreamOutputSink sink(out);
+  Write(sink);
 }
 
 /// Writes the SoundFont to an output stream.
@@ -62,13 +350,263 @@ void SoundFontWriter::Write(std::ostream && out) {
   Write(out);
 }
 
+/// Writes the SoundFont to an output sink.
+void SoundFontWriter::Write(OutputSink & out) {
+  RIFF riff = MakeRIFF();
+  out.Reserve(riff.size());
+  WriteRIFF(riff, out);
+  out.Flush();
+}
+
+/// Returns the size of the serialized SoundFont.
+OutputSink::size_type SoundFontWriter::SerializedSize() {
+  return MakeRIFF().size();
+}
+
+/// Serializes the SoundFont into memory.
+std::vector<char> SoundFontWriter::Serialize() {
+  RIFF riff = MakeRIFF();
+  MemoryOutputSink out;
+  out.Reserve(riff.size());
+  WriteRIFF(riff, out);
+  return out.TakeData();
+}
+
+/// Serializes the SoundFont into a caller-supplied memory area.
+OutputSink::size_type SoundFontWriter::Serialize(void * data, OutputSink::size_type capacity) {
+  RIFF riff = MakeRIFF();
+
+  // Throw exception if the memory area cannot hold the whole file.
+  const RIFF::size_type file_size = riff.size();
+  if (file_size > capacity) {
+    std::ostringstream message_builder;
+    message_builder << "The buffer is too small to hold the SoundFont (" << file_size << " bytes).";
+    throw std::length_error(message_builder.str());
+  }
+
+  FixedBufferOutputSink out(data, capacity);
+  WriteRIFF(riff, out);
+  return out.position();
+}
+
+/// Make the RIFF tree of the SoundFont.
+RIFF SoundFontWriter::MakeRIFF() {
+  if (compute_digests()) {
+    // Every sample has its hash, and every observed chunk appends its hash.
+    digests_ = SFWriteDigests();
+    digests_.file.name = "sfbk";
+    digests_.samples.resize(file().samples().size());
+  }
+
+  // Plan the indices of the hydra chunks and the sample pool.
+  // The compressed sample data are needed to size the sample pool.
+  const std::shared_ptr<const SFHydraLayout> layout = MakeHydraLayout();
+  const std::shared_ptr<const SFEncodedSamplePool> encoded_samples = MakeEncodedSamplePool(layout);
+
+  RIFF riff("sfbk");
+  riff.AddChunk(Observe(MakeInfoListChunk()));
+  riff.AddChunk(MakeSdtaListChunk(layout, encoded_samples));
+  riff.AddChunk(MakePdtaListChunk(layout, encoded_samples));
+  return riff;
+}
+
+/// Writes the SoundFont to a file through the double-buffered AsyncOutputSink.
+void SoundFontWriter::WriteDoubleBuffered(const std::string & filename) {
+  RIFF riff = MakeRIFF();
+
+#ifdef SF2CUTE_HAS_POSIX_IO
+  FileDescriptor file(filename, O_WRONLY | O_CREAT | O_TRUNC);
+
+  // The bytes are buffered by AsyncOutputSink already, so a minimal buffer of the file sink
+  // lets every buffer go straight to write(2).
+  FileDescriptorOutputSink file_out(file.get(), 1);
+  {
+    AsyncOutputSink out(file_out, async_buffer_size(), num_async_buffers());
+    WriteRIFF(riff, out);
+    out.Flush();
+  }
+  SyncFile(file.get());
+  file.Close();
+#else
+  std::ofstream stream;
+  stream.exceptions(std::ios::badbit | std::ios::failbit);
+  stream.open(filename, std::ios::binary);
+
+  OStreamOutputSink stream_out(stream);
+  AsyncOutputSink out(stream_out, async_buffer_size(), num_async_buffers());
+  WriteRIFF(riff, out);
+  out.Flush();
+#endif
+}
+
+#ifdef SF2CUTE_HAS_POSIX_IO
+/// Writes the SoundFont to a file, copying the cached sample data from the previous output.
+void SoundFontWriter::WriteWithBuildCache(const std::string & filename) {
+  SFBuildCache & cache = *build_cache();
+
+  // Open the previous output before it is replaced.
+  FileDescriptor previous_file;
+  if (cache.filename() == filename) {
+    try {
+      previous_file = FileDescriptor(filename, O_RDONLY);
+    }
+    catch (const std::ios_base::failure &) {
+      // The previous output is gone, and every sample is serialized.
+    }
+  }
+  const bool has_previous_file = previous_file.is_open() &&
+      cache.Matches(filename, previous_file.get());
+
+  // The writer that writes the file, with the sources of the cached samples.
+  SoundFontWriter writer(*this);
+  writer.set_build_cache(nullptr);
+  writer.sample_sources_.assign(file().samples().size(), SFSampleFileSource{-1, 0, 0});
+
+  // Plan the place of each sample data in the new file:
+  // RIFF header, INFO chunk, sdta list header, smpl chunk header, and the sample pool.
+  const std::shared_ptr<const SFHydraLayout> layout = MakeHydraLayout();
+  const uint64_t sample_pool_offset = 12 + MakeInfoListChunk()->size() + 12 + 8;
+  std::vector<uint64_t> keys;
+  std::vector<SFBuildCache::Entry> entries;
+  size_t num_copied_samples = 0;
+  size_t num_serialized_samples = 0;
+  for (size_t index = 0; index < file().samples().size(); index++) {
+    const SFSample & sample = *file().samples()[index];
+    const uint32_t length = uint32_t(sample.data_length());
+    const uint64_t offset = sample_pool_offset +
+        sizeof(int16_t) * uint64_t(layout->sample_start_indices()[index]);
+
+    // The samples in a file are copied from their own file,
+    // and the shared samples are not written at all.
+    if (!sample.has_file_source() && layout->sample_origin_indices()[index] == index) {
+      const SFBuildCache::SampleHash hash = SFBuildCache::HashSample(sample);
+      // A hit is confirmed by the second hash, and by the cached bytes if requested.
+      const SFBuildCache::Entry * entry = has_previous_file ? cache.Find(hash, length) : nullptr;
+      if (entry != nullptr &&
+          (!cache.verify_data() || SFBuildCache::HasSameData(previous_file.get(), *entry, sample))) {
+        writer.sample_sources_[index] = SFSampleFileSource{previous_file.get(), entry->offset, length};
+        num_copied_samples++;
+      }
+      else {
+        num_serialized_samples++;
+      }
+
+      keys.push_back(hash.key);
+      entries.push_back(SFBuildCache::Entry{length, offset, hash.check});
+    }
+  }
+
+  // Write the new output to a temporary file next to it, copying from the previous output
+  // through its file descriptor, and rename it over the previous output once it is complete,
+  // so that a failed write keeps the previous output.
+  const std::string temporary_filename = filename + ".tmp";
+  try {
+    writer.Write(temporary_filename);
+  }
+  catch (const std::exception &) {
+    ::unlink(temporary_filename.c_str());
+    throw;
+  }
+  if (::rename(temporary_filename.c_str(), filename.c_str()) != 0) {
+    const int error_number = errno;
+    ::unlink(temporary_filename.c_str());
+    errno = error_number;
+    ThrowSystemError("Could not replace \"" + filename + "\"");
+  }
+  digests_ = std::move(writer.digests_);
+  previous_file.Close();
+
+  cache.Reset(filename, keys, entries);
+  cache.num_copied_samples_ = num_copied_samples;
+  cache.num_serialized_samples_ = num_serialized_samples;
+}
+
+/// Returns true if the data of any sample is stored in the specified file.
+bool SoundFontWriter::IsSampleSourceFile(const std::string & filename) const {
+  struct stat file_stat;
+  if (::stat(filename.c_str(), &file_stat) != 0) {
+    // A file that does not exist stores no sample data.
+    return false;
+  }
+
+  for (const auto & sample : file().samples()) {
+    if (!sample->has_file_source()) {
+      continue;
+    }
+
+    struct stat source_stat;
+    if (::fstat(sample->file_source().fd, &source_stat) != 0) {
+      ThrowSystemError("Could not examine the file of sample \"" + sample->name() + "\"");
+    }
+    if (source_stat.st_dev == file_stat.st_dev && source_stat.st_ino == file_stat.st_ino) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/// Writes the RIFF tree to a file through a memory mapping.
+void SoundFontWriter::WriteMapped(const RIFF & riff, int fd) {
+  const RIFF::size_type file_size = riff.size();
+  ResizeFile(fd, file_size);
+
+  MemoryMappedFile mapping(fd, file_size, true);
+  FixedBufferOutputSink out(mapping.data(), mapping.size());
+  WriteRIFF(riff, out);
+
+  if (sync_policy() != SFSyncPolicy::kNone) {
+    mapping.Sync();
+  }
+  mapping.Unmap();
+}
+
+/// Writes the RIFF tree to a file by writing each ranges at its offset concurrently.
+void SoundFontWriter::WritePositional(const RIFF & riff, int fd) {
+  // Allocate the whole file first, so that the ranges can be written in any order.
+  ResizeFile(fd, riff.size());
+
+  const std::vector<RIFFWriteRange> ranges = riff.GetWriteRanges();
+  const RIFF::size_type max_buffer_size = PositionalFileOutputSink::kDefaultBufferSize;
+  ParallelFor(ranges.size(), num_threads(), [&](size_t index) {
+    const RIFFWriteRange & range = ranges[index];
+    PositionalFileOutputSink out(fd, range.offset,
+      std::min(range.size, max_buffer_size));
+    range.write(out);
+    out.Flush();
+  });
+}
+
+/// Commits a written file to the storage device as specified by sync_policy().
+void SoundFontWriter::SyncFile(int fd) const {
+  if (sync_policy() == SFSyncPolicy::kNone) {
+    return;
+  }
+
+#ifdef __linux__
+  const int result = (sync_policy() == SFSyncPolicy::kData) ?
+    ::fdatasync(fd) : ::fsync(fd);
+#else
+  const int result = ::fsync(fd);
+#endif
+  if (result != 0) {
+    ThrowSystemError("Could not synchronize the file");
+  }
+}
+#endif
+
 /// Make an INFO chunk.
 std::unique_ptr<RIFFChunkInterface> SoundFontWriter::MakeInfoListChunk() {
   std::unique_ptr<RIFFListChunk> info = std::make_unique<RIFFListChunk>("INFO");
 
   // Mandatory chunks:
 
-  info->AddSubchunk(MakeVersionChunk("ifil", SFVersionTag(2, 1)));
+  // The sm24 chunk was introduced by SoundFont 2.04, and the compressed samples by SoundFont 3.
+  if (sample_encoder() != nullptr) {
+    info->AddSubchunk(MakeVersionChunk("ifil", SFVersionTag(3, 0)));
+  }
+  else {
+    info->AddSubchunk(MakeVersionChunk("ifil", Has24BitSamples() ? SFVersionTag(2, 4) : SFVersionTag(2, 1)));
+  }
 
   info->AddSubchunk(MakeZSTRChunk("isng", file().sound_engine().substr(0, SoundFont::kInfoTextMaxLength)));
 
@@ -108,42 +646,105 @@ std::unique_ptr<RIFFChunkInterface> SoundFontWriter::MakeInfoListChunk() {
     info->AddSubchunk(MakeZSTRChunk("ISFT", file().software().substr(0, SoundFont::kInfoTextMaxLength)));
   }
 
-  return std::move(info);
+  return info;
+}
+
+/// Plans the hydra layout of the SoundFont, including the sample pool.
+std::shared_ptr<const SFHydraLayout> SoundFontWriter::MakeHydraLayout() const {
+  return std::make_shared<SFHydraLayout>(file(), deduplicate_samples());
+}
+
+/// Compresses the sample data by sample_encoder().
+std::shared_ptr<const SFEncodedSamplePool> SoundFontWriter::MakeEncodedSamplePool(
+    std::shared_ptr<const SFHydraLayout> layout) const {
+  if (sample_encoder() == nullptr) {
+    return nullptr;
+  }
+  return std::make_shared<SFEncodedSamplePool>(std::move(layout), *sample_encoder(), num_threads());
+}
+
+/// Returns true if any sample has 24-bit sample data.
+bool SoundFontWriter::Has24BitSamples() const {
+  return std::any_of(file().samples().begin(), file().samples().end(),
+    [](const std::shared_ptr<SFSample> & sample) { return sample->has_24bit_data(); });
 }
 
 /// Make a sdta chunk.
-std::unique_ptr<RIFFChunkInterface> SoundFontWriter::MakeSdtaListChunk() {
+std::unique_ptr<RIFFChunkInterface> SoundFontWriter::MakeSdtaListChunk(std::shared_ptr<const SFHydraLayout> layout,
+    std::shared_ptr<const SFEncodedSamplePool> encoded_samples) {
   std::unique_ptr<RIFFListChunk> sdta = std::make_unique<RIFFListChunk>("sdta");
-  sdta->AddSubchunk(std::make_unique<SFRIFFSmplChunk>(file().samples()));
-  return std::move(sdta);
+  std::unique_ptr<SFRIFFSmplChunk> smpl = std::make_unique<SFRIFFSmplChunk>(layout);
+  if (encoded_samples != nullptr) {
+    // SoundFont 3 has no sm24 chunk.
+    smpl->set_encoded_samples(std::move(encoded_samples));
+    if (compute_digests()) {
+      smpl->set_sample_digests(&digests_.samples);
+    }
+    sdta->AddSubchunk(Observe(std::move(smpl)));
+    return sdta;
+  }
+  if (compute_digests()) {
+    smpl->set_sample_digests(&digests_.samples);
+  }
+  if (!sample_sources_.empty()) {
+    smpl->set_sample_sources(&sample_sources_);
+  }
+  sdta->AddSubchunk(Observe(std::move(smpl)));
+  if (Has24BitSamples()) {
+    sdta->AddSubchunk(Observe(std::make_unique<SFRIFFSm24Chunk>(std::move(layout))));
+  }
+  return sdta;
 }
 
 /// Make a pdta chunk.
-std::unique_ptr<RIFFChunkInterface> SoundFontWriter::MakePdtaListChunk() {
-  // Constructs a map for indexing each instruments.
-  std::unordered_map<const SFInstrument *, uint16_t> instrument_index_map;
-  for (uint16_t index = 0; index < file().instruments().size(); index++) {
-    instrument_index_map.insert(std::make_pair(file().instruments().at(index).get(), index));
+std::unique_ptr<RIFFChunkInterface> SoundFontWriter::MakePdtaListChunk(std::shared_ptr<const SFHydraLayout> layout,
+    std::shared_ptr<const SFEncodedSamplePool> encoded_samples) {
+  // Constructs the pdta chunk and its subchunks.
+  std::unique_ptr<RIFFListChunk> pdta = std::make_unique<RIFFListChunk>("pdta");
+  pdta->set_num_threads(num_threads());
+  std::unique_ptr<SFRIFFPhdrChunk> phdr = std::make_unique<SFRIFFPhdrChunk>(layout);
+  phdr->set_trim_names_at_null(reproducible());
+  pdta->AddSubchunk(Observe(std::move(phdr)));
+  pdta->AddSubchunk(Observe(std::make_unique<SFRIFFPbagChunk>(layout)));
+  pdta->AddSubchunk(Observe(std::make_unique<SFRIFFPmodChunk>(layout)));
+  pdta->AddSubchunk(Observe(std::make_unique<SFRIFFPgenChunk>(layout)));
+  std::unique_ptr<SFRIFFInstChunk> inst = std::make_unique<SFRIFFInstChunk>(layout);
+  inst->set_trim_names_at_null(reproducible());
+  pdta->AddSubchunk(Observe(std::move(inst)));
+  pdta->AddSubchunk(Observe(std::make_unique<SFRIFFIbagChunk>(layout)));
+  pdta->AddSubchunk(Observe(std::make_unique<SFRIFFImodChunk>(layout)));
+  pdta->AddSubchunk(Observe(std::make_unique<SFRIFFIgenChunk>(layout)));
+  std::unique_ptr<SFRIFFShdrChunk> shdr = std::make_unique<SFRIFFShdrChunk>(layout);
+  shdr->set_encoded_samples(std::move(encoded_samples));
+  shdr->set_trim_names_at_null(reproducible());
+  pdta->AddSubchunk(Observe(std::move(shdr)));
+  return pdta;
+}
+
+/// Wraps a chunk so that its writes are hashed and reported to the observer.
+std::unique_ptr<RIFFChunkInterface> SoundFontWriter::Observe(std::unique_ptr<RIFFChunkInterface> && chunk) {
+  if (compute_digests()) {
+    const size_t index = digests_.chunks.size();
+    digests_.chunks.push_back(SFContentDigest{chunk->name(), 0, 0});
+    chunk = std::make_unique<DigestChunk>(std::move(chunk), digests_.chunks, index);
   }
+  if (observer_ != nullptr) {
+    chunk = std::make_unique<InstrumentedChunk>(std::move(chunk), *observer_);
+  }
+  return std::move(chunk);
+}
 
-  // Constructs a map for indexing each samples.
-  std::unordered_map<const SFSample *, uint16_t> sample_index_map;
-  for (uint16_t index = 0; index < file().samples().size(); index++) {
-    sample_index_map.insert(std::make_pair(file().samples().at(index).get(), index));
+/// Writes the RIFF tree to an output sink, hashing the bytes if digests are computed.
+void SoundFontWriter::WriteRIFF(const RIFF & riff, OutputSink & out) {
+  if (!compute_digests()) {
+    riff.Write(out);
+    return;
   }
 
-  // Constructs the pdta chunk and its subchunks.
-  std::unique_ptr<RIFFListChunk> pdta = std::make_unique<RIFFListChunk>("pdta");
-  pdta->AddSubchunk(std::make_unique<SFRIFFPhdrChunk>(file().presets()));
-  pdta->AddSubchunk(std::make_unique<SFRIFFPbagChunk>(file().presets()));
-  pdta->AddSubchunk(std::make_unique<SFRIFFPmodChunk>(file().presets()));
-  pdta->AddSubchunk(std::make_unique<SFRIFFPgenChunk>(file().presets(), instrument_index_map));
-  pdta->AddSubchunk(std::make_unique<SFRIFFInstChunk>(file().instruments()));
-  pdta->AddSubchunk(std::make_unique<SFRIFFIbagChunk>(file().instruments()));
-  pdta->AddSubchunk(std::make_unique<SFRIFFImodChunk>(file().instruments()));
-  pdta->AddSubchunk(std::make_unique<SFRIFFIgenChunk>(file().instruments(), sample_index_map));
-  pdta->AddSubchunk(std::make_unique<SFRIFFShdrChunk>(file().samples(), sample_index_map));
-  return std::move(pdta);
+  HashingOutputSink hashing_out(out);
+  riff.Write(hashing_out);
+  digests_.file.size = hashing_out.position();
+  digests_.file.digest = hashing_out.digest();
 }
 
 /// Make a chunk with a version number.
@@ -155,7 +756,12 @@ std::unique_ptr<RIFFChunkInterface> SoundFontWriter::MakeVersionChunk(std::strin
 }
 
 /// Make a chunk with a string.
-std::unique_ptr<RIFFChunkInterface> SoundFontWriter::MakeZSTRChunk(std::string name, std::string data) {
+std::unique_ptr<RIFFChunkInterface> SoundFontWriter::MakeZSTRChunk(std::string name, std::string data) const {
+  // In reproducible mode, the string ends at its first null character, so that the padding is always zero.
+  if (reproducible()) {
+    data.resize(std::min(data.size(), data.find('\0')));
+  }
+
   std::vector<char> zstr((data.size() + 1 + 1) & ~1);
   std::copy(data.begin(), data.end(), zstr.begin());
   std::fill(std::next(zstr.begin(), data.size()), zstr.end(), 0);
@@ -0,0 +1,80 @@
+/// @file
+/// Hashing output sink class header.
+///
+/// @author gocha <https://github.com/gocha>
+
+#ifndef SF2CUTE_HASHING_OUTPUT_SINK_HPP_
+#define SF2CUTE_HASHING_OUTPUT_SINK_HPP_
+
+#include <stdint.h>
+
+#include <sf2cute/output_sink.hpp>
+
+#include "xxhash64.hpp"
+
+namespace sf2cute {
+
+/// The HashingOutputSink class represents a byte destination that hashes the bytes
+/// with XXH64 on their way to another sink.
+class HashingOutputSink : public OutputSink {
+public:
+  /// Unsigned integer type for the byte count.
+  using size_type = OutputSink::size_type;
+
+  /// Constructs a new HashingOutputSink.
+  /// @param out the destination sink.
+  explicit HashingOutputSink(OutputSink & out) noexcept :
+      out_(&out) {
+  }
+
+  /// HashingOutputSink cannot be copied.
+  HashingOutputSink(const HashingOutputSink & origin) = delete;
+
+  /// HashingOutputSink cannot be copied.
+  HashingOutputSink & operator=(const HashingOutputSink & origin) = delete;
+
+  /// Destructs the HashingOutputSink.
+  virtual ~HashingOutputSink() override = default;
+
+  /// Hashes a sequence of bytes, and writes them to the destination sink.
+  /// @param data the pointer to the bytes to be written.
+  /// @param size the number of bytes to be written.
+  /// @throws std::ios_base::failure An I/O error occurred.
+  virtual void Write(const void * data, size_type size) override {
+    hasher_.Update(data, size);
+    out_->Write(data, size);
+  }
+
+  /// @copydoc OutputSink::Reserve()
+  virtual void Reserve(size_type size) override {
+    out_->Reserve(size);
+  }
+
+  /// @copydoc OutputSink::Flush()
+  virtual void Flush() override {
+    out_->Flush();
+  }
+
+  /// Returns the number of bytes written to this sink.
+  /// @return the number of bytes written to this sink.
+  virtual size_type position() const noexcept override {
+    return size_type(hasher_.total_length());
+  }
+
+  /// Returns the hash of the bytes written so far.
+  /// @return the XXH64 hash of the bytes written so far.
+  uint64_t digest() const noexcept {
+    return hasher_.Digest();
+  }
+
+private:
+  /// The destination sink.
+  OutputSink * out_;
+
+  /// The hasher.
+  XXH64 hasher_;
+};
+
+} // namespace sf2cute
+
+#endif // SF2CUTE_HASHING_OUTPUT_SINK_HPP_
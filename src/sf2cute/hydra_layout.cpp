@@ -0,0 +1,325 @@
+/// @file
+/// SoundFont hydra layout class implementation.
+///
+/// @author gocha <https://github.com/gocha>
+
+#include "hydra_layout.hpp"
+
+#include <stdint.h>
+#include <string.h>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <stdexcept>
+
+#include <sf2cute/file.hpp>
+#include <sf2cute/instrument.hpp>
+#include <sf2cute/instrument_zone.hpp>
+#include <sf2cute/preset.hpp>
+#include <sf2cute/preset_zone.hpp>
+#include <sf2cute/sample.hpp>
+
+#include "xxhash64.hpp"
+
+namespace sf2cute {
+
+/// Constructs a new empty SFHydraLayout.
+SFHydraLayout::SFHydraLayout() :
+    file_(nullptr),
+    preset_bag_indices_(1, 0),
+    preset_generator_indices_(1, 0),
+    preset_modulator_indices_(1, 0),
+    instrument_bag_indices_(1, 0),
+    instrument_generator_indices_(1, 0),
+    instrument_modulator_indices_(1, 0) {
+}
+
+/// Plans the hydra layout of the specified SoundFont.
+SFHydraLayout::SFHydraLayout(const SoundFont & file, bool deduplicate_samples) :
+    file_(&file) {
+  // Check the number of header items, including the terminator items.
+  if (presets().size() + 1 > UINT16_MAX) {
+    throw std::length_error("Too many presets.");
+  }
+  if (instruments().size() + 1 > UINT16_MAX) {
+    throw std::length_error("Too many instruments.");
+  }
+  if (samples().size() + 1 > UINT16_MAX) {
+    throw std::length_error("Too many samples.");
+  }
+
+  // Constructs a map for indexing each instruments.
+  std::unordered_map<const SFInstrument *, uint16_t> instrument_index_map;
+  for (size_t index = 0; index < instruments().size(); index++) {
+    instrument_index_map.insert(std::make_pair(instruments()[index].get(), uint16_t(index)));
+  }
+
+  // Constructs a map for indexing each samples.
+  std::unordered_map<const SFSample *, uint16_t> sample_index_map;
+  for (size_t index = 0; index < samples().size(); index++) {
+    sample_index_map.insert(std::make_pair(samples()[index].get(), uint16_t(index)));
+  }
+
+  // Every sample has its own data points, unless they are shared.
+  sample_origin_indices_.resize(samples().size());
+  for (size_t index = 0; index < samples().size(); index++) {
+    sample_origin_indices_[index] = uint16_t(index);
+  }
+  if (deduplicate_samples) {
+    PlanSampleOrigins();
+  }
+
+  PlanPresets(instrument_index_map);
+  PlanInstruments(sample_index_map);
+  PlanSamples(sample_index_map);
+}
+
+/// Returns the presets of the SoundFont.
+const std::vector<std::shared_ptr<SFPreset>> & SFHydraLayout::presets() const {
+  static const std::vector<std::shared_ptr<SFPreset>> kNoPresets;
+  return file_ != nullptr ? file_->presets() : kNoPresets;
+}
+
+/// Returns the instruments of the SoundFont.
+const std::vector<std::shared_ptr<SFInstrument>> & SFHydraLayout::instruments() const {
+  static const std::vector<std::shared_ptr<SFInstrument>> kNoInstruments;
+  return file_ != nullptr ? file_->instruments() : kNoInstruments;
+}
+
+/// Returns the samples of the SoundFont.
+const std::vector<std::shared_ptr<SFSample>> & SFHydraLayout::samples() const {
+  static const std::vector<std::shared_ptr<SFSample>> kNoSamples;
+  return file_ != nullptr ? file_->samples() : kNoSamples;
+}
+
+/// Plans the preset side of the layout.
+void SFHydraLayout::PlanPresets(
+    const std::unordered_map<const SFInstrument *, uint16_t> & instrument_index_map) {
+  preset_bag_indices_.clear();
+  preset_bag_indices_.reserve(presets().size() + 1);
+  preset_generator_indices_.clear();
+  preset_modulator_indices_.clear();
+  preset_instrument_indices_.clear();
+
+  // The running counts include the terminator items.
+  size_t num_zones = 1;
+  size_t num_generators = 1;
+  size_t num_modulators = 1;
+  auto add_zone = [&](size_t zone_generators, size_t zone_modulators, uint16_t instrument_index) {
+    preset_generator_indices_.push_back(uint16_t(num_generators - 1));
+    preset_modulator_indices_.push_back(uint16_t(num_modulators - 1));
+    preset_instrument_indices_.push_back(instrument_index);
+
+    num_zones++;
+    num_generators += zone_generators;
+    num_modulators += zone_modulators;
+    if (num_zones > UINT16_MAX) {
+      throw std::length_error("Too many preset zones.");
+    }
+    if (num_generators > UINT16_MAX) {
+      throw std::length_error("Too many preset generators.");
+    }
+    if (num_modulators > UINT16_MAX) {
+      throw std::length_error("Too many preset modulators.");
+    }
+  };
+
+  for (const auto & preset : presets()) {
+    preset_bag_indices_.push_back(uint16_t(num_zones - 1));
+
+    // Global preset zone:
+    if (preset->has_global_zone()) {
+      // Throw exception if the global zone has a link to an instrument.
+      if (preset->global_zone().has_instrument()) {
+        throw std::invalid_argument("Global preset zone cannot have a link to an instrument.");
+      }
+
+      add_zone(preset->global_zone().generators().size(),
+        preset->global_zone().modulators().size(), 0);
+    }
+
+    // Preset zones:
+    for (const auto & zone : preset->zones()) {
+      // Throw exception if the preset zone does not have a link to an instrument.
+      if (!zone->has_instrument()) {
+        throw std::invalid_argument("Preset zone must have a link to an instrument.");
+      }
+
+      // Find the index number for the instrument.
+      const auto instrument_index = instrument_index_map.find(zone->instrument().get());
+      if (instrument_index == instrument_index_map.end()) {
+        throw std::out_of_range("Preset zone points to an unknown instrument.");
+      }
+
+      // The instrument generator is counted with the zone.
+      add_zone(1 + zone->generators().size(), zone->modulators().size(),
+        instrument_index->second);
+    }
+  }
+
+  // The terminator items.
+  preset_bag_indices_.push_back(uint16_t(num_zones - 1));
+  preset_generator_indices_.push_back(uint16_t(num_generators - 1));
+  preset_modulator_indices_.push_back(uint16_t(num_modulators - 1));
+}
+
+/// Plans the instrument side of the layout.
+void SFHydraLayout::PlanInstruments(
+    const std::unordered_map<const SFSample *, uint16_t> & sample_index_map) {
+  instrument_bag_indices_.clear();
+  instrument_bag_indices_.reserve(instruments().size() + 1);
+  instrument_generator_indices_.clear();
+  instrument_modulator_indices_.clear();
+  instrument_sample_indices_.clear();
+
+  // The running counts include the terminator items.
+  size_t num_zones = 1;
+  size_t num_generators = 1;
+  size_t num_modulators = 1;
+  auto add_zone = [&](size_t zone_generators, size_t zone_modulators, uint16_t sample_index) {
+    instrument_generator_indices_.push_back(uint16_t(num_generators - 1));
+    instrument_modulator_indices_.push_back(uint16_t(num_modulators - 1));
+    instrument_sample_indices_.push_back(sample_index);
+
+    num_zones++;
+    num_generators += zone_generators;
+    num_modulators += zone_modulators;
+    if (num_zones > UINT16_MAX) {
+      throw std::length_error("Too many instrument zones.");
+    }
+    if (num_generators > UINT16_MAX) {
+      throw std::length_error("Too many instrument generators.");
+    }
+    if (num_modulators > UINT16_MAX) {
+      throw std::length_error("Too many instrument modulators.");
+    }
+  };
+
+  for (const auto & instrument : instruments()) {
+    instrument_bag_indices_.push_back(uint16_t(num_zones - 1));
+
+    // Global instrument zone:
+    if (instrument->has_global_zone()) {
+      // Throw exception if the global zone has a link to a sample.
+      if (instrument->global_zone().has_sample()) {
+        throw std::invalid_argument("Global instrument zone cannot have a link to a sample.");
+      }
+
+      add_zone(instrument->global_zone().generators().size(),
+        instrument->global_zone().modulators().size(), 0);
+    }
+
+    // Instrument zones:
+    for (const auto & zone : instrument->zones()) {
+      // Throw exception if the instrument zone does not have a link to a sample.
+      if (!zone->has_sample()) {
+        throw std::invalid_argument("Instrument zone must have a link to a sample.");
+      }
+
+      // Find the index number for the sample.
+      const auto sample_index = sample_index_map.find(zone->sample().get());
+      if (sample_index == sample_index_map.end()) {
+        throw std::out_of_range("Instrument zone points to an unknown sample.");
+      }
+
+      // The sampleID generator is counted with the zone.
+      add_zone(1 + zone->generators().size(), zone->modulators().size(),
+        sample_index->second);
+    }
+  }
+
+  // The terminator items.
+  instrument_bag_indices_.push_back(uint16_t(num_zones - 1));
+  instrument_generator_indices_.push_back(uint16_t(num_generators - 1));
+  instrument_modulator_indices_.push_back(uint16_t(num_modulators - 1));
+}
+
+/// Finds the samples whose data points are identical to a preceding sample.
+void SFHydraLayout::PlanSampleOrigins() {
+  // The samples that are written to the sample pool, by the hash of their data points.
+  std::unordered_multimap<uint64_t, uint16_t> written_samples;
+  written_samples.reserve(samples().size());
+
+  for (size_t index = 0; index < samples().size(); index++) {
+    const SFSample & sample = *samples()[index];
+    if (sample.has_file_source()) {
+      continue;
+    }
+
+    const std::vector<int16_t> & data = sample.data();
+    const uint64_t hash = XXH64::Hash(data.data(), data.size() * sizeof(int16_t));
+
+    // Confirm the candidates byte by byte, since the hashes can collide.
+    // The lower 8 bits of 24-bit sample data must match as well.
+    const auto candidates = written_samples.equal_range(hash);
+    for (auto candidate = candidates.first; candidate != candidates.second; ++candidate) {
+      const SFSample & candidate_sample = *samples()[candidate->second];
+      const std::vector<int16_t> & candidate_data = candidate_sample.data();
+      if (candidate_data.size() == data.size() && (data.empty() ||
+          memcmp(candidate_data.data(), data.data(), data.size() * sizeof(int16_t)) == 0) &&
+          candidate_sample.low_byte_data() == sample.low_byte_data()) {
+        sample_origin_indices_[index] = candidate->second;
+        break;
+      }
+    }
+
+    if (sample_origin_indices_[index] == index) {
+      written_samples.insert(std::make_pair(hash, uint16_t(index)));
+    }
+  }
+}
+
+/// Plans the sample headers.
+void SFHydraLayout::PlanSamples(
+    const std::unordered_map<const SFSample *, uint16_t> & sample_index_map) {
+  sample_start_indices_.clear();
+  sample_start_indices_.reserve(samples().size());
+  sample_link_indices_.clear();
+  sample_link_indices_.reserve(samples().size());
+
+  size_t start_sample = 0;
+  for (size_t index = 0; index < samples().size(); index++) {
+    const auto & sample = samples()[index];
+
+    // Find the linked sample.
+    uint16_t link_index = 0;
+    if (sample->has_link()) {
+      const auto link = sample_index_map.find(sample->link().get());
+      if (link == sample_index_map.end()) {
+        throw std::out_of_range("Sample has a link to an unknown sample.");
+      }
+      link_index = link->second;
+    }
+
+    // A shared sample points to the data points of its origin, which precedes it.
+    const uint16_t origin_index = sample_origin_indices_[index];
+    if (origin_index != index) {
+      // Its own loop points are relative to the start of its origin.
+      const size_t origin_start = sample_start_indices_[origin_index];
+      if (origin_start + sample->start_loop() > UINT32_MAX ||
+          origin_start + sample->end_loop() > UINT32_MAX) {
+        throw std::length_error("Too many sample datapoints.");
+      }
+      sample_start_indices_.push_back(static_cast<uint32_t>(origin_start));
+      sample_link_indices_.push_back(link_index);
+      continue;
+    }
+
+    // Check the range of indices.
+    size_t end_sample = start_sample + sample->data_length();
+    size_t start_loop = start_sample + sample->start_loop();
+    size_t end_loop = start_sample + sample->end_loop();
+    if (start_sample > UINT32_MAX || end_sample > UINT32_MAX ||
+        start_loop > UINT32_MAX || end_loop > UINT32_MAX) {
+      throw std::length_error("Too many sample datapoints.");
+    }
+
+    sample_start_indices_.push_back(uint32_t(start_sample));
+    sample_link_indices_.push_back(link_index);
+
+    // Calculate the next sample index.
+    start_sample += sample->data_length() + SFSample::kTerminatorSampleLength;
+  }
+}
+
+} // namespace sf2cute
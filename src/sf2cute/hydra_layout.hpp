@@ -0,0 +1,265 @@
+/// @file
+/// SoundFont hydra layout class header.
+///
+/// @author gocha <https://github.com/gocha>
+
+#ifndef SF2CUTE_HYDRA_LAYOUT_HPP_
+#define SF2CUTE_HYDRA_LAYOUT_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace sf2cute {
+
+class SFSample;
+class SFInstrument;
+class SFPreset;
+class SoundFont;
+
+/// The SFHydraLayout class represents the index layout of the "pdta" (hydra) chunks.
+///
+/// The layout is planned by a single pass over a SoundFont. It holds every index
+/// that the hydra chunks refer to each other with, so that the chunks can be sized
+/// and written without walking the preset and instrument trees again.
+/// All the size and structure errors are reported while the layout is planned,
+/// that is, before any byte of the file is written.
+class SFHydraLayout {
+public:
+  /// Constructs a new empty SFHydraLayout.
+  SFHydraLayout();
+
+  /// Plans the hydra layout of the specified SoundFont.
+  /// @param file the SoundFont. It must outlive this layout.
+  /// @param deduplicate_samples true to store the identical sample data in the sample pool only once.
+  /// @throws std::invalid_argument Global zone has a link to an instrument or a sample.
+  /// @throws std::invalid_argument Zone does not have a link to an instrument or a sample.
+  /// @throws std::length_error Too many items for the hydra chunks.
+  /// @throws std::length_error Too many sample datapoints.
+  /// @throws std::out_of_range Zone or sample has a link to an unknown item.
+  explicit SFHydraLayout(const SoundFont & file, bool deduplicate_samples = false);
+
+  /// Constructs a new copy of specified SFHydraLayout.
+  /// @param origin a SFHydraLayout object.
+  SFHydraLayout(const SFHydraLayout & origin) = default;
+
+  /// Copy-assigns a new value to the SFHydraLayout, replacing its current contents.
+  /// @param origin a SFHydraLayout object.
+  SFHydraLayout & operator=(const SFHydraLayout & origin) = default;
+
+  /// Acquires the contents of specified SFHydraLayout.
+  /// @param origin a SFHydraLayout object.
+  SFHydraLayout(SFHydraLayout && origin) = default;
+
+  /// Move-assigns a new value to the SFHydraLayout, replacing its current contents.
+  /// @param origin a SFHydraLayout object.
+  SFHydraLayout & operator=(SFHydraLayout && origin) = default;
+
+  /// Destructs the SFHydraLayout.
+  ~SFHydraLayout() = default;
+
+  /// Returns the presets of the SoundFont.
+  /// @return the presets of the SoundFont.
+  const std::vector<std::shared_ptr<SFPreset>> & presets() const;
+
+  /// Returns the instruments of the SoundFont.
+  /// @return the instruments of the SoundFont.
+  const std::vector<std::shared_ptr<SFInstrument>> & instruments() const;
+
+  /// Returns the samples of the SoundFont.
+  /// @return the samples of the SoundFont.
+  const std::vector<std::shared_ptr<SFSample>> & samples() const;
+
+  /// Returns the preset bag index of each preset.
+  /// @return the preset bag index of each preset, followed by the one of the terminator item.
+  const std::vector<uint16_t> & preset_bag_indices() const noexcept {
+    return preset_bag_indices_;
+  }
+
+  /// Returns the generator index of each preset bag.
+  /// @return the generator index of each preset bag, followed by the one of the terminator item.
+  const std::vector<uint16_t> & preset_generator_indices() const noexcept {
+    return preset_generator_indices_;
+  }
+
+  /// Returns the modulator index of each preset bag.
+  /// @return the modulator index of each preset bag, followed by the one of the terminator item.
+  const std::vector<uint16_t> & preset_modulator_indices() const noexcept {
+    return preset_modulator_indices_;
+  }
+
+  /// Returns the instrument index of each preset bag.
+  /// @return the instrument index of each preset bag. The index of a global zone is 0.
+  const std::vector<uint16_t> & preset_instrument_indices() const noexcept {
+    return preset_instrument_indices_;
+  }
+
+  /// Returns the instrument bag index of each instrument.
+  /// @return the instrument bag index of each instrument, followed by the one of the terminator item.
+  const std::vector<uint16_t> & instrument_bag_indices() const noexcept {
+    return instrument_bag_indices_;
+  }
+
+  /// Returns the generator index of each instrument bag.
+  /// @return the generator index of each instrument bag, followed by the one of the terminator item.
+  const std::vector<uint16_t> & instrument_generator_indices() const noexcept {
+    return instrument_generator_indices_;
+  }
+
+  /// Returns the modulator index of each instrument bag.
+  /// @return the modulator index of each instrument bag, followed by the one of the terminator item.
+  const std::vector<uint16_t> & instrument_modulator_indices() const noexcept {
+    return instrument_modulator_indices_;
+  }
+
+  /// Returns the sample index of each instrument bag.
+  /// @return the sample index of each instrument bag. The index of a global zone is 0.
+  const std::vector<uint16_t> & instrument_sample_indices() const noexcept {
+    return instrument_sample_indices_;
+  }
+
+  /// Returns the first data point index of each sample in the sample pool.
+  /// @return the first data point index of each sample.
+  const std::vector<uint32_t> & sample_start_indices() const noexcept {
+    return sample_start_indices_;
+  }
+
+  /// Returns the index of the sample whose data points each sample shares in the sample pool.
+  /// @return the index of the sample whose data points each sample shares.
+  /// A sample whose data points are written to the sample pool has its own index.
+  const std::vector<uint16_t> & sample_origin_indices() const noexcept {
+    return sample_origin_indices_;
+  }
+
+  /// Returns the index of the linked sample of each sample.
+  /// @return the index of the linked sample of each sample, or 0 if the sample has no link.
+  const std::vector<uint16_t> & sample_link_indices() const noexcept {
+    return sample_link_indices_;
+  }
+
+  /// Returns the number of phdr items.
+  /// @return the number of phdr items, including the terminator item.
+  size_t num_preset_items() const noexcept {
+    return preset_bag_indices_.size();
+  }
+
+  /// Returns the number of pbag items.
+  /// @return the number of pbag items, including the terminator item.
+  size_t num_preset_bag_items() const noexcept {
+    return preset_generator_indices_.size();
+  }
+
+  /// Returns the number of pmod items.
+  /// @return the number of pmod items, including the terminator item.
+  size_t num_preset_modulator_items() const noexcept {
+    return size_t(preset_modulator_indices_.back()) + 1;
+  }
+
+  /// Returns the number of pgen items.
+  /// @return the number of pgen items, including the terminator item.
+  size_t num_preset_generator_items() const noexcept {
+    return size_t(preset_generator_indices_.back()) + 1;
+  }
+
+  /// Returns the number of inst items.
+  /// @return the number of inst items, including the terminator item.
+  size_t num_instrument_items() const noexcept {
+    return instrument_bag_indices_.size();
+  }
+
+  /// Returns the number of ibag items.
+  /// @return the number of ibag items, including the terminator item.
+  size_t num_instrument_bag_items() const noexcept {
+    return instrument_generator_indices_.size();
+  }
+
+  /// Returns the number of imod items.
+  /// @return the number of imod items, including the terminator item.
+  size_t num_instrument_modulator_items() const noexcept {
+    return size_t(instrument_modulator_indices_.back()) + 1;
+  }
+
+  /// Returns the number of igen items.
+  /// @return the number of igen items, including the terminator item.
+  size_t num_instrument_generator_items() const noexcept {
+    return size_t(instrument_generator_indices_.back()) + 1;
+  }
+
+  /// Returns the number of shdr items.
+  /// @return the number of shdr items, including the terminator item.
+  size_t num_sample_items() const noexcept {
+    return sample_start_indices_.size() + 1;
+  }
+
+private:
+  /// Plans the preset side of the layout.
+  /// @param instrument_index_map map containing the instruments as keys and their indices as map values.
+  /// @throws std::invalid_argument Preset zone has an invalid link to an instrument.
+  /// @throws std::length_error Too many preset items.
+  /// @throws std::out_of_range Preset zone points to an unknown instrument.
+  void PlanPresets(
+      const std::unordered_map<const SFInstrument *, uint16_t> & instrument_index_map);
+
+  /// Plans the instrument side of the layout.
+  /// @param sample_index_map map containing the samples as keys and their indices as map values.
+  /// @throws std::invalid_argument Instrument zone has an invalid link to a sample.
+  /// @throws std::length_error Too many instrument items.
+  /// @throws std::out_of_range Instrument zone points to an unknown sample.
+  void PlanInstruments(
+      const std::unordered_map<const SFSample *, uint16_t> & sample_index_map);
+
+  /// Finds the samples whose data points are identical to a preceding sample.
+  ///
+  /// The data points are hashed by XXH64, and the candidates of the same hash are compared byte by byte.
+  /// The samples whose data are stored in a file are never shared.
+  void PlanSampleOrigins();
+
+  /// Plans the sample headers.
+  /// @param sample_index_map map containing the samples as keys and their indices as map values.
+  /// @throws std::length_error Too many sample datapoints.
+  /// @throws std::out_of_range Sample has a link to an unknown sample.
+  void PlanSamples(
+      const std::unordered_map<const SFSample *, uint16_t> & sample_index_map);
+
+  /// The SoundFont.
+  const SoundFont * file_;
+
+  /// The preset bag index of each preset, and of the terminator.
+  std::vector<uint16_t> preset_bag_indices_;
+
+  /// The generator index of each preset bag, and of the terminator.
+  std::vector<uint16_t> preset_generator_indices_;
+
+  /// The modulator index of each preset bag, and of the terminator.
+  std::vector<uint16_t> preset_modulator_indices_;
+
+  /// The instrument index of each preset bag.
+  std::vector<uint16_t> preset_instrument_indices_;
+
+  /// The instrument bag index of each instrument, and of the terminator.
+  std::vector<uint16_t> instrument_bag_indices_;
+
+  /// The generator index of each instrument bag, and of the terminator.
+  std::vector<uint16_t> instrument_generator_indices_;
+
+  /// The modulator index of each instrument bag, and of the terminator.
+  std::vector<uint16_t> instrument_modulator_indices_;
+
+  /// The sample index of each instrument bag.
+  std::vector<uint16_t> instrument_sample_indices_;
+
+  /// The first data point index of each sample.
+  std::vector<uint32_t> sample_start_indices_;
+
+  /// The index of the sample whose data points each sample shares.
+  std::vector<uint16_t> sample_origin_indices_;
+
+  /// The index of the linked sample of each sample.
+  std::vector<uint16_t> sample_link_indices_;
+};
+
+} // namespace sf2cute
+
+#endif // SF2CUTE_HYDRA_LAYOUT_HPP_
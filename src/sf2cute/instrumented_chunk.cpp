@@ -0,0 +1,105 @@
+/// @file
+/// Instrumented RIFF chunk class implementation.
+///
+/// @author gocha <https://github.com/gocha>
+
+#include "instrumented_chunk.hpp"
+
+#include <stdint.h>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <sf2cute/write_observer.hpp>
+
+namespace sf2cute {
+
+namespace {
+
+/// The RangeWriteProgress struct tracks the ranges of a chunk that are written in any order.
+struct RangeWriteProgress {
+  /// The mutex that guards the progress.
+  std::mutex mutex;
+
+  /// True if a range has begun.
+  bool started;
+
+  /// The time when the first range began.
+  std::chrono::steady_clock::time_point start_time;
+
+  /// The number of ranges that have not ended yet.
+  size_t remaining_ranges;
+
+  /// The number of bytes written so far.
+  uint64_t bytes_written;
+};
+
+} // namespace
+
+/// Constructs a new InstrumentedChunk.
+InstrumentedChunk::InstrumentedChunk(std::unique_ptr<RIFFChunkInterface> && chunk,
+    SFWriteObserver & observer) :
+    chunk_(std::move(chunk)),
+    observer_(&observer) {
+}
+
+/// Writes the decorated chunk, and reports the write to the observer.
+void InstrumentedChunk::Write(OutputSink & out) const {
+  const std::string chunk_name = chunk_->name();
+  observer_->OnChunkBegin(chunk_name, chunk_->size(), chunk_->num_items());
+
+  const OutputSink::size_type start_position = out.position();
+  const auto start_time = std::chrono::steady_clock::now();
+  chunk_->Write(out);
+  const auto end_time = std::chrono::steady_clock::now();
+
+  observer_->OnChunkEnd(SFChunkWriteStats{chunk_name,
+    out.position() - start_position, chunk_->num_items(), end_time - start_time});
+}
+
+/// Splits the decorated chunk into byte ranges, each of which reports to the observer.
+void InstrumentedChunk::GetWriteRanges(size_type offset,
+    std::vector<RIFFWriteRange> & ranges) const {
+  const size_t first_range = ranges.size();
+  chunk_->GetWriteRanges(offset, ranges);
+
+  // A single range is written by Write().
+  if (ranges.size() - first_range <= 1) {
+    ranges.resize(first_range);
+    RIFFChunkInterface::GetWriteRanges(offset, ranges);
+    return;
+  }
+
+  auto progress = std::make_shared<RangeWriteProgress>();
+  progress->started = false;
+  progress->remaining_ranges = ranges.size() - first_range;
+  progress->bytes_written = 0;
+
+  for (size_t index = first_range; index < ranges.size(); index++) {
+    auto write = std::move(ranges[index].write);
+    ranges[index].write = [this, progress, write](OutputSink & out) {
+      {
+        std::lock_guard<std::mutex> lock(progress->mutex);
+        if (!progress->started) {
+          progress->started = true;
+          progress->start_time = std::chrono::steady_clock::now();
+          observer_->OnChunkBegin(chunk_->name(), chunk_->size(), chunk_->num_items());
+        }
+      }
+
+      const OutputSink::size_type start_position = out.position();
+      write(out);
+
+      std::lock_guard<std::mutex> lock(progress->mutex);
+      progress->bytes_written += out.position() - start_position;
+      if (--progress->remaining_ranges == 0) {
+        observer_->OnChunkEnd(SFChunkWriteStats{chunk_->name(), progress->bytes_written,
+          chunk_->num_items(), std::chrono::steady_clock::now() - progress->start_time});
+      }
+    };
+  }
+}
+
+} // namespace sf2cute
@@ -0,0 +1,87 @@
+/// @file
+/// Instrumented RIFF chunk class header.
+///
+/// @author gocha <https://github.com/gocha>
+
+#ifndef SF2CUTE_INSTRUMENTED_CHUNK_HPP_
+#define SF2CUTE_INSTRUMENTED_CHUNK_HPP_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "riff.hpp"
+
+namespace sf2cute {
+
+class SFWriteObserver;
+
+/// The InstrumentedChunk class represents a RIFF chunk decorator that reports
+/// the writes of the decorated chunk to a SFWriteObserver.
+class InstrumentedChunk : public RIFFChunkInterface {
+public:
+  /// Unsigned integer type for the chunk size.
+  using size_type = RIFFChunkInterface::size_type;
+
+  /// Constructs a new InstrumentedChunk.
+  /// @param chunk the chunk to be decorated.
+  /// @param observer the observer. It must outlive this chunk.
+  InstrumentedChunk(std::unique_ptr<RIFFChunkInterface> && chunk,
+      SFWriteObserver & observer);
+
+  /// InstrumentedChunk cannot be copied.
+  InstrumentedChunk(const InstrumentedChunk & origin) = delete;
+
+  /// InstrumentedChunk cannot be copied.
+  InstrumentedChunk & operator=(const InstrumentedChunk & origin) = delete;
+
+  /// Destructs the InstrumentedChunk.
+  virtual ~InstrumentedChunk() override = default;
+
+  /// @copydoc RIFFChunkInterface::name()
+  virtual std::string name() const override {
+    return chunk_->name();
+  }
+
+  /// @copydoc RIFFChunkInterface::size()
+  virtual size_type size() const noexcept override {
+    return chunk_->size();
+  }
+
+  /// @copydoc RIFFChunkInterface::num_items()
+  virtual size_type num_items() const noexcept override {
+    return chunk_->num_items();
+  }
+
+  /// Writes the decorated chunk, and reports the write to the observer.
+  /// @param out the output sink.
+  /// @throws std::length_error The chunk size exceeds the maximum.
+  /// @throws std::ios_base::failure An I/O error occurred.
+  virtual void Write(OutputSink & out) const override;
+
+  /// Splits the decorated chunk into byte ranges, each of which reports to the observer.
+  ///
+  /// The observer sees the beginning of the first range and the end of the last range,
+  /// whichever order the ranges are written in.
+  /// @param offset the absolute offset of this chunk in the file.
+  /// @param ranges the collection that the ranges are appended to, in file order.
+  virtual void GetWriteRanges(size_type offset,
+      std::vector<RIFFWriteRange> & ranges) const override;
+
+  /// Returns the decorated chunk.
+  /// @return the decorated chunk.
+  const RIFFChunkInterface & chunk() const noexcept {
+    return *chunk_;
+  }
+
+private:
+  /// The decorated chunk.
+  std::unique_ptr<RIFFChunkInterface> chunk_;
+
+  /// The observer.
+  SFWriteObserver * observer_;
+};
+
+} // namespace sf2cute
+
+#endif // SF2CUTE_INSTRUMENTED_CHUNK_HPP_
@@ -0,0 +1,107 @@
+/// @file
+/// POSIX memory-mapped file helper implementation.
+///
+/// @author gocha <https://github.com/gocha>
+
+#include "memory_mapped_file.hpp"
+
+#ifdef SF2CUTE_HAS_POSIX_IO
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "file_descriptor.hpp"
+
+namespace sf2cute {
+
+/// Constructs a new MemoryMappedFile that maps nothing.
+MemoryMappedFile::MemoryMappedFile() noexcept :
+    data_(nullptr),
+    size_(0) {
+}
+
+/// Maps the beginning of the specified file.
+MemoryMappedFile::MemoryMappedFile(int fd, size_t size, bool writable) :
+    data_(nullptr),
+    size_(0) {
+  if (size == 0) {
+    // mmap(2) does not accept an empty mapping.
+    return;
+  }
+
+  void * address = ::mmap(nullptr, size,
+    writable ? (PROT_READ | PROT_WRITE) : PROT_READ,
+    writable ? MAP_SHARED : MAP_PRIVATE, fd, 0);
+  if (address == MAP_FAILED) {
+    ThrowSystemError("Could not map the file");
+  }
+
+  data_ = static_cast<char *>(address);
+  size_ = size;
+}
+
+/// Acquires the mapping of specified MemoryMappedFile.
+MemoryMappedFile::MemoryMappedFile(MemoryMappedFile && origin) noexcept :
+    data_(origin.data_),
+    size_(origin.size_) {
+  origin.data_ = nullptr;
+  origin.size_ = 0;
+}
+
+/// Move-assigns a new value to the MemoryMappedFile, unmapping its current mapping.
+MemoryMappedFile & MemoryMappedFile::operator=(MemoryMappedFile && origin) noexcept {
+  if (this != &origin) {
+    Unmap();
+    data_ = origin.data_;
+    size_ = origin.size_;
+    origin.data_ = nullptr;
+    origin.size_ = 0;
+  }
+  return *this;
+}
+
+/// Destructs the MemoryMappedFile, and unmaps the file.
+MemoryMappedFile::~MemoryMappedFile() {
+  Unmap();
+}
+
+/// Writes the modified pages back to the file, and waits for the completion.
+void MemoryMappedFile::Sync() {
+  if (data_ != nullptr && ::msync(data_, size_, MS_SYNC) != 0) {
+    ThrowSystemError("Could not synchronize the mapped file");
+  }
+}
+
+/// Unmaps the file.
+void MemoryMappedFile::Unmap() noexcept {
+  if (data_ != nullptr) {
+    ::munmap(data_, size_);
+    data_ = nullptr;
+    size_ = 0;
+  }
+}
+
+/// Resizes a file to the specified size, allocating its blocks where the file system supports it.
+void ResizeFile(int fd, size_t size) {
+#ifdef __linux__
+  // Allocate the blocks now, so that a full device is reported here
+  // instead of as SIGBUS while the mapping is written.
+  if (size != 0 && ::fallocate(fd, 0, 0, off_t(size)) == 0) {
+    return;
+  }
+  if (size != 0 && errno != EOPNOTSUPP && errno != ENOSYS) {
+    ThrowSystemError("Could not allocate the file");
+  }
+#endif
+
+  if (::ftruncate(fd, off_t(size)) != 0) {
+    ThrowSystemError("Could not resize the file");
+  }
+}
+
+} // namespace sf2cute
+
+#endif // SF2CUTE_HAS_POSIX_IO
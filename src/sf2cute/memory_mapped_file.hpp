@@ -0,0 +1,84 @@
+/// @file
+/// POSIX memory-mapped file helper header.
+///
+/// @author gocha <https://github.com/gocha>
+
+#ifndef SF2CUTE_MEMORY_MAPPED_FILE_HPP_
+#define SF2CUTE_MEMORY_MAPPED_FILE_HPP_
+
+#include <sf2cute/output_sink.hpp>
+
+#ifdef SF2CUTE_HAS_POSIX_IO
+
+#include <stddef.h>
+
+namespace sf2cute {
+
+/// The MemoryMappedFile class owns a memory mapping of a file.
+class MemoryMappedFile {
+public:
+  /// Constructs a new MemoryMappedFile that maps nothing.
+  MemoryMappedFile() noexcept;
+
+  /// Maps the beginning of the specified file.
+  /// @param fd the file descriptor. It must be readable, and also writable if writable is true.
+  /// @param size the number of bytes to map.
+  /// @param writable true if the mapping is shared and writable, false if it is read-only.
+  /// @throws std::ios_base::failure The file could not be mapped.
+  MemoryMappedFile(int fd, size_t size, bool writable);
+
+  /// MemoryMappedFile cannot be copied.
+  MemoryMappedFile(const MemoryMappedFile & origin) = delete;
+
+  /// MemoryMappedFile cannot be copied.
+  MemoryMappedFile & operator=(const MemoryMappedFile & origin) = delete;
+
+  /// Acquires the mapping of specified MemoryMappedFile.
+  /// @param origin a MemoryMappedFile object.
+  MemoryMappedFile(MemoryMappedFile && origin) noexcept;
+
+  /// Move-assigns a new value to the MemoryMappedFile, unmapping its current mapping.
+  /// @param origin a MemoryMappedFile object.
+  MemoryMappedFile & operator=(MemoryMappedFile && origin) noexcept;
+
+  /// Destructs the MemoryMappedFile, and unmaps the file.
+  ~MemoryMappedFile();
+
+  /// Returns the pointer to the mapped bytes.
+  /// @return the pointer to the mapped bytes.
+  char * data() const noexcept {
+    return data_;
+  }
+
+  /// Returns the number of mapped bytes.
+  /// @return the number of mapped bytes.
+  size_t size() const noexcept {
+    return size_;
+  }
+
+  /// Writes the modified pages back to the file, and waits for the completion.
+  /// @throws std::ios_base::failure An I/O error occurred.
+  void Sync();
+
+  /// Unmaps the file.
+  void Unmap() noexcept;
+
+private:
+  /// The pointer to the mapped bytes.
+  char * data_;
+
+  /// The number of mapped bytes.
+  size_t size_;
+};
+
+/// Resizes a file to the specified size, allocating its blocks where the file system supports it.
+/// @param fd the file descriptor opened for writing.
+/// @param size the new size of the file, in terms of bytes.
+/// @throws std::ios_base::failure An I/O error occurred, such as a full device.
+void ResizeFile(int fd, size_t size);
+
+} // namespace sf2cute
+
+#endif // SF2CUTE_HAS_POSIX_IO
+
+#endif // SF2CUTE_MEMORY_MAPPED_FILE_HPP_
@@ -0,0 +1,478 @@
+/// @file
+/// Output sink classes implementation.
+///
+/// @author gocha <https://github.com/gocha>
+
+#include <sf2cute/output_sink.hpp>
+
+#include <string.h>
+#include <algorithm>
+#include <exception>
+#include <ios>
+#include <mutex>
+#include <ostream>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "file_descriptor.hpp"
+
+#ifdef SF2CUTE_HAS_POSIX_IO
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace sf2cute {
+
+/// Writes a sequence of bytes read from a file.
+void OutputSink::WriteFromFile(int fd, uint64_t offset, size_type size) {
+#ifdef SF2CUTE_HAS_POSIX_IO
+  constexpr size_type kCopyBufferSize = 64 * 1024;
+  std::vector<char> buffer(std::min(size, kCopyBufferSize));
+  while (size != 0) {
+    const size_type length = std::min(size, kCopyBufferSize);
+    PReadAll(fd, buffer.data(), length, offset);
+    Write(buffer.data(), length);
+    offset += length;
+    size -= length;
+  }
+#else
+  static_cast<void>(fd);
+  static_cast<void>(offset);
+  static_cast<void>(size);
+  throw std::ios_base::failure("Reading from a file descriptor is not supported on this platform.",
+    std::make_error_code(std::io_errc::stream));
+#endif
+}
+
+/// Announces the number of bytes that will be written from now on.
+void OutputSink::Reserve(size_type size) {
+  // Nothing to prepare by default.
+  static_cast<void>(size);
+}
+
+/// Writes all buffered bytes to the underlying destination.
+void OutputSink::Flush() {
+  // Nothing is buffered by default.
+}
+
+/// Constructs a new OStreamOutputSink using the specified output stream.
+OStreamOutputSink::OStreamOutputSink(std::ostream & out) :
+    out_(&out),
+    old_exception_bits_(out.exceptions()),
+    position_(0) {
+  // Set exception bits to get output error as an exception.
+  out.exceptions(std::ios::badbit | std::ios::failbit);
+}
+
+/// Destructs the OStreamOutputSink, and restores the exception mask of the stream.
+OStreamOutputSink::~OStreamOutputSink() {
+  try {
+    // Recover exception bits of output stream.
+    out_->exceptions(old_exception_bits_);
+  }
+  catch (const std::exception &) {
+    // The stream is already in a failed state, and the caller
+    // has got the exception from Write() or Flush().
+  }
+}
+
+/// Writes a sequence of bytes.
+void OStreamOutputSink::Write(const void * data, size_type size) {
+  out_->write(static_cast<const char *>(data), std::streamsize(size));
+  position_ += size;
+}
+
+/// Writes all buffered bytes to the underlying destination.
+void OStreamOutputSink::Flush() {
+  out_->flush();
+}
+
+/// Writes a sequence of bytes.
+void MemoryOutputSink::Write(const void * data, size_type size) {
+  const char * bytes = static_cast<const char *>(data);
+  data_.insert(data_.end(), bytes, bytes + size);
+}
+
+/// Writes a sequence of bytes.
+void FixedBufferOutputSink::Write(const void * data, size_type size) {
+  if (size > capacity_ - position_) {
+    throw std::ios_base::failure("The output buffer is too small.",
+      std::make_error_code(std::io_errc::stream));
+  }
+
+  memcpy(data_ + position_, data, size);
+  position_ += size;
+}
+
+/// Constructs a new AsyncOutputSink, and starts its I/O thread.
+AsyncOutputSink::AsyncOutputSink(OutputSink & out,
+    size_type buffer_size, size_type num_buffers) :
+    out_(&out),
+    buffer_size_(buffer_size != 0 ? buffer_size : 1),
+    position_(0),
+    writing_(false),
+    stopping_(false) {
+  // One buffer is filled while the others are written.
+  buffer_.reserve(buffer_size_);
+  const size_type num_free_buffers = std::max<size_type>(num_buffers, 2) - 1;
+  for (size_type index = 0; index < num_free_buffers; index++) {
+    free_buffers_.emplace_back();
+    free_buffers_.back().reserve(buffer_size_);
+  }
+
+  thread_ = std::thread(&AsyncOutputSink::Run, this);
+}
+
+/// Destructs the AsyncOutputSink, writes the buffered bytes, and stops the I/O thread.
+AsyncOutputSink::~AsyncOutputSink() {
+  try {
+    Flush();
+  }
+  catch (const std::exception &) {
+    // Destructors must not throw.
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  condition_.notify_all();
+  thread_.join();
+}
+
+/// Writes a sequence of bytes.
+void AsyncOutputSink::Write(const void * data, size_type size) {
+  const char * bytes = static_cast<const char *>(data);
+  while (size != 0) {
+    const size_type length = std::min(size, buffer_size_ - buffer_.size());
+    buffer_.insert(buffer_.end(), bytes, bytes + length);
+    bytes += length;
+    size -= length;
+    position_ += length;
+
+    if (buffer_.size() == buffer_size_) {
+      SubmitBuffer();
+    }
+  }
+}
+
+/// Waits until the I/O thread writes all buffered bytes, and flushes the destination sink.
+void AsyncOutputSink::Flush() {
+  if (!buffer_.empty()) {
+    SubmitBuffer();
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  condition_.wait(lock, [this] {
+    return (pending_buffers_.empty() && !writing_) || error_ != nullptr;
+  });
+  RethrowError(lock);
+  lock.unlock();
+
+  // The I/O thread is idle, so the destination sink can be used here.
+  out_->Flush();
+}
+
+/// Passes the current buffer to the I/O thread, and waits for a free buffer.
+void AsyncOutputSink::SubmitBuffer() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  RethrowError(lock);
+
+  pending_buffers_.push_back(std::move(buffer_));
+  condition_.notify_all();
+
+  condition_.wait(lock, [this] {
+    return !free_buffers_.empty() || error_ != nullptr;
+  });
+  RethrowError(lock);
+
+  buffer_ = std::move(free_buffers_.back());
+  free_buffers_.pop_back();
+}
+
+/// Rethrows the error of the I/O thread, if any.
+void AsyncOutputSink::RethrowError(std::unique_lock<std::mutex> & lock) {
+  if (error_ != nullptr) {
+    std::exception_ptr error = error_;
+    lock.unlock();
+    std::rethrow_exception(error);
+  }
+}
+
+/// Writes the submitted buffers to the destination sink until the sink is stopped.
+void AsyncOutputSink::Run() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    condition_.wait(lock, [this] {
+      return !pending_buffers_.empty() || stopping_;
+    });
+    if (pending_buffers_.empty()) {
+      return;
+    }
+
+    std::vector<char> buffer(std::move(pending_buffers_.front()));
+    pending_buffers_.pop_front();
+    writing_ = true;
+
+    // Write without the lock, so that the next buffer can be filled meanwhile.
+    // The buffers after an error are discarded.
+    if (error_ == nullptr) {
+      lock.unlock();
+      std::exception_ptr error;
+      try {
+        out_->Write(buffer.data(), buffer.size());
+      }
+      catch (...) {
+        error = std::current_exception();
+      }
+      lock.lock();
+      if (error != nullptr) {
+        error_ = error;
+      }
+    }
+
+    writing_ = false;
+    buffer.clear();
+    free_buffers_.push_back(std::move(buffer));
+    condition_.notify_all();
+  }
+}
+
+#ifdef SF2CUTE_HAS_POSIX_IO
+
+/// Constructs a new FileDescriptorOutputSink using the specified file descriptor.
+FileDescriptorOutputSink::FileDescriptorOutputSink(int fd, size_type buffer_size) :
+    fd_(fd),
+    buffer_(buffer_size != 0 ? buffer_size : 1),
+    buffer_length_(0),
+    position_(0) {
+}
+
+/// Destructs the FileDescriptorOutputSink, and writes the buffered bytes.
+FileDescriptorOutputSink::~FileDescriptorOutputSink() {
+  try {
+    Flush();
+  }
+  catch (const std::exception &) {
+    // Destructors must not throw.
+  }
+}
+
+/// Writes a sequence of bytes.
+void FileDescriptorOutputSink::Write(const void * data, size_type size) {
+  const char * bytes = static_cast<const char *>(data);
+  position_ += size;
+
+  // Fill the buffer if the bytes fit in it.
+  if (buffer_length_ + size <= buffer_.size()) {
+    memcpy(&buffer_[buffer_length_], bytes, size);
+    buffer_length_ += size;
+    return;
+  }
+
+  // Otherwise, write the buffered bytes and then the given bytes directly.
+  Flush();
+  if (size < buffer_.size()) {
+    memcpy(buffer_.data(), bytes, size);
+    buffer_length_ = size;
+  }
+  else {
+    WriteAll(fd_, bytes, size);
+  }
+}
+
+/// Writes all buffered bytes to the underlying destination.
+void FileDescriptorOutputSink::Flush() {
+  if (buffer_length_ != 0) {
+    const size_type length = buffer_length_;
+    buffer_length_ = 0;
+    WriteAll(fd_, buffer_.data(), length);
+  }
+}
+
+/// Writes a sequence of bytes read from a file.
+void FileDescriptorOutputSink::WriteFromFile(int fd, uint64_t offset, size_type size) {
+  // Keep the order of the bytes, since the kernel writes at the file offset.
+  Flush();
+
+  const size_type copied = CopyFileData(fd, offset, fd_, nullptr, size);
+  position_ += copied;
+  if (copied != size) {
+    OutputSink::WriteFromFile(fd, offset + copied, size - copied);
+  }
+}
+
+/// Constructs a new DirectFileOutputSink using the specified file descriptor.
+DirectFileOutputSink::DirectFileOutputSink(int fd, size_type buffer_size) :
+    fd_(fd),
+    direct_(false),
+    buffer_(nullptr),
+    buffer_size_(std::max<size_type>((buffer_size + kAlignment - 1) / kAlignment, 1) * kAlignment),
+    buffer_length_(0),
+    position_(0) {
+#ifdef O_DIRECT
+  const int flags = ::fcntl(fd, F_GETFL);
+  direct_ = (flags != -1 && (flags & O_DIRECT) != 0);
+#endif
+
+  // Align the buffer to the page boundary, as direct I/O requires.
+  storage_.resize(buffer_size_ + kAlignment);
+  const uintptr_t address = reinterpret_cast<uintptr_t>(storage_.data());
+  buffer_ = storage_.data() + (kAlignment - address % kAlignment) % kAlignment;
+}
+
+/// Destructs the DirectFileOutputSink, and writes the buffered bytes.
+DirectFileOutputSink::~DirectFileOutputSink() {
+  try {
+    Flush();
+  }
+  catch (const std::exception &) {
+    // Destructors must not throw.
+  }
+}
+
+/// Writes a sequence of bytes.
+void DirectFileOutputSink::Write(const void * data, size_type size) {
+  const char * bytes = static_cast<const char *>(data);
+  position_ += size;
+
+  // Every write goes through the aligned buffer, since the given bytes are not aligned.
+  while (size != 0) {
+    const size_type length = std::min(size, buffer_size_ - buffer_length_);
+    memcpy(buffer_ + buffer_length_, bytes, length);
+    buffer_length_ += length;
+    bytes += length;
+    size -= length;
+
+    if (buffer_length_ == buffer_size_) {
+      buffer_length_ = 0;
+      WriteBlock(buffer_, buffer_size_);
+    }
+  }
+}
+
+/// Writes all buffered bytes to the file.
+void DirectFileOutputSink::Flush() {
+  if (buffer_length_ == 0) {
+    return;
+  }
+
+  const size_type length = buffer_length_;
+  const size_type aligned_length = length - length % kAlignment;
+  buffer_length_ = 0;
+
+  if (aligned_length != 0) {
+    WriteBlock(buffer_, aligned_length);
+  }
+  if (aligned_length != length) {
+    DisableDirectIO();
+    WriteBlock(buffer_ + aligned_length, length - aligned_length);
+  }
+}
+
+/// Writes bytes to the file, falling back to the page cache if direct I/O is refused.
+void DirectFileOutputSink::WriteBlock(const char * data, size_type size) {
+  while (size != 0) {
+    const ssize_t written = ::write(fd_, data, size);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EINVAL && direct_) {
+        // The file system does not accept the alignment. Retry through the page cache.
+        DisableDirectIO();
+        continue;
+      }
+      ThrowSystemError("Could not write to the file");
+    }
+    data += written;
+    size -= size_type(written);
+  }
+}
+
+/// Turns direct I/O off for the file descriptor.
+void DirectFileOutputSink::DisableDirectIO() {
+  if (!direct_) {
+    return;
+  }
+
+#ifdef O_DIRECT
+  const int flags = ::fcntl(fd_, F_GETFL);
+  if (flags == -1 || ::fcntl(fd_, F_SETFL, flags & ~O_DIRECT) == -1) {
+    ThrowSystemError("Could not turn off direct I/O");
+  }
+#endif
+  direct_ = false;
+}
+
+/// Constructs a new PositionalFileOutputSink using the specified file descriptor.
+PositionalFileOutputSink::PositionalFileOutputSink(int fd, uint64_t offset,
+    size_type buffer_size) :
+    fd_(fd),
+    offset_(offset),
+    buffer_(buffer_size != 0 ? buffer_size : 1),
+    buffer_length_(0),
+    position_(0) {
+}
+
+/// Destructs the PositionalFileOutputSink, and writes the buffered bytes.
+PositionalFileOutputSink::~PositionalFileOutputSink() {
+  try {
+    Flush();
+  }
+  catch (const std::exception &) {
+    // Destructors must not throw.
+  }
+}
+
+/// Writes a sequence of bytes.
+void PositionalFileOutputSink::Write(const void * data, size_type size) {
+  const char * bytes = static_cast<const char *>(data);
+
+  // Fill the buffer if the bytes fit in it.
+  if (buffer_length_ + size <= buffer_.size()) {
+    memcpy(&buffer_[buffer_length_], bytes, size);
+    buffer_length_ += size;
+    position_ += size;
+    return;
+  }
+
+  // Otherwise, write the buffered bytes and then the given bytes directly.
+  Flush();
+  if (size < buffer_.size()) {
+    memcpy(buffer_.data(), bytes, size);
+    buffer_length_ = size;
+  }
+  else {
+    PWriteAll(fd_, bytes, size, offset_ + position_);
+  }
+  position_ += size;
+}
+
+/// Writes a sequence of bytes read from a file.
+void PositionalFileOutputSink::WriteFromFile(int fd, uint64_t offset, size_type size) {
+  Flush();
+
+  const uint64_t out_offset = offset_ + position_;
+  const size_type copied = CopyFileData(fd, offset, fd_, &out_offset, size);
+  position_ += copied;
+  if (copied != size) {
+    OutputSink::WriteFromFile(fd, offset + copied, size - copied);
+  }
+}
+
+/// Writes all buffered bytes to the underlying destination.
+void PositionalFileOutputSink::Flush() {
+  if (buffer_length_ != 0) {
+    const size_type length = buffer_length_;
+    buffer_length_ = 0;
+    PWriteAll(fd_, buffer_.data(), length, offset_ + position_ - length);
+  }
+}
+
+#endif // SF2CUTE_HAS_POSIX_IO
+
+} // namespace sf2cute
@@ -0,0 +1,236 @@
+/// @file
+/// Packed record templates.
+///
+/// The packed record templates describe the binary layout of the fixed-size
+/// records of the SoundFont hydra chunks, so that each field is stored at an offset
+/// known at compile time.
+///
+/// @author gocha <https://github.com/gocha>
+
+#ifndef SF2CUTE_PACKED_RECORD_HPP_
+#define SF2CUTE_PACKED_RECORD_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <type_traits>
+
+namespace sf2cute {
+
+/// The PackedIntField class template describes a little-endian integer field of a packed record.
+/// @tparam Offset the offset of the field from the beginning of the record, in terms of bytes.
+/// @tparam T the integer type of the field.
+template <size_t Offset, typename T>
+struct PackedIntField {
+  static_assert(std::is_integral<T>::value, "T must be an integer type.");
+
+  /// The offset of the field from the beginning of the record, in terms of bytes.
+  static constexpr size_t kOffset = Offset;
+
+  /// The size of the field, in terms of bytes.
+  static constexpr size_t kSize = sizeof(T);
+
+  /// The offset next to the end of the field, in terms of bytes.
+  static constexpr size_t kEnd = Offset + sizeof(T);
+
+  /// Stores a value to the field.
+  /// @param record the pointer to the beginning of the record.
+  /// @param value the value to be stored.
+  static void Store(char * record, T value) noexcept {
+    using UnsignedT = typename std::make_unsigned<T>::type;
+    const UnsignedT bits = static_cast<UnsignedT>(value);
+    for (size_t index = 0; index < sizeof(T); index++) {
+      record[Offset + index] = static_cast<char>((bits >> (8 * index)) & 0xff);
+    }
+  }
+
+  /// Loads the value of the field.
+  /// @param record the pointer to the beginning of the record.
+  /// @return the value of the field.
+  static T Load(const char * record) noexcept {
+    using UnsignedT = typename std::make_unsigned<T>::type;
+    UnsignedT bits = 0;
+    for (size_t index = 0; index < sizeof(T); index++) {
+      bits |= static_cast<UnsignedT>(static_cast<UnsignedT>(
+        static_cast<uint8_t>(record[Offset + index])) << (8 * index));
+    }
+    return static_cast<T>(bits);
+  }
+};
+
+/// The PackedStringField class template describes a zero-terminated fixed-length string field of a packed record.
+/// @tparam Offset the offset of the field from the beginning of the record, in terms of bytes.
+/// @tparam Length the length of the field including the terminator, in terms of bytes.
+template <size_t Offset, size_t Length>
+struct PackedStringField {
+  static_assert(Length != 0, "Length must include the terminator.");
+
+  /// The offset of the field from the beginning of the record, in terms of bytes.
+  static constexpr size_t kOffset = Offset;
+
+  /// The size of the field, in terms of bytes.
+  static constexpr size_t kSize = Length;
+
+  /// The offset next to the end of the field, in terms of bytes.
+  static constexpr size_t kEnd = Offset + Length;
+
+  /// Stores a string to the field.
+  ///
+  /// The string is truncated to Length - 1 characters, and the rest of the field is filled with zeros.
+  /// @param record the pointer to the beginning of the record.
+  /// @param value the string to be stored.
+  /// @param stop_at_null true to end the string at its first null character, if any,
+  /// so that the bytes after it are zeros as well.
+  static void Store(char * record, const std::string & value, bool stop_at_null = false) noexcept {
+    const size_t length = std::min(stop_at_null ? std::min(value.size(), value.find('\0')) : value.size(),
+      Length - 1);
+    memcpy(record + Offset, value.data(), length);
+    memset(record + Offset + length, 0, Length - length);
+  }
+
+  /// Loads the string of the field.
+  ///
+  /// The string ends at the first null character, or at the end of the field if it has none.
+  /// @param record the pointer to the beginning of the record.
+  /// @return the string of the field.
+  static std::string Load(const char * record) {
+    const char * field = record + Offset;
+    return std::string(field, std::find(field, field + Length, '\0'));
+  }
+
+  /// Loads the string of the field into an existing string, reusing its storage.
+  ///
+  /// The string ends at the first null character, or at the end of the field if it has none.
+  /// @param record the pointer to the beginning of the record.
+  /// @param value the string that receives the string of the field.
+  static void Load(const char * record, std::string & value) {
+    const char * field = record + Offset;
+    value.assign(field, std::find(field, field + Length, '\0'));
+  }
+};
+
+/// The SFPresetHeaderRecord struct describes the layout of struct sfPresetHeader (phdr item).
+struct SFPresetHeaderRecord {
+  /// char achPresetName[20];
+  using PresetName = PackedStringField<0, 20>;
+
+  /// uint16_t wPreset;
+  using Preset = PackedIntField<PresetName::kEnd, uint16_t>;
+
+  /// uint16_t wBank;
+  using Bank = PackedIntField<Preset::kEnd, uint16_t>;
+
+  /// uint16_t wPresetBagNdx;
+  using PresetBagIndex = PackedIntField<Bank::kEnd, uint16_t>;
+
+  /// uint32_t dwLibrary;
+  using Library = PackedIntField<PresetBagIndex::kEnd, uint32_t>;
+
+  /// uint32_t dwGenre;
+  using Genre = PackedIntField<Library::kEnd, uint32_t>;
+
+  /// uint32_t dwMorphology;
+  using Morphology = PackedIntField<Genre::kEnd, uint32_t>;
+
+  /// The size of the record, in terms of bytes.
+  static constexpr size_t kSize = Morphology::kEnd;
+};
+
+/// The SFBagRecord struct describes the layout of struct sfPresetBag and sfInstBag (pbag and ibag items).
+struct SFBagRecord {
+  /// uint16_t wGenNdx;
+  using GeneratorIndex = PackedIntField<0, uint16_t>;
+
+  /// uint16_t wModNdx;
+  using ModulatorIndex = PackedIntField<GeneratorIndex::kEnd, uint16_t>;
+
+  /// The size of the record, in terms of bytes.
+  static constexpr size_t kSize = ModulatorIndex::kEnd;
+};
+
+/// The SFModListRecord struct describes the layout of struct sfModList and sfInstModList (pmod and imod items).
+struct SFModListRecord {
+  /// SFModulator sfModSrcOper;
+  using SourceOp = PackedIntField<0, uint16_t>;
+
+  /// SFGenerator sfModDestOper;
+  using DestinationOp = PackedIntField<SourceOp::kEnd, uint16_t>;
+
+  /// int16_t modAmount;
+  using Amount = PackedIntField<DestinationOp::kEnd, int16_t>;
+
+  /// SFModulator sfModAmtSrcOper;
+  using AmountSourceOp = PackedIntField<Amount::kEnd, uint16_t>;
+
+  /// SFTransform sfModTransOper;
+  using TransformOp = PackedIntField<AmountSourceOp::kEnd, uint16_t>;
+
+  /// The size of the record, in terms of bytes.
+  static constexpr size_t kSize = TransformOp::kEnd;
+};
+
+/// The SFGenListRecord struct describes the layout of struct sfGenList and sfInstGenList (pgen and igen items).
+struct SFGenListRecord {
+  /// SFGenerator sfGenOper;
+  using Op = PackedIntField<0, uint16_t>;
+
+  /// GenAmountType genAmount;
+  using Amount = PackedIntField<Op::kEnd, uint16_t>;
+
+  /// The size of the record, in terms of bytes.
+  static constexpr size_t kSize = Amount::kEnd;
+};
+
+/// The SFInstRecord struct describes the layout of struct sfInst (inst item).
+struct SFInstRecord {
+  /// char achInstName[20];
+  using InstName = PackedStringField<0, 20>;
+
+  /// uint16_t wInstBagNdx;
+  using InstBagIndex = PackedIntField<InstName::kEnd, uint16_t>;
+
+  /// The size of the record, in terms of bytes.
+  static constexpr size_t kSize = InstBagIndex::kEnd;
+};
+
+/// The SFSampleRecord struct describes the layout of struct sfSample (shdr item).
+struct SFSampleRecord {
+  /// char achSampleName[20];
+  using SampleName = PackedStringField<0, 20>;
+
+  /// uint32_t dwStart;
+  using Start = PackedIntField<SampleName::kEnd, uint32_t>;
+
+  /// uint32_t dwEnd;
+  using End = PackedIntField<Start::kEnd, uint32_t>;
+
+  /// uint32_t dwStartloop;
+  using StartLoop = PackedIntField<End::kEnd, uint32_t>;
+
+  /// uint32_t dwEndloop;
+  using EndLoop = PackedIntField<StartLoop::kEnd, uint32_t>;
+
+  /// uint32_t dwSampleRate;
+  using SampleRate = PackedIntField<EndLoop::kEnd, uint32_t>;
+
+  /// uint8_t byOriginalKey;
+  using OriginalKey = PackedIntField<SampleRate::kEnd, uint8_t>;
+
+  /// int8_t chCorrection;
+  using Correction = PackedIntField<OriginalKey::kEnd, int8_t>;
+
+  /// uint16_t wSampleLink;
+  using SampleLink = PackedIntField<Correction::kEnd, uint16_t>;
+
+  /// SFSampleLink sfSampleType;
+  using SampleType = PackedIntField<SampleLink::kEnd, uint16_t>;
+
+  /// The size of the record, in terms of bytes.
+  static constexpr size_t kSize = SampleType::kEnd;
+};
+
+} // namespace sf2cute
+
+#endif // SF2CUTE_PACKED_RECORD_HPP_
@@ -0,0 +1,81 @@
+/// @file
+/// Parallel loop helper implementation.
+///
+/// @author gocha <https://github.com/gocha>
+
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sf2cute {
+
+/// Returns the number of threads that the hardware can run concurrently.
+unsigned HardwareThreadCount() noexcept {
+  return std::max(1u, std::thread::hardware_concurrency());
+}
+
+/// Runs a function for every index in [0, count) on a group of worker threads.
+void ParallelFor(size_t count, unsigned num_threads,
+    const std::function<void(size_t)> & body) {
+  if (num_threads == 0) {
+    num_threads = HardwareThreadCount();
+  }
+  num_threads = unsigned(std::min<size_t>(num_threads, count));
+
+  // Run the loop on the calling thread if there is nothing to share.
+  if (num_threads <= 1) {
+    for (size_t index = 0; index < count; index++) {
+      body(index);
+    }
+    return;
+  }
+
+  std::atomic<size_t> next_index(0);
+  std::exception_ptr first_exception;
+  std::mutex exception_mutex;
+
+  auto worker = [&]() {
+    size_t index;
+    while ((index = next_index.fetch_add(1)) < count) {
+      try {
+        body(index);
+      }
+      catch (...) {
+        std::lock_guard<std::mutex> lock(exception_mutex);
+        if (!first_exception) {
+          first_exception = std::current_exception();
+        }
+        // Let the other threads run out of work.
+        next_index = count;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(num_threads - 1);
+  try {
+    for (unsigned thread_index = 1; thread_index < num_threads; thread_index++) {
+      threads.emplace_back(worker);
+    }
+  }
+  catch (...) {
+    // Could not start a thread. Continue with the threads already running.
+  }
+
+  worker();
+  for (auto & thread : threads) {
+    thread.join();
+  }
+
+  if (first_exception) {
+    std::rethrow_exception(first_exception);
+  }
+}
+
+} // namespace sf2cute
@@ -0,0 +1,33 @@
+/// @file
+/// Parallel loop helper header.
+///
+/// @author gocha <https://github.com/gocha>
+
+#ifndef SF2CUTE_PARALLEL_HPP_
+#define SF2CUTE_PARALLEL_HPP_
+
+#include <stddef.h>
+#include <functional>
+
+namespace sf2cute {
+
+/// Returns the number of threads that the hardware can run concurrently.
+/// @return the number of hardware threads, at least 1.
+unsigned HardwareThreadCount() noexcept;
+
+/// Runs a function for every index in [0, count) on a group of worker threads.
+///
+/// The calling thread takes part in the work, and the indices are handed
+/// out one at a time, so that uneven work items are balanced.
+/// @param count the number of indices.
+/// @param num_threads the maximum number of threads, including the calling thread.
+/// 0 means HardwareThreadCount().
+/// @param body the function to be called with each index.
+/// @throws any exception thrown by body. If more than one call throws,
+/// the first one is rethrown after every thread has finished.
+void ParallelFor(size_t count, unsigned num_threads,
+    const std::function<void(size_t)> & body);
+
+} // namespace sf2cute
+
+#endif // SF2CUTE_PARALLEL_HPP_
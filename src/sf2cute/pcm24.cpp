@@ -0,0 +1,87 @@
+/// @file
+/// 24-bit PCM conversion functions implementation.
+///
+/// @author gocha <https://github.com/gocha>
+
+#include "pcm24.hpp"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+namespace sf2cute {
+
+/// Splits 24-bit data points stored in 32-bit integers into the upper 16 bits and the lower 8 bits.
+void SplitInt24Samples(const int32_t * data, size_t length,
+    int16_t * high_words, uint8_t * low_bytes) noexcept {
+  size_t index = 0;
+
+#if defined(__SSE2__)
+  // The shifted values fit in 16 bits, and the masked values fit in 8 bits,
+  // so the saturating packs never saturate.
+  const __m128i low_byte_mask = _mm_set1_epi32(0xff);
+  for (; index + 16 <= length; index += 16) {
+    const __m128i x0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&data[index]));
+    const __m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&data[index + 4]));
+    const __m128i x2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&data[index + 8]));
+    const __m128i x3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&data[index + 12]));
+
+    const __m128i high01 = _mm_packs_epi32(_mm_srai_epi32(x0, 8), _mm_srai_epi32(x1, 8));
+    const __m128i high23 = _mm_packs_epi32(_mm_srai_epi32(x2, 8), _mm_srai_epi32(x3, 8));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(&high_words[index]), high01);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(&high_words[index + 8]), high23);
+
+    const __m128i low01 = _mm_packs_epi32(
+      _mm_and_si128(x0, low_byte_mask), _mm_and_si128(x1, low_byte_mask));
+    const __m128i low23 = _mm_packs_epi32(
+      _mm_and_si128(x2, low_byte_mask), _mm_and_si128(x3, low_byte_mask));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(&low_bytes[index]), _mm_packus_epi16(low01, low23));
+  }
+#endif
+
+  for (; index < length; index++) {
+    high_words[index] = int16_t(data[index] >> 8);
+    low_bytes[index] = uint8_t(data[index] & 0xff);
+  }
+}
+
+/// Splits packed 24-bit little-endian data points into the upper 16 bits and the lower 8 bits.
+void SplitPackedInt24LSamples(const void * data, size_t length,
+    int16_t * high_words, uint8_t * low_bytes) noexcept {
+  const uint8_t * bytes = static_cast<const uint8_t *>(data);
+  size_t index = 0;
+
+#if defined(__SSSE3__)
+  // Each 16-byte load covers 4 data points (12 bytes), and the loads never cross the end of the data.
+  const __m128i high_word_shuffle = _mm_setr_epi8(1, 2, 4, 5, 7, 8, 10, 11,
+    -1, -1, -1, -1, -1, -1, -1, -1);
+  const __m128i low_byte_shuffle = _mm_setr_epi8(0, 3, 6, 9,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+  for (; 3 * index + 28 <= 3 * length; index += 8) {
+    const __m128i x0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&bytes[3 * index]));
+    const __m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&bytes[3 * index + 12]));
+
+    const __m128i high = _mm_unpacklo_epi64(
+      _mm_shuffle_epi8(x0, high_word_shuffle), _mm_shuffle_epi8(x1, high_word_shuffle));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(&high_words[index]), high);
+
+    const __m128i low = _mm_unpacklo_epi32(
+      _mm_shuffle_epi8(x0, low_byte_shuffle), _mm_shuffle_epi8(x1, low_byte_shuffle));
+    _mm_storel_epi64(reinterpret_cast<__m128i *>(&low_bytes[index]), low);
+  }
+#endif
+
+  for (; index < length; index++) {
+    const uint8_t * point = &bytes[3 * index];
+    low_bytes[index] = point[0];
+    high_words[index] = int16_t(uint16_t(point[1] | (point[2] << 8)));
+  }
+}
+
+} // namespace sf2cute
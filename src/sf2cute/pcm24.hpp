@@ -0,0 +1,36 @@
+/// @file
+/// 24-bit PCM conversion functions header.
+///
+/// @author gocha <https://github.com/gocha>
+
+#ifndef SF2CUTE_PCM24_HPP_
+#define SF2CUTE_PCM24_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace sf2cute {
+
+/// Splits 24-bit data points stored in 32-bit integers into the upper 16 bits and the lower 8 bits.
+///
+/// Both planes are filled in one streaming pass, 16 data points at a time where SSE2 is available.
+/// @param data the data points, each of which must be within the signed 24-bit range.
+/// @param length the number of data points.
+/// @param high_words the destination of the upper 16 bits of each data point (smpl plane).
+/// @param low_bytes the destination of the lower 8 bits of each data point (sm24 plane).
+void SplitInt24Samples(const int32_t * data, size_t length,
+    int16_t * high_words, uint8_t * low_bytes) noexcept;
+
+/// Splits packed 24-bit little-endian data points into the upper 16 bits and the lower 8 bits.
+///
+/// Both planes are filled in one streaming pass, 8 data points at a time where SSSE3 is available.
+/// @param data the data points, each of which is 3 bytes long.
+/// @param length the number of data points.
+/// @param high_words the destination of the upper 16 bits of each data point (smpl plane).
+/// @param low_bytes the destination of the lower 8 bits of each data point (sm24 plane).
+void SplitPackedInt24LSamples(const void * data, size_t length,
+    int16_t * high_words, uint8_t * low_bytes) noexcept;
+
+} // namespace sf2cute
+
+#endif // SF2CUTE_PCM24_HPP_
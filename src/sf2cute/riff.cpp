@@ -8,17 +8,26 @@
 #include "riff.hpp"
 
 #include <stdint.h>
+#include <algorithm>
+#include <array>
 #include <memory>
 #include <string>
 #include <vector>
-#include <ostream>
 #include <sstream>
 #include <stdexcept>
 
 #include "byteio.hpp"
+#include "parallel.hpp"
 
 namespace sf2cute {
 
+/// Splits this chunk into byte ranges that can be written independently.
+void RIFFChunkInterface::GetWriteRanges(size_type offset,
+    std::vector<RIFFWriteRange> & ranges) const {
+  ranges.push_back(RIFFWriteRange{offset, size(),
+    [this](OutputSink & out) { Write(out); }});
+}
+
 /// Constructs a new empty RIFFChunk.
 RIFFChunk::RIFFChunk() :
     name_("    ") {
@@ -48,36 +57,20 @@ void RIFFChunk::set_name(std::string name) {
   name_ = std::move(name);
 }
 
-/// Writes this chunk to the specified output stream.
-void RIFFChunk::Write(std::ostream & out) const {
-  // Save exception bits of output stream.
-  const std::ios_base::iostate old_exception_bits = out.exceptions();
-  // Set exception bits to get output error as an exception.
-  out.exceptions(std::ios::badbit | std::ios::failbit);
-
-  try {
-    // Write the chunk header.
-    WriteHeader(out, name(), data_.size());
+/// Writes this chunk to the specified output sink.
+void RIFFChunk::Write(OutputSink & out) const {
+  // Write the chunk header.
+  WriteHeader(out, name(), data_.size());
 
-    // Write the chunk data.
-    out.write(reinterpret_cast<const char *>(data_.data()), data_.size());
+  // Write the chunk data.
+  out.Write(data_.data(), data_.size());
 
-    // Write a padding byte if necessary.
-    if (data_.size() % 2 != 0) {
-      InsertInt8(out, 0);
-    }
-  }
-  catch (const std::exception &) {
-    // Recover exception bits of output stream.
-    out.exceptions(old_exception_bits);
-
-    // Rethrow the exception.
-    throw;
-  }
+  // Write a padding byte if necessary.
+  WritePadding(out, data_.size());
 }
 
-/// Writes a chunk header to the specified output stream.
-void RIFFChunk::WriteHeader(std::ostream & out,
+/// Writes a chunk header to the specified output sink.
+void RIFFChunk::WriteHeader(OutputSink & out,
     const std::string & name,
     size_type size) {
   // Throw exception if the chunk size exceeds the maximum.
@@ -87,34 +80,36 @@ void RIFFChunk::WriteHeader(std::ostream & out,
     throw std::length_error(message_builder.str());
   }
 
-  // Save exception bits of output stream.
-  const std::ios_base::iostate old_exception_bits = out.exceptions();
-  // Set exception bits to get output error as an exception.
-  out.exceptions(std::ios::badbit | std::ios::failbit);
+  std::array<char, 8> header;
 
-  try {
-    // Write the chunk name.
-    out.write(name.data(), name.size());
+  // Write the chunk name.
+  auto header_it = std::copy(name.begin(), name.end(), header.begin());
 
-    // Write the chunk size.
-    InsertInt32L(out, static_cast<uint32_t>(size));
-  }
-  catch (const std::exception &) {
-    // Recover exception bits of output stream.
-    out.exceptions(old_exception_bits);
+  // Write the chunk size.
+  WriteInt32L(header_it, static_cast<uint32_t>(size));
 
-    // Rethrow the exception.
-    throw;
+  out.Write(header.data(), header.size());
+}
+
+/// Writes a padding byte to the specified output sink if the chunk data size is odd.
+void RIFFChunk::WritePadding(OutputSink & out, size_type size) {
+  if (size % 2 != 0) {
+    const char padding = 0;
+    out.Write(&padding, 1);
   }
 }
 
 /// Constructs a new empty RIFFListChunk.
 RIFFListChunk::RIFFListChunk() :
-    name_("    ") {
+    name_("    "),
+    size_(0),
+    num_threads_(1) {
 }
 
 /// Constructs a new empty RIFFListChunk using the specified list type.
-RIFFListChunk::RIFFListChunk(std::string name) {
+RIFFListChunk::RIFFListChunk(std::string name) :
+    size_(0),
+    num_threads_(1) {
   set_name(std::move(name));
 }
 
@@ -133,27 +128,67 @@ void RIFFListChunk::set_name(std::string name) {
 
 /// Appends the specified RIFFChunkInterface to this chunk.
 void RIFFListChunk::AddSubchunk(std::unique_ptr<RIFFChunkInterface> && subchunk) {
+  size_ += subchunk->size();
   subchunks_.push_back(std::move(subchunk));
 }
 
 /// Removes all subchunks from this chunk.
 void RIFFListChunk::ClearSubchunks() {
   subchunks_.clear();
+  size_ = 0;
 }
 
-/// Writes this chunk to the specified output stream.
-void RIFFListChunk::Write(std::ostream & out) const {
+/// Recomputes the cached length of this chunk from its subchunks.
+void RIFFListChunk::UpdateSize() noexcept {
+  size_ = 0;
+  for (const auto & subchunk : subchunks_) {
+    size_ += subchunk->size();
+  }
+}
+
+/// Writes this chunk to the specified output sink.
+void RIFFListChunk::Write(OutputSink & out) const {
   // Write the chunk header.
   WriteHeader(out, name(), size() - 8);
 
-  // Write each subchunks.
+  if (num_threads_ == 1 || subchunks_.size() <= 1) {
+    // Write each subchunks.
+    for (const auto & subchunk : subchunks_) {
+      subchunk->Write(out);
+    }
+    return;
+  }
+
+  // Serialize each subchunks into its own buffer concurrently.
+  std::vector<MemoryOutputSink> buffers(subchunks_.size());
+  ParallelFor(subchunks_.size(), num_threads_, [&](size_t index) {
+    buffers[index].Reserve(subchunks_[index]->size());
+    subchunks_[index]->Write(buffers[index]);
+  });
+
+  // Write the buffers in order.
+  for (const auto & buffer : buffers) {
+    out.Write(buffer.data().data(), buffer.data().size());
+  }
+}
+
+/// Splits this chunk into its header and the write ranges of each subchunks.
+void RIFFListChunk::GetWriteRanges(size_type offset,
+    std::vector<RIFFWriteRange> & ranges) const {
+  // The chunk header.
+  ranges.push_back(RIFFWriteRange{offset, 12,
+    [this](OutputSink & out) { WriteHeader(out, name(), size() - 8); }});
+  offset += 12;
+
+  // Each subchunks.
   for (const auto & subchunk : subchunks_) {
-    subchunk->Write(out);
+    subchunk->GetWriteRanges(offset, ranges);
+    offset += subchunk->size();
   }
 }
 
-/// Writes a "LIST" chunk header to the specified output stream.
-void RIFFListChunk::WriteHeader(std::ostream & out,
+/// Writes a "LIST" chunk header to the specified output sink.
+void RIFFListChunk::WriteHeader(OutputSink & out,
     const std::string & name,
     size_type size) {
   // Throw exception if the chunk size exceeds the maximum.
@@ -163,37 +198,29 @@ void RIFFListChunk::WriteHeader(std::ostream & out,
     throw std::length_error(message_builder.str());
   }
 
-  // Save exception bits of output stream.
-  const std::ios_base::iostate old_exception_bits = out.exceptions();
-  // Set exception bits to get output error as an exception.
-  out.exceptions(std::ios::badbit | std::ios::failbit);
+  std::array<char, 12> header;
 
-  try {
-    // Write the chunk ID "LIST".
-    out.write("LIST", 4);
+  // Write the chunk ID "LIST".
+  auto header_it = std::copy_n("LIST", 4, header.begin());
 
-    // Write the chunk size.
-    InsertInt32L(out, static_cast<uint32_t>(size));
+  // Write the chunk size.
+  header_it = WriteInt32L(header_it, static_cast<uint32_t>(size));
 
-    // Write the list type.
-    out.write(name.data(), name.size());
-  }
-  catch (const std::exception &) {
-    // Recover exception bits of output stream.
-    out.exceptions(old_exception_bits);
+  // Write the list type.
+  std::copy(name.begin(), name.end(), header_it);
 
-    // Rethrow the exception.
-    throw;
-  }
+  out.Write(header.data(), header.size());
 }
 
 /// Constructs a new empty RIFF.
 RIFF::RIFF() :
-    name_("    ") {
+    name_("    "),
+    size_(0) {
 }
 
 /// Constructs a new empty RIFF using the specified form type.
-RIFF::RIFF(std::string name) {
+RIFF::RIFF(std::string name) :
+    size_(0) {
   set_name(std::move(name));
 }
 
@@ -210,33 +237,44 @@ void RIFF::set_name(std::string name) {
   name_ = std::move(name);
 }
 
-/// Writes this RIFF to the specified output stream.
-void RIFF::Write(std::ostream & out) const {
-  // Save exception bits of output stream.
-  const std::ios_base::iostate old_exception_bits = out.exceptions();
-  // Set exception bits to get output error as an exception.
-  out.exceptions(std::ios::badbit | std::ios::failbit);
+/// Writes this RIFF to the specified output sink.
+void RIFF::Write(OutputSink & out) const {
+  // Write the RIFF header.
+  WriteHeader(out, name(), size() - 8);
 
-  try {
-    // Write the RIFF header.
-    WriteHeader(out, name(), size() - 8);
+  // Write each chunks.
+  for (const auto & chunk : chunks_) {
+    chunk->Write(out);
+  }
+}
 
-    // Write each chunks.
-    for (const auto & chunk : chunks_) {
-      chunk->Write(out);
-    }
+/// Recomputes the cached length of this RIFF from its chunks.
+void RIFF::UpdateSize() noexcept {
+  size_ = 0;
+  for (const auto & chunk : chunks_) {
+    size_ += chunk->size();
   }
-  catch (const std::exception &) {
-    // Recover exception bits of output stream.
-    out.exceptions(old_exception_bits);
+}
 
-    // Rethrow the exception.
-    throw;
+/// Splits this RIFF into byte ranges that can be written independently.
+std::vector<RIFFWriteRange> RIFF::GetWriteRanges() const {
+  std::vector<RIFFWriteRange> ranges;
+
+  // The RIFF header.
+  ranges.push_back(RIFFWriteRange{0, 12,
+    [this](OutputSink & out) { WriteHeader(out, name(), size() - 8); }});
+  size_type offset = 12;
+
+  // Each chunks.
+  for (const auto & chunk : chunks_) {
+    chunk->GetWriteRanges(offset, ranges);
+    offset += chunk->size();
   }
+  return ranges;
 }
 
-/// Writes a "RIFF" chunk header to the specified output stream.
-void RIFF::WriteHeader(std::ostream & out,
+/// Writes a "RIFF" chunk header to the specified output sink.
+void RIFF::WriteHeader(OutputSink & out,
     const std::string & name,
     size_type size) {
   // Throw exception if the RIFF file size exceeds the maximum.
@@ -244,28 +282,18 @@ void RIFF::WriteHeader(std::ostream & out,
     throw std::length_error("RIFF file size too large.");
   }
 
-  // Save exception bits of output stream.
-  const std::ios_base::iostate old_exception_bits = out.exceptions();
-  // Set exception bits to get output error as an exception.
-  out.exceptions(std::ios::badbit | std::ios::failbit);
+  std::array<char, 12> header;
 
-  try {
-    // Write the ID "RIFF".
-    out.write("RIFF", 4);
+  // Write the ID "RIFF".
+  auto header_it = std::copy_n("RIFF", 4, header.begin());
 
-    // Write the file size.
-    InsertInt32L(out, static_cast<uint32_t>(size));
+  // Write the file size.
+  header_it = WriteInt32L(header_it, static_cast<uint32_t>(size));
 
-    // Write the form type.
-    out.write(name.data(), name.size());
-  }
-  catch (const std::exception &) {
-    // Recover exception bits of output stream.
-    out.exceptions(old_exception_bits);
+  // Write the form type.
+  std::copy(name.begin(), name.end(), header_it);
 
-    // Rethrow the exception.
-    throw;
-  }
+  out.Write(header.data(), header.size());
 }
 
 } // namespace sf2cute
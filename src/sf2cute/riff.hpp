@@ -9,13 +9,17 @@
 #define SF2CUTE_RIFF_HPP_
 
 #include <algorithm>
+#include <functional>
 #include <memory>
 #include <string>
 #include <vector>
-#include <ostream>
+
+#include <sf2cute/output_sink.hpp>
 
 namespace sf2cute {
 
+struct RIFFWriteRange;
+
 /// The RIFFChunkInterface class represents an interface of RIFF chunk.
 class RIFFChunkInterface {
 public:
@@ -33,11 +37,38 @@ public:
   /// @return the length of this chunk including a chunk header, in terms of bytes.
   virtual size_type size() const noexcept = 0;
 
-  /// Writes this chunk to the specified output stream.
-  /// @param out the output stream.
+  /// Returns the number of items of this chunk, such as records or subchunks.
+  /// @return the number of items of this chunk, or 0 if the chunk has no items.
+  /// @remarks The default implementation returns 0.
+  virtual size_type num_items() const noexcept {
+    return 0;
+  }
+
+  /// Writes this chunk to the specified output sink.
+  /// @param out the output sink.
   /// @throws std::length_error The chunk size exceeds the maximum.
   /// @throws std::ios_base::failure An I/O error occurred.
-  virtual void Write(std::ostream & out) const = 0;
+  virtual void Write(OutputSink & out) const = 0;
+
+  /// Splits this chunk into byte ranges that can be written independently.
+  /// @param offset the absolute offset of this chunk in the file.
+  /// @param ranges the collection that the ranges are appended to, in file order.
+  /// @remarks The default implementation appends a single range that writes the whole chunk.
+  virtual void GetWriteRanges(size_type offset,
+      std::vector<RIFFWriteRange> & ranges) const;
+};
+
+/// The RIFFWriteRange struct represents a byte range of a RIFF file
+/// that can be written independently of the other ranges.
+struct RIFFWriteRange {
+  /// The absolute offset of the range in the file.
+  RIFFChunkInterface::size_type offset;
+
+  /// The length of the range, in terms of bytes.
+  RIFFChunkInterface::size_type size;
+
+  /// The function that writes exactly the bytes of the range to an output sink.
+  std::function<void(OutputSink &)> write;
 };
 
 /// The RIFFChunk class represents a RIFF chunk.
@@ -111,22 +142,28 @@ public:
     return 8 + chunk_size;
   }
 
-  /// Writes this chunk to the specified output stream.
-  /// @param out the output stream.
+  /// Writes this chunk to the specified output sink.
+  /// @param out the output sink.
   /// @throws std::length_error The chunk size exceeds the maximum.
   /// @throws std::ios_base::failure An I/O error occurred.
-  virtual void Write(std::ostream & out) const override;
+  virtual void Write(OutputSink & out) const override;
 
-  /// Writes a chunk header to the specified output stream.
-  /// @param out the output stream.
+  /// Writes a chunk header to the specified output sink.
+  /// @param out the output sink.
   /// @param name the name of the chunk (FourCC).
   /// @param size the length of the chunk data, in terms of bytes.
   /// @throws std::length_error The chunk size exceeds the maximum.
   /// @throws std::ios_base::failure An I/O error occurred.
-  static void WriteHeader(std::ostream & out,
+  static void WriteHeader(OutputSink & out,
       const std::string & name,
       size_type size);
 
+  /// Writes a padding byte to the specified output sink if the chunk data size is odd.
+  /// @param out the output sink.
+  /// @param size the length of the chunk data, in terms of bytes.
+  /// @throws std::ios_base::failure An I/O error occurred.
+  static void WritePadding(OutputSink & out, size_type size);
+
 private:
   /// The name of the chunk.
   std::string name_;
@@ -193,29 +230,61 @@ public:
   /// Removes all subchunks from this chunk.
   void ClearSubchunks();
 
+  /// Recomputes the cached length of this chunk from its subchunks.
+  ///
+  /// The length is cached when a subchunk is added or removed.
+  /// Call this function after a subchunk has been resized in place.
+  void UpdateSize() noexcept;
+
+  /// Returns the number of threads used to serialize the subchunks.
+  /// @return the number of threads used to serialize the subchunks.
+  unsigned num_threads() const noexcept {
+    return num_threads_;
+  }
+
+  /// Sets the number of threads used to serialize the subchunks.
+  ///
+  /// If more than one thread is used, the subchunks are serialized concurrently
+  /// into memory buffers, and the buffers are written in order.
+  /// The subchunks must be safe to serialize at the same time.
+  /// @param num_threads the number of threads. 1 serializes the subchunks
+  /// one after another on the calling thread, and 0 uses every hardware thread.
+  void set_num_threads(unsigned num_threads) noexcept {
+    num_threads_ = num_threads;
+  }
+
   /// Returns the whole length of this chunk.
   /// @return the length of this chunk including a chunk header, in terms of bytes.
+  /// @remarks The length is cached. See UpdateSize().
   virtual size_type size() const noexcept override {
-    size_type chunk_size = 0;
-    for (const auto & subchunk : subchunks_) {
-      chunk_size += subchunk->size();
-    }
-    return 12 + chunk_size;
+    return 12 + size_;
   }
 
-  /// Writes this chunk to the specified output stream.
-  /// @param out the output stream.
+  /// Returns the number of subchunks.
+  /// @return the number of subchunks.
+  virtual size_type num_items() const noexcept override {
+    return subchunks_.size();
+  }
+
+  /// Writes this chunk to the specified output sink.
+  /// @param out the output sink.
   /// @throws std::length_error The chunk size exceeds the maximum.
   /// @throws std::ios_base::failure An I/O error occurred.
-  virtual void Write(std::ostream & out) const override;
+  virtual void Write(OutputSink & out) const override;
+
+  /// Splits this chunk into its header and the write ranges of each subchunks.
+  /// @param offset the absolute offset of this chunk in the file.
+  /// @param ranges the collection that the ranges are appended to, in file order.
+  virtual void GetWriteRanges(size_type offset,
+      std::vector<RIFFWriteRange> & ranges) const override;
 
-  /// Writes a "LIST" chunk header to the specified output stream.
-  /// @param out the output stream.
+  /// Writes a "LIST" chunk header to the specified output sink.
+  /// @param out the output sink.
   /// @param name the list type of the chunk (FourCC).
   /// @param size the length of the chunk data, in terms of bytes.
   /// @throws std::length_error The chunk size exceeds the maximum.
   /// @throws std::ios_base::failure An I/O error occurred.
-  static void WriteHeader(std::ostream & out,
+  static void WriteHeader(OutputSink & out,
       const std::string & name,
       size_type size);
 
@@ -225,6 +294,12 @@ private:
 
   /// A collection of pointers to each RIFFChunkInterface objects.
   std::vector<std::unique_ptr<RIFFChunkInterface>> subchunks_;
+
+  /// The total length of the subchunks, in terms of bytes.
+  size_type size_;
+
+  /// The number of threads used to serialize the subchunks.
+  unsigned num_threads_;
 };
 
 /// The RIFF class represents a RIFF file.
@@ -280,37 +355,49 @@ public:
   /// Appends the specified RIFFChunkInterface to this RIFF.
   /// @param chunk a pointer to RIFFChunkInterface object.
   void AddChunk(std::unique_ptr<RIFFChunkInterface> && chunk) {
+    size_ += chunk->size();
     chunks_.push_back(std::move(chunk));
   }
 
   /// Removes all chunks from this RIFF.
   void ClearChunks() {
     chunks_.clear();
+    size_ = 0;
   }
 
+  /// Recomputes the cached length of this RIFF from its chunks.
+  ///
+  /// The length is cached when a chunk is added or removed.
+  /// Call this function after a chunk has been resized in place.
+  void UpdateSize() noexcept;
+
   /// Returns the whole length of this RIFF.
   /// @return the length of this RIFF including a chunk header, in terms of bytes.
+  /// @remarks The length is cached. See UpdateSize().
   size_type size() const noexcept {
-    size_type chunk_size = 0;
-    for (const auto & chunk : chunks_) {
-      chunk_size += chunk->size();
-    }
-    return 12 + chunk_size;
+    return 12 + size_;
   }
 
-  /// Writes this RIFF to the specified output stream.
-  /// @param out the output stream.
+  /// Writes this RIFF to the specified output sink.
+  /// @param out the output sink.
   /// @throws std::length_error The chunk size exceeds the maximum.
   /// @throws std::ios_base::failure An I/O error occurred.
-  void Write(std::ostream & out) const;
+  void Write(OutputSink & out) const;
+
+  /// Splits this RIFF into byte ranges that can be written independently.
+  ///
+  /// The offset of every range is known before any byte is written,
+  /// so the ranges can be written in any order, or at the same time.
+  /// @return the ranges that cover the whole RIFF, in file order.
+  std::vector<RIFFWriteRange> GetWriteRanges() const;
 
-  /// Writes a "RIFF" chunk header to the specified output stream.
-  /// @param out the output stream.
+  /// Writes a "RIFF" chunk header to the specified output sink.
+  /// @param out the output sink.
   /// @param name the form type of the chunk (FourCC).
   /// @param size the length of the chunk data, in terms of bytes.
   /// @throws std::length_error The chunk size exceeds the maximum.
   /// @throws std::ios_base::failure An I/O error occurred.
-  static void WriteHeader(std::ostream & out,
+  static void WriteHeader(OutputSink & out,
       const std::string & name,
       size_type size);
 
@@ -320,6 +407,9 @@ private:
 
   /// A collection of pointers to each RIFFChunkInterface objects.
   std::vector<std::unique_ptr<RIFFChunkInterface>> chunks_;
+
+  /// The total length of the chunks, in terms of bytes.
+  size_type size_;
 };
 
 } // namespace sf2cute
@@ -10,8 +10,8 @@
 #include <memory>
 #include <string>
 #include <vector>
-#include <ostream>
 
+#include "hydra_layout.hpp"
 #include "riff.hpp"
 
 namespace sf2cute {
@@ -30,11 +30,9 @@ public:
   /// Constructs a new empty SFRIFFIbagChunk.
   SFRIFFIbagChunk();
 
-  /// Constructs a new SFRIFFIbagChunk using the specified instruments.
-  /// @param instruments The instruments of the chunk.
-  /// @throws std::length_error Too many instrument zones.
-  SFRIFFIbagChunk(
-      const std::vector<std::shared_ptr<SFInstrument>> & instruments);
+  /// Constructs a new SFRIFFIbagChunk using the specified hydra layout.
+  /// @param layout the hydra layout of the chunk.
+  explicit SFRIFFIbagChunk(std::shared_ptr<const SFHydraLayout> layout);
 
   /// Constructs a new copy of specified SFRIFFIbagChunk.
   /// @param origin a SFRIFFIbagChunk object.
@@ -60,20 +58,23 @@ public:
     return "ibag";
   }
 
-  /// Returns the instruments of this chunk.
-  /// @return the instruments of this chunk.
-  const std::vector<std::shared_ptr<SFInstrument>> &
-      instruments() const {
-    return *instruments_;
+  /// Returns the hydra layout of this chunk.
+  /// @return the hydra layout of this chunk.
+  const SFHydraLayout & layout() const noexcept {
+    return *layout_;
   }
 
-  /// Sets the instruments of this chunk.
-  /// @param instruments the instruments of this chunk.
-  /// @throws std::length_error Too many instrument zones.
-  void set_instruments(
-      const std::vector<std::shared_ptr<SFInstrument>> & instruments) {
-    instruments_ = &instruments;
-    size_ = kItemSize * NumItems();
+  /// Sets the hydra layout of this chunk.
+  /// @param layout the hydra layout of this chunk.
+  void set_layout(std::shared_ptr<const SFHydraLayout> layout) {
+    layout_ = std::move(layout);
+    size_ = kItemSize * layout_->num_instrument_bag_items();
+  }
+
+  /// Returns the instruments of this chunk.
+  /// @return the instruments of this chunk.
+  const std::vector<std::shared_ptr<SFInstrument>> & instruments() const {
+    return layout_->instruments();
   }
 
   /// Returns the whole length of this chunk.
@@ -82,33 +83,33 @@ public:
     return 8 + size_;
   }
 
-  /// Writes this chunk to the specified output stream.
-  /// @param out the output stream.
+  /// Returns the number of items of this chunk.
+  /// @return the number of items, including the terminator item.
+  virtual size_type num_items() const noexcept override {
+    return size_ / kItemSize;
+  }
+
+  /// Writes this chunk to the specified output sink.
+  /// @param out the output sink.
   /// @throws std::length_error The chunk size exceeds the maximum.
   /// @throws std::ios_base::failure An I/O error occurred.
-  virtual void Write(std::ostream & out) const override;
+  virtual void Write(OutputSink & out) const override;
 
 private:
-  /// Returns the number of instrument zone items.
-  /// @return the number of instrument zone items, including the terminator item.
-  /// @throws std::length_error Too many instrument zones.
-  uint16_t NumItems() const;
-
-  /// Writes an item of ibag chunk.
-  /// @param out the output stream.
+  /// Fills an item of ibag chunk.
+  /// @param record the pointer to the item to be filled.
   /// @param generator_index the generator index starting from 0.
   /// @param modulator_index the modulator index starting from 0.
-  /// @return the output stream.
-  /// @throws std::ios_base::failure An I/O error occurred.
-  static std::ostream & WriteItem(std::ostream & out,
+  /// @return the pointer next to the filled item.
+  static char * WriteItem(char * record,
       uint16_t generator_index,
-      uint16_t modulator_index);
+      uint16_t modulator_index) noexcept;
 
   /// The size of the chunk (excluding header).
   size_type size_;
 
-  /// The instruments of the chunk.
-  const std::vector<std::shared_ptr<SFInstrument>> * instruments_;
+  /// The hydra layout of the chunk.
+  std::shared_ptr<const SFHydraLayout> layout_;
 };
 
 } // namespace sf2cute
@@ -10,17 +10,15 @@
 #include <memory>
 #include <string>
 #include <vector>
-#include <unordered_map>
-#include <ostream>
 
 #include <sf2cute/types.hpp>
 
+#include "hydra_layout.hpp"
 #include "riff.hpp"
 
 namespace sf2cute {
 
 class SFInstrument;
-class SFSample;
 class SFGeneratorItem;
 
 /// The SFRIFFIgenChunk class represents a SoundFont 2 "igen" chunk.
@@ -35,13 +33,9 @@ public:
   /// Constructs a new empty SFRIFFIgenChunk.
   SFRIFFIgenChunk();
 
-  /// Constructs a new SFRIFFIgenChunk using the specified instruments.
-  /// @param instruments The instruments of the chunk.
-  /// @param sample_index_map the map containing the samples as keys and their indices as map values.
-  /// @throws std::length_error Too many instrument generators.
-  SFRIFFIgenChunk(
-      const std::vector<std::shared_ptr<SFInstrument>> & instruments,
-      std::unordered_map<const SFSample *, uint16_t> sample_index_map);
+  /// Constructs a new SFRIFFIgenChunk using the specified hydra layout.
+  /// @param layout the hydra layout of the chunk.
+  explicit SFRIFFIgenChunk(std::shared_ptr<const SFHydraLayout> layout);
 
   /// Constructs a new copy of specified SFRIFFIgenChunk.
   /// @param origin a SFRIFFIgenChunk object.
@@ -67,34 +61,23 @@ public:
     return "igen";
   }
 
-  /// Returns the instruments of this chunk.
-  /// @return the instruments of this chunk.
-  const std::vector<std::shared_ptr<SFInstrument>> &
-      instruments() const {
-    return *instruments_;
-  }
-
-  /// Sets the instruments of this chunk.
-  /// @param instruments the instruments of this chunk.
-  /// @throws std::length_error Too many instrument generators.
-  void set_instruments(
-      const std::vector<std::shared_ptr<SFInstrument>> & instruments) {
-    instruments_ = &instruments;
-    size_ = kItemSize * NumItems();
+  /// Returns the hydra layout of this chunk.
+  /// @return the hydra layout of this chunk.
+  const SFHydraLayout & layout() const noexcept {
+    return *layout_;
   }
 
-  /// Returns the map containing the samples as keys and their indices as map values.
-  /// @return the map containing the samples as keys and their indices as map values.
-  const std::unordered_map<const SFSample *, uint16_t> &
-      sample_index_map() const {
-    return sample_index_map_;
+  /// Sets the hydra layout of this chunk.
+  /// @param layout the hydra layout of this chunk.
+  void set_layout(std::shared_ptr<const SFHydraLayout> layout) {
+    layout_ = std::move(layout);
+    size_ = kItemSize * layout_->num_instrument_generator_items();
   }
 
-  /// Sets the map containing the samples as keys and their indices as map values.
-  /// @param sample_index_map the map containing the samples as keys and their indices as map values.
-  void set_sample_index_map(
-      std::unordered_map<const SFSample *, uint16_t> sample_index_map) {
-    sample_index_map_ = std::move(sample_index_map);
+  /// Returns the instruments of this chunk.
+  /// @return the instruments of this chunk.
+  const std::vector<std::shared_ptr<SFInstrument>> & instruments() const {
+    return layout_->instruments();
   }
 
   /// Returns the whole length of this chunk.
@@ -103,30 +86,27 @@ public:
     return 8 + size_;
   }
 
-  /// Writes this chunk to the specified output stream.
-  /// @param out the output stream.
-  /// @throws std::invalid_argument Global instrument zone has a sample.
-  /// @throws std::invalid_argument Instrument zone does not have a sample.
+  /// Returns the number of items of this chunk.
+  /// @return the number of items, including the terminator item.
+  virtual size_type num_items() const noexcept override {
+    return size_ / kItemSize;
+  }
+
+  /// Writes this chunk to the specified output sink.
+  /// @param out the output sink.
   /// @throws std::length_error The chunk size exceeds the maximum.
-  /// @throws std::out_of_range Instrument zone points to an unknown sample.
   /// @throws std::ios_base::failure An I/O error occurred.
-  virtual void Write(std::ostream & out) const override;
+  virtual void Write(OutputSink & out) const override;
 
 private:
-  /// Returns the number of instrument generator items.
-  /// @return the number of instrument generator items, including the terminator item.
-  /// @throws std::length_error Too many instrument generators.
-  uint16_t NumItems() const;
-
-  /// Writes an item of igen chunk.
-  /// @param out the output stream.
+  /// Fills an item of igen chunk.
+  /// @param record the pointer to the item to be filled.
   /// @param op the type of the generator.
   /// @param amount the amount of the generator.
-  /// @return the output stream.
-  /// @throws std::ios_base::failure An I/O error occurred.
-  static std::ostream & WriteItem(std::ostream & out,
+  /// @return the pointer next to the filled item.
+  static char * WriteItem(char * record,
       SFGenerator op,
-      GenAmountType amount);
+      GenAmountType amount) noexcept;
 
   /// Sort generators based on the ordering requirements of the generator chunk.
   /// @param generators the generators.
@@ -137,11 +117,8 @@ private:
   /// The size of the chunk (excluding header).
   size_type size_;
 
-  /// The instruments of the chunk.
-  const std::vector<std::shared_ptr<SFInstrument>> * instruments_;
-
-  /// The map containing the samples as keys and their indices as map values.
-  std::unordered_map<const SFSample *, uint16_t> sample_index_map_;
+  /// The hydra layout of the chunk.
+  std::shared_ptr<const SFHydraLayout> layout_;
 };
 
 } // namespace sf2cute
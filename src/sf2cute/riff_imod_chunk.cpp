@@ -6,128 +6,89 @@
 #include "riff_imod_chunk.hpp"
 
 #include <stdint.h>
+#include <algorithm>
+#include <array>
 #include <memory>
 #include <string>
+#include <vector>
 #include <sstream>
-#include <ostream>
 #include <stdexcept>
 
 #include <sf2cute/instrument.hpp>
 #include <sf2cute/instrument_zone.hpp>
 
-#include "byteio.hpp"
+#include "packed_record.hpp"
 
 namespace sf2cute {
 
+static_assert(SFModListRecord::kSize == SFRIFFImodChunk::kItemSize,
+  "The size of struct sfInstModList must match the item size of imod chunk.");
+
 /// Constructs a new empty SFRIFFImodChunk.
-SFRIFFImodChunk::SFRIFFImodChunk() :
-    size_(0),
-    instruments_(nullptr) {
+SFRIFFImodChunk::SFRIFFImodChunk() {
+  set_layout(std::make_shared<SFHydraLayout>());
 }
 
-/// Constructs a new SFRIFFImodChunk using the specified instruments.
-SFRIFFImodChunk::SFRIFFImodChunk(
-    const std::vector<std::shared_ptr<SFInstrument>> & instruments) :
-    instruments_(&instruments) {
-  size_ = kItemSize * NumItems();
+/// Constructs a new SFRIFFImodChunk using the specified hydra layout.
+SFRIFFImodChunk::SFRIFFImodChunk(std::shared_ptr<const SFHydraLayout> layout) {
+  set_layout(std::move(layout));
 }
 
-/// Writes this chunk to the specified output stream.
-void SFRIFFImodChunk::Write(std::ostream & out) const {
-  // Save exception bits of output stream.
-  const std::ios_base::iostate old_exception_bits = out.exceptions();
-  // Set exception bits to get output error as an exception.
-  out.exceptions(std::ios::badbit | std::ios::failbit);
-
-  try {
-    // Write the chunk header.
-    RIFFChunk::WriteHeader(out, name(), size_);
-
-    // Instruments:
-    for (const auto & instrument : instruments()) {
-      // Global zone:
-      if (instrument->has_global_zone()) {
-        // Write all the modulators in the global zone.
-        for (const auto & modulator : instrument->global_zone().modulators()) {
-          WriteItem(out, modulator->source_op(), modulator->destination_op(),
-            modulator->amount(), modulator->amount_source_op(), modulator->transform_op());
-        }
-      }
-
-      // Instrument zones:
-      for (const auto & zone : instrument->zones()) {
-        // Write all the modulators in the instrument zone.
-        for (const auto & modulator : zone->modulators()) {
-          WriteItem(out, modulator->source_op(), modulator->destination_op(),
-            modulator->amount(), modulator->amount_source_op(), modulator->transform_op());
-        }
-      }
-    }
-
-    // Write the last terminator item.
-    WriteItem(out, SFModulator(0), SFGenerator(0), 0, SFModulator(0), SFTransform(0));
-
-    // Write a padding byte if necessary.
-    if (size_ % 2 != 0) {
-      InsertInt8(out, 0);
-    }
-  }
-  catch (const std::exception &) {
-    // Recover exception bits of output stream.
-    out.exceptions(old_exception_bits);
+/// Writes this chunk to the specified output sink.
+void SFRIFFImodChunk::Write(OutputSink & out) const {
+  // Write the chunk header.
+  RIFFChunk::WriteHeader(out, name(), size_);
 
-    // Rethrow the exception.
-    throw;
-  }
-}
+  // Fill the items in a buffer.
+  std::vector<char> data(size_);
+  char * record = data.data();
 
-/// Returns the number of instrument modulator items.
-uint16_t SFRIFFImodChunk::NumItems() const {
-  size_t num_modulators = 1; // 1 = terminator
+  // Instruments:
   for (const auto & instrument : instruments()) {
-    // Count the modulators in the global zone.
+    // Global zone:
     if (instrument->has_global_zone()) {
-      num_modulators += instrument->global_zone().modulators().size();
-      if (num_modulators > UINT16_MAX) {
-        throw std::length_error("Too many instrument modulators.");
+      // Write all the modulators in the global zone.
+      for (const auto & modulator : instrument->global_zone().modulators()) {
+        record = WriteItem(record, modulator->source_op(), modulator->destination_op(),
+          modulator->amount(), modulator->amount_source_op(), modulator->transform_op());
       }
     }
 
-    // Count the modulators in the instrument zones.
+    // Instrument zones:
     for (const auto & zone : instrument->zones()) {
-      num_modulators += zone->modulators().size();
-      if (num_modulators > UINT16_MAX) {
-        throw std::length_error("Too many instrument modulators.");
+      // Write all the modulators in the instrument zone.
+      for (const auto & modulator : zone->modulators()) {
+        record = WriteItem(record, modulator->source_op(), modulator->destination_op(),
+          modulator->amount(), modulator->amount_source_op(), modulator->transform_op());
       }
     }
   }
-  return static_cast<uint16_t>(num_modulators);
+
+  // Write the last terminator item.
+  record = WriteItem(record, SFModulator(0), SFGenerator(0), 0, SFModulator(0), SFTransform(0));
+
+  // Write the items.
+  out.Write(data.data(), data.size());
+
+  // Write a padding byte if necessary.
+  RIFFChunk::WritePadding(out, size_);
 }
 
-/// Writes an item of imod chunk.
-std::ostream & SFRIFFImodChunk::WriteItem(std::ostream & out,
+/// Fills an item of imod chunk.
+char * SFRIFFImodChunk::WriteItem(char * record,
     SFModulator source_op,
     SFGenerator destination_op,
     int16_t amount,
     SFModulator amount_source_op,
-    SFTransform transform_op) {
+    SFTransform transform_op) noexcept {
   // struct sfInstModList:
-  // SFModulator sfModSrcOper;
-  InsertInt16L(out, uint16_t(source_op));
-
-  // SFGenerator sfModDestOper;
-  InsertInt16L(out, uint16_t(destination_op));
-
-  // int16_t modAmount;
-  InsertInt16L(out, amount);
-
-  // SFModulator sfModAmtSrcOper;
-  InsertInt16L(out, uint16_t(amount_source_op));
-
-  // SFTransform sfModTransOper;
-  InsertInt16L(out, uint16_t(transform_op));
+  SFModListRecord::SourceOp::Store(record, uint16_t(source_op));
+  SFModListRecord::DestinationOp::Store(record, uint16_t(destination_op));
+  SFModListRecord::Amount::Store(record, amount);
+  SFModListRecord::AmountSourceOp::Store(record, uint16_t(amount_source_op));
+  SFModListRecord::TransformOp::Store(record, uint16_t(transform_op));
 
-  return out;
+  return record + kItemSize;
 }
 
 } // namespace sf2cute
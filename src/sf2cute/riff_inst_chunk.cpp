@@ -6,102 +6,70 @@
 #include "riff_inst_chunk.hpp"
 
 #include <stdint.h>
+#include <array>
 #include <algorithm>
 #include <memory>
 #include <string>
+#include <vector>
 #include <sstream>
-#include <ostream>
 #include <stdexcept>
 
 #include <sf2cute/instrument.hpp>
 
-#include "byteio.hpp"
+#include "packed_record.hpp"
 
 namespace sf2cute {
 
+static_assert(SFInstRecord::kSize == SFRIFFInstChunk::kItemSize,
+  "The size of struct sfInst must match the item size of inst chunk.");
+
 /// Constructs a new empty SFRIFFInstChunk.
 SFRIFFInstChunk::SFRIFFInstChunk() :
-    size_(0),
-    instruments_(nullptr) {
+    trim_names_at_null_(false) {
+  set_layout(std::make_shared<SFHydraLayout>());
 }
 
-/// Constructs a new SFRIFFInstChunk using the specified instruments.
-SFRIFFInstChunk::SFRIFFInstChunk(
-    const std::vector<std::shared_ptr<SFInstrument>> & instruments) :
-    instruments_(&instruments) {
-  size_ = kItemSize * NumItems();
+/// Constructs a new SFRIFFInstChunk using the specified hydra layout.
+SFRIFFInstChunk::SFRIFFInstChunk(std::shared_ptr<const SFHydraLayout> layout) :
+    trim_names_at_null_(false) {
+  set_layout(std::move(layout));
 }
 
-/// Writes this chunk to the specified output stream.
-void SFRIFFInstChunk::Write(std::ostream & out) const {
-  // Save exception bits of output stream.
-  const std::ios_base::iostate old_exception_bits = out.exceptions();
-  // Set exception bits to get output error as an exception.
-  out.exceptions(std::ios::badbit | std::ios::failbit);
-
-  try {
-    // Write the chunk header.
-    RIFFChunk::WriteHeader(out, name(), size_);
-
-    // Instruments:
-    size_t inst_bag_index = 0;
-    for (const auto & instrument : instruments()) {
-      // Write the instrument header.
-      WriteItem(out, instrument->name(), uint16_t(inst_bag_index));
-
-      // Count the number of instrument zones.
-      size_t num_zones = 0;
-      if (instrument->has_global_zone()) {
-        num_zones++;
-      }
-      num_zones += instrument->zones().size();
-
-      // Increment the instrument bag index.
-      inst_bag_index += num_zones;
-    }
-
-    // Write the last terminator item.
-    WriteItem(out, "EOI", uint16_t(inst_bag_index));
-
-    // Write a padding byte if necessary.
-    if (size_ % 2 != 0) {
-      InsertInt8(out, 0);
-    }
-  }
-  catch (const std::exception &) {
-    // Recover exception bits of output stream.
-    out.exceptions(old_exception_bits);
+/// Writes this chunk to the specified output sink.
+void SFRIFFInstChunk::Write(OutputSink & out) const {
+  // Write the chunk header.
+  RIFFChunk::WriteHeader(out, name(), size_);
 
-    // Rethrow the exception.
-    throw;
-  }
-}
+  // Fill the items in a buffer.
+  std::vector<char> data(size_);
+  char * record = data.data();
 
-/// Returns the number of instrument items.
-uint16_t SFRIFFInstChunk::NumItems() const {
-  size_t num_instrument_items = instruments().size() + 1;
-  if (num_instrument_items > UINT16_MAX) {
-    throw std::length_error("Too many instruments.");
+  // Instruments:
+  const auto & inst_bag_indices = layout().instrument_bag_indices();
+  for (size_t index = 0; index < instruments().size(); index++) {
+    // Write the instrument header.
+    record = WriteItem(record, instruments()[index]->name(), inst_bag_indices[index]);
   }
-  return static_cast<uint16_t>(num_instrument_items);
+
+  // Write the last terminator item.
+  record = WriteItem(record, "EOI", inst_bag_indices.back());
+
+  // Write the items.
+  out.Write(data.data(), data.size());
+
+  // Write a padding byte if necessary.
+  RIFFChunk::WritePadding(out, size_);
 }
 
-/// Writes an item of inst chunk.
-std::ostream & SFRIFFInstChunk::WriteItem(std::ostream & out,
+/// Fills an item of inst chunk.
+char * SFRIFFInstChunk::WriteItem(char * record,
     const std::string & name,
-    uint16_t inst_bag_index) {
+    uint16_t inst_bag_index) const noexcept {
   // struct sfInst:
-  // char achInstName[20];
-  std::string instrument_name(name.substr(0, SFInstrument::kMaxNameLength));
-  out.write(instrument_name.data(), instrument_name.size());
-  for (std::string::size_type i = 0; i < SFInstrument::kMaxNameLength + 1 - instrument_name.size(); i++) {
-    out.put(0);
-  }
-
-  // uint16_t wInstBagNdx;
-  InsertInt16L(out, inst_bag_index);
+  SFInstRecord::InstName::Store(record, name, trim_names_at_null_);
+  SFInstRecord::InstBagIndex::Store(record, inst_bag_index);
 
-  return out;
+  return record + kItemSize;
 }
 
 } // namespace sf2cute
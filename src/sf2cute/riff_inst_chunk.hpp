@@ -10,8 +10,8 @@
 #include <memory>
 #include <string>
 #include <vector>
-#include <ostream>
 
+#include "hydra_layout.hpp"
 #include "riff.hpp"
 
 namespace sf2cute {
@@ -30,11 +30,9 @@ public:
   /// Constructs a new empty SFRIFFInstChunk.
   SFRIFFInstChunk();
 
-  /// Constructs a new SFRIFFInstChunk using the specified instruments.
-  /// @param instruments The instruments of the chunk.
-  /// @throws std::length_error Too many instruments.
-  SFRIFFInstChunk(
-      const std::vector<std::shared_ptr<SFInstrument>> & instruments);
+  /// Constructs a new SFRIFFInstChunk using the specified hydra layout.
+  /// @param layout the hydra layout of the chunk.
+  explicit SFRIFFInstChunk(std::shared_ptr<const SFHydraLayout> layout);
 
   /// Constructs a new copy of specified SFRIFFInstChunk.
   /// @param origin a SFRIFFInstChunk object.
@@ -60,20 +58,35 @@ public:
     return "inst";
   }
 
+  /// Returns the hydra layout of this chunk.
+  /// @return the hydra layout of this chunk.
+  const SFHydraLayout & layout() const noexcept {
+    return *layout_;
+  }
+
+  /// Sets the hydra layout of this chunk.
+  /// @param layout the hydra layout of this chunk.
+  void set_layout(std::shared_ptr<const SFHydraLayout> layout) {
+    layout_ = std::move(layout);
+    size_ = kItemSize * layout_->num_instrument_items();
+  }
+
   /// Returns the instruments of this chunk.
   /// @return the instruments of this chunk.
-  const std::vector<std::shared_ptr<SFInstrument>> &
-      instruments() const {
-    return *instruments_;
+  const std::vector<std::shared_ptr<SFInstrument>> & instruments() const {
+    return layout_->instruments();
+  }
+
+  /// Returns true if each name is written up to its first null character.
+  /// @return true if the bytes after the first null character of a name are written as zeros.
+  bool trim_names_at_null() const noexcept {
+    return trim_names_at_null_;
   }
 
-  /// Sets the instruments of this chunk.
-  /// @param instruments the instruments of this chunk.
-  /// @throws std::length_error Too many instruments.
-  void set_instruments(
-      const std::vector<std::shared_ptr<SFInstrument>> & instruments) {
-    instruments_ = &instruments;
-    size_ = kItemSize * NumItems();
+  /// Sets whether each name is written up to its first null character.
+  /// @param trim_names_at_null true to write the bytes after the first null character of a name as zeros.
+  void set_trim_names_at_null(bool trim_names_at_null) noexcept {
+    trim_names_at_null_ = trim_names_at_null;
   }
 
   /// Returns the whole length of this chunk.
@@ -82,33 +95,36 @@ public:
     return 8 + size_;
   }
 
-  /// Writes this chunk to the specified output stream.
-  /// @param out the output stream.
+  /// Returns the number of items of this chunk.
+  /// @return the number of items, including the terminator item.
+  virtual size_type num_items() const noexcept override {
+    return size_ / kItemSize;
+  }
+
+  /// Writes this chunk to the specified output sink.
+  /// @param out the output sink.
   /// @throws std::length_error The chunk size exceeds the maximum.
   /// @throws std::ios_base::failure An I/O error occurred.
-  virtual void Write(std::ostream & out) const override;
+  virtual void Write(OutputSink & out) const override;
 
 private:
-  /// Returns the number of instrument items.
-  /// @return the number of instrument items, including the terminator item.
-  /// @throws std::length_error Too many instruments.
-  uint16_t NumItems() const;
-
-  /// Writes an item of inst chunk.
-  /// @param out the output stream.
+  /// Fills an item of inst chunk.
+  /// @param record the pointer to the item to be filled.
   /// @param name the name of instrument.
   /// @param inst_bag_index the instrument bag index starting from 0.
-  /// @return the output stream.
-  /// @throws std::ios_base::failure An I/O error occurred.
-  static std::ostream & WriteItem(std::ostream & out,
+  /// @return the pointer next to the filled item.
+  char * WriteItem(char * record,
       const std::string & name,
-      uint16_t inst_bag_index);
+      uint16_t inst_bag_index) const noexcept;
 
   /// The size of the chunk (excluding header).
   size_type size_;
 
-  /// The instruments of the chunk.
-  const std::vector<std::shared_ptr<SFInstrument>> * instruments_;
+  /// The hydra layout of the chunk.
+  std::shared_ptr<const SFHydraLayout> layout_;
+
+  /// True if each name is written up to its first null character.
+  bool trim_names_at_null_;
 };
 
 } // namespace sf2cute
@@ -6,117 +6,66 @@
 #include "riff_pbag_chunk.hpp"
 
 #include <stdint.h>
+#include <algorithm>
+#include <array>
 #include <memory>
 #include <string>
+#include <vector>
 #include <sstream>
-#include <ostream>
 #include <stdexcept>
 
 #include <sf2cute/preset.hpp>
 #include <sf2cute/preset_zone.hpp>
 
-#include "byteio.hpp"
+#include "packed_record.hpp"
 
 namespace sf2cute {
 
+static_assert(SFBagRecord::kSize == SFRIFFPbagChunk::kItemSize,
+  "The size of struct sfPresetBag must match the item size of pbag chunk.");
+
 /// Constructs a new empty SFRIFFPbagChunk.
-SFRIFFPbagChunk::SFRIFFPbagChunk() :
-    size_(0),
-    presets_(nullptr) {
+SFRIFFPbagChunk::SFRIFFPbagChunk() {
+  set_layout(std::make_shared<SFHydraLayout>());
 }
 
-/// Constructs a new SFRIFFPbagChunk using the specified presets.
-SFRIFFPbagChunk::SFRIFFPbagChunk(
-    const std::vector<std::shared_ptr<SFPreset>> & presets) :
-    presets_(&presets) {
-  size_ = kItemSize * NumItems();
+/// Constructs a new SFRIFFPbagChunk using the specified hydra layout.
+SFRIFFPbagChunk::SFRIFFPbagChunk(std::shared_ptr<const SFHydraLayout> layout) {
+  set_layout(std::move(layout));
 }
 
-/// Writes this chunk to the specified output stream.
-void SFRIFFPbagChunk::Write(std::ostream & out) const {
-  // Save exception bits of output stream.
-  const std::ios_base::iostate old_exception_bits = out.exceptions();
-  // Set exception bits to get output error as an exception.
-  out.exceptions(std::ios::badbit | std::ios::failbit);
-
-  try {
-    // Write the chunk header.
-    RIFFChunk::WriteHeader(out, name(), size_);
-
-    // Presets:
-    size_t generator_index = 0;
-    size_t modulator_index = 0;
-    for (const auto & preset : presets()) {
-      // Global preset zone:
-      if (preset->has_global_zone()) {
-        // Write the global zone.
-        WriteItem(out, uint16_t(generator_index), uint16_t(modulator_index));
-
-        // Increment the generator index and the modulator index.
-        generator_index += preset->global_zone().generators().size();
-        modulator_index += preset->global_zone().modulators().size();
-      }
-
-      // Preset zones:
-      for (const auto & zone : preset->zones()) {
-        // Write the preset zone.
-        WriteItem(out, uint16_t(generator_index), uint16_t(modulator_index));
-
-        // Increment the generator index and the modulator index.
-        generator_index += (zone->has_instrument() ? 1 : 0) + zone->generators().size();
-        modulator_index += zone->modulators().size();
-      }
-    }
-
-    // Write the last terminator item.
-    WriteItem(out, uint16_t(generator_index), uint16_t(modulator_index));
-
-    // Write a padding byte if necessary.
-    if (size_ % 2 != 0) {
-      InsertInt8(out, 0);
-    }
-  }
-  catch (const std::exception &) {
-    // Recover exception bits of output stream.
-    out.exceptions(old_exception_bits);
+/// Writes this chunk to the specified output sink.
+void SFRIFFPbagChunk::Write(OutputSink & out) const {
+  // Write the chunk header.
+  RIFFChunk::WriteHeader(out, name(), size_);
 
-    // Rethrow the exception.
-    throw;
-  }
-}
+  // Fill the items in a buffer.
+  std::vector<char> data(size_);
+  char * record = data.data();
 
-/// Returns the number of preset zone items.
-uint16_t SFRIFFPbagChunk::NumItems() const {
-  size_t num_zones = 1; // 1 = terminator
-  for (const auto & preset : presets()) {
-    // Count the global zone.
-    if (preset->has_global_zone()) {
-      num_zones++;
-    }
-
-    // Count the preset zones.
-    num_zones += preset->zones().size();
-
-    // Check the range of the number of zones.
-    if (num_zones > UINT16_MAX) {
-      throw std::length_error("Too many preset zones.");
-    }
+  // Preset zones, followed by the terminator item:
+  const auto & generator_indices = layout().preset_generator_indices();
+  const auto & modulator_indices = layout().preset_modulator_indices();
+  for (size_t index = 0; index < generator_indices.size(); index++) {
+    record = WriteItem(record, generator_indices[index], modulator_indices[index]);
   }
-  return static_cast<uint16_t>(num_zones);
+
+  // Write the items.
+  out.Write(data.data(), data.size());
+
+  // Write a padding byte if necessary.
+  RIFFChunk::WritePadding(out, size_);
 }
 
-/// Writes an item of pbag chunk.
-std::ostream & SFRIFFPbagChunk::WriteItem(std::ostream & out,
+/// Fills an item of pbag chunk.
+char * SFRIFFPbagChunk::WriteItem(char * record,
     uint16_t generator_index,
-    uint16_t modulator_index) {
+    uint16_t modulator_index) noexcept {
   // struct sfPresetBag:
-  // uint16_t wGenNdx;
-  InsertInt16L(out, generator_index);
-
-  // uint16_t wModNdx;
-  InsertInt16L(out, modulator_index);
+  SFBagRecord::GeneratorIndex::Store(record, generator_index);
+  SFBagRecord::ModulatorIndex::Store(record, modulator_index);
 
-  return out;
+  return record + kItemSize;
 }
 
 } // namespace sf2cute
@@ -6,144 +6,88 @@
 #include "riff_pgen_chunk.hpp"
 
 #include <stdint.h>
+#include <array>
 #include <algorithm>
 #include <memory>
 #include <string>
-#include <unordered_map>
+#include <vector>
 #include <sstream>
-#include <ostream>
 #include <stdexcept>
 
 #include <sf2cute/preset.hpp>
 #include <sf2cute/preset_zone.hpp>
 
-#include "byteio.hpp"
+#include "packed_record.hpp"
 
 namespace sf2cute {
 
+static_assert(SFGenListRecord::kSize == SFRIFFPgenChunk::kItemSize,
+  "The size of struct sfGenList must match the item size of pgen chunk.");
+
 /// Constructs a new empty SFRIFFPgenChunk.
-SFRIFFPgenChunk::SFRIFFPgenChunk() :
-    size_(0),
-    presets_(nullptr),
-    instrument_index_map_() {
+SFRIFFPgenChunk::SFRIFFPgenChunk() {
+  set_layout(std::make_shared<SFHydraLayout>());
 }
 
-/// Constructs a new SFRIFFPgenChunk using the specified presets.
-SFRIFFPgenChunk::SFRIFFPgenChunk(
-    const std::vector<std::shared_ptr<SFPreset>> & presets,
-    std::unordered_map<const SFInstrument *, uint16_t> instrument_index_map) :
-    presets_(&presets),
-    instrument_index_map_(std::move(instrument_index_map)) {
-  size_ = kItemSize * NumItems();
+/// Constructs a new SFRIFFPgenChunk using the specified hydra layout.
+SFRIFFPgenChunk::SFRIFFPgenChunk(std::shared_ptr<const SFHydraLayout> layout) {
+  set_layout(std::move(layout));
 }
 
-/// Writes this chunk to the specified output stream.
-void SFRIFFPgenChunk::Write(std::ostream & out) const {
-  // Save exception bits of output stream.
-  const std::ios_base::iostate old_exception_bits = out.exceptions();
-  // Set exception bits to get output error as an exception.
-  out.exceptions(std::ios::badbit | std::ios::failbit);
-
-  try {
-    // Write the chunk header.
-    RIFFChunk::WriteHeader(out, name(), size_);
-
-    // Presets:
-    for (const auto & preset : presets()) {
-      // Global zone:
-      if (preset->has_global_zone()) {
-        // Check the instrument for the global zone.
-        if (preset->global_zone().has_instrument()) {
-          // Throw exception if the global zone has a link to an instrument.
-          throw std::invalid_argument("Global preset zone cannot have a link to an instrument.");
-        }
-
-        // Write all the generators in the global zone.
-        for (const auto & generator : SortGenerators(preset->global_zone().generators())) {
-          WriteItem(out, generator->op(), generator->amount());
-        }
-      }
-
-      // Preset zones:
-      for (const auto & zone : preset->zones()) {
-        // Write all the generators in the preset zone.
-        for (const auto & generator : SortGenerators(zone->generators())) {
-          WriteItem(out, generator->op(), generator->amount());
-        }
-
-        // Check the sample for the zone.
-        if (zone->has_instrument()) {
-          // Find the index number for the instrument.
-          const auto & instrument = zone->instrument();
-          if (instrument_index_map().count(instrument.get()) != 0) {
-            // Write the instrument generator.
-            GenAmountType instrument_index(instrument_index_map().at(instrument.get()));
-            WriteItem(out, SFGenerator::kInstrument, instrument_index);
-          }
-          else {
-            // Throw exception if the instrument could not be found in the index map.
-            throw std::out_of_range("Preset zone points to an unknown instrument.");
-          }
-        }
-        else {
-          // Throw exception if the preset zone does not have a link to an instrument.
-          throw std::invalid_argument("Preset zone must have a link to an instrument.");
-        }
-      }
-    }
-
-    // Write the last terminator item.
-    WriteItem(out, SFGenerator(0), GenAmountType(0));
-
-    // Write a padding byte if necessary.
-    if (size_ % 2 != 0) {
-      InsertInt8(out, 0);
-    }
-  }
-  catch (const std::exception &) {
-    // Recover exception bits of output stream.
-    out.exceptions(old_exception_bits);
+/// Writes this chunk to the specified output sink.
+void SFRIFFPgenChunk::Write(OutputSink & out) const {
+  // Write the chunk header.
+  RIFFChunk::WriteHeader(out, name(), size_);
 
-    // Rethrow the exception.
-    throw;
-  }
-}
+  // Fill the items in a buffer.
+  std::vector<char> data(size_);
+  char * record = data.data();
 
-/// Returns the number of preset generator items.
-uint16_t SFRIFFPgenChunk::NumItems() const {
-  size_t num_generators = 1; // 1 = terminator
+  // Presets:
+  const auto & instrument_indices = layout().preset_instrument_indices();
+  size_t bag_index = 0;
   for (const auto & preset : presets()) {
-    // Count the generators in the global zone.
+    // Global zone:
     if (preset->has_global_zone()) {
-      num_generators += preset->global_zone().generators().size();
-      if (num_generators > UINT16_MAX) {
-        throw std::length_error("Too many preset generators.");
+      // Write all the generators in the global zone.
+      for (const auto & generator : SortGenerators(preset->global_zone().generators())) {
+        record = WriteItem(record, generator->op(), generator->amount());
       }
+      bag_index++;
     }
 
-    // Count the generators in the preset zones.
+    // Preset zones:
     for (const auto & zone : preset->zones()) {
-      num_generators += (zone->has_instrument() ? 1 : 0) + zone->generators().size();
-      if (num_generators > UINT16_MAX) {
-        throw std::length_error("Too many preset generators.");
+      // Write all the generators in the preset zone.
+      for (const auto & generator : SortGenerators(zone->generators())) {
+        record = WriteItem(record, generator->op(), generator->amount());
       }
+
+      // Write the instrument generator.
+      record = WriteItem(record, SFGenerator::kInstrument, GenAmountType(instrument_indices[bag_index]));
+      bag_index++;
     }
   }
-  return static_cast<uint16_t>(num_generators);
+
+  // Write the last terminator item.
+  record = WriteItem(record, SFGenerator(0), GenAmountType(0));
+
+  // Write the items.
+  out.Write(data.data(), data.size());
+
+  // Write a padding byte if necessary.
+  RIFFChunk::WritePadding(out, size_);
 }
 
-/// Writes an item of pgen chunk.
-std::ostream & SFRIFFPgenChunk::WriteItem(std::ostream & out,
+/// Fills an item of pgen chunk.
+char * SFRIFFPgenChunk::WriteItem(char * record,
     SFGenerator op,
-    GenAmountType amount) {
+    GenAmountType amount) noexcept {
   // struct sfGenList:
-  // SFGenerator sfGenOper;
-  InsertInt16L(out, static_cast<uint16_t>(op));
-
-  // GenAmountType genAmount;
-  InsertInt16L(out, amount.value);
+  SFGenListRecord::Op::Store(record, static_cast<uint16_t>(op));
+  SFGenListRecord::Amount::Store(record, amount.value);
 
-  return out;
+  return record + kItemSize;
 }
 
 /// Sort generators based on the ordering requirements of the generator chunk.
@@ -157,7 +101,7 @@ std::vector<SFGeneratorItem *> SFRIFFPgenChunk::SortGenerators(
   }
 
   // Sort the generator pointers.
-  std::sort(sorted_generators.begin(), sorted_generators.end(),
+  std::stable_sort(sorted_generators.begin(), sorted_generators.end(),
     [](const SFGeneratorItem * x, const SFGeneratorItem * y) {
     return SFGeneratorItem::Compare(x->op(), y->op());
   });
@@ -10,17 +10,15 @@
 #include <memory>
 #include <string>
 #include <vector>
-#include <unordered_map>
-#include <ostream>
 
 #include <sf2cute/types.hpp>
 
+#include "hydra_layout.hpp"
 #include "riff.hpp"
 
 namespace sf2cute {
 
 class SFPreset;
-class SFInstrument;
 class SFGeneratorItem;
 
 /// The SFRIFFPgenChunk class represents a SoundFont 2 "pgen" chunk.
@@ -35,13 +33,9 @@ public:
   /// Constructs a new empty SFRIFFPgenChunk.
   SFRIFFPgenChunk();
 
-  /// Constructs a new SFRIFFPgenChunk using the specified presets.
-  /// @param presets the presets of the chunk.
-  /// @param instrument_index_map map containing the instruments as keys and their indices as map values.
-  /// @throws std::length_error Too many preset generators.
-  SFRIFFPgenChunk(
-      const std::vector<std::shared_ptr<SFPreset>> & presets,
-      std::unordered_map<const SFInstrument *, uint16_t> instrument_index_map);
+  /// Constructs a new SFRIFFPgenChunk using the specified hydra layout.
+  /// @param layout the hydra layout of the chunk.
+  explicit SFRIFFPgenChunk(std::shared_ptr<const SFHydraLayout> layout);
 
   /// Constructs a new copy of specified SFRIFFPgenChunk.
   /// @param origin a SFRIFFPgenChunk object.
@@ -67,34 +61,23 @@ public:
     return "pgen";
   }
 
-  /// Returns the presets of this chunk.
-  /// @return the presets of this chunk.
-  const std::vector<std::shared_ptr<SFPreset>> &
-      presets() const {
-    return *presets_;
-  }
-
-  /// Sets the presets of this chunk.
-  /// @param presets the presets of this chunk.
-  /// @throws std::length_error Too many preset generators.
-  void set_presets(
-      const std::vector<std::shared_ptr<SFPreset>> & presets) {
-    presets_ = &presets;
-    size_ = kItemSize * NumItems();
+  /// Returns the hydra layout of this chunk.
+  /// @return the hydra layout of this chunk.
+  const SFHydraLayout & layout() const noexcept {
+    return *layout_;
   }
 
-  /// Returns the map containing the instruments as keys and their indices as map values.
-  /// @return the map containing the instruments as keys and their indices as map values.
-  const std::unordered_map<const SFInstrument *, uint16_t> &
-      instrument_index_map() const {
-    return instrument_index_map_;
+  /// Sets the hydra layout of this chunk.
+  /// @param layout the hydra layout of this chunk.
+  void set_layout(std::shared_ptr<const SFHydraLayout> layout) {
+    layout_ = std::move(layout);
+    size_ = kItemSize * layout_->num_preset_generator_items();
   }
 
-  /// Sets the map containing the instruments as keys and their indices as map values.
-  /// @param instrument_index_map the map containing the instruments as keys and their indices as map values.
-  void set_instrument_index_map(
-      std::unordered_map<const SFInstrument *, uint16_t> instrument_index_map) {
-    instrument_index_map_ = std::move(instrument_index_map);
+  /// Returns the presets of this chunk.
+  /// @return the presets of this chunk.
+  const std::vector<std::shared_ptr<SFPreset>> & presets() const {
+    return layout_->presets();
   }
 
   /// Returns the whole length of this chunk.
@@ -103,30 +86,27 @@ public:
     return 8 + size_;
   }
 
-  /// Writes this chunk to the specified output stream.
-  /// @param out the output stream.
-  /// @throws std::invalid_argument Global preset zone has an instrument.
-  /// @throws std::invalid_argument Instrument zone does not have an instrument.
+  /// Returns the number of items of this chunk.
+  /// @return the number of items, including the terminator item.
+  virtual size_type num_items() const noexcept override {
+    return size_ / kItemSize;
+  }
+
+  /// Writes this chunk to the specified output sink.
+  /// @param out the output sink.
   /// @throws std::length_error The chunk size exceeds the maximum.
-  /// @throws std::out_of_range Preset zone points to an unknown instrument.
   /// @throws std::ios_base::failure An I/O error occurred.
-  virtual void Write(std::ostream & out) const override;
+  virtual void Write(OutputSink & out) const override;
 
 private:
-  /// Returns the number of preset generator items.
-  /// @return the number of preset generator items, including the terminator item.
-  /// @throws std::length_error Too many preset generators.
-  uint16_t NumItems() const;
-
-  /// Writes an item of pgen chunk.
-  /// @param out the output stream.
+  /// Fills an item of pgen chunk.
+  /// @param record the pointer to the item to be filled.
   /// @param op the type of the generator.
   /// @param amount the amount of the generator.
-  /// @return the output stream.
-  /// @throws std::ios_base::failure An I/O error occurred.
-  static std::ostream & WriteItem(std::ostream & out,
+  /// @return the pointer next to the filled item.
+  static char * WriteItem(char * record,
       SFGenerator op,
-      GenAmountType amount);
+      GenAmountType amount) noexcept;
 
   /// Sort generators based on the ordering requirements of the generator chunk.
   /// @param generators the generators.
@@ -137,11 +117,8 @@ private:
   /// The size of the chunk (excluding header).
   size_type size_;
 
-  /// The presets of the chunk.
-  const std::vector<std::shared_ptr<SFPreset>> * presets_;
-
-  /// The map containing the instruments as keys and their indices as map values.
-  std::unordered_map<const SFInstrument *, uint16_t> instrument_index_map_;
+  /// The hydra layout of the chunk.
+  std::shared_ptr<const SFHydraLayout> layout_;
 };
 
 } // namespace sf2cute
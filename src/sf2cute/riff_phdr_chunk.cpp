@@ -6,123 +6,83 @@
 #include "riff_phdr_chunk.hpp"
 
 #include <stdint.h>
+#include <algorithm>
+#include <array>
 #include <memory>
 #include <string>
+#include <vector>
 #include <sstream>
-#include <ostream>
 #include <stdexcept>
 
 #include <sf2cute/preset.hpp>
 
-#include "byteio.hpp"
+#include "packed_record.hpp"
 
 namespace sf2cute {
 
+static_assert(SFPresetHeaderRecord::kSize == SFRIFFPhdrChunk::kItemSize,
+  "The size of struct sfPresetHeader must match the item size of phdr chunk.");
+
 /// Constructs a new empty SFRIFFPhdrChunk.
 SFRIFFPhdrChunk::SFRIFFPhdrChunk() :
-    size_(0),
-    presets_(nullptr) {
+    trim_names_at_null_(false) {
+  set_layout(std::make_shared<SFHydraLayout>());
 }
 
-/// Constructs a new SFRIFFPhdrChunk using the specified presets.
-SFRIFFPhdrChunk::SFRIFFPhdrChunk(
-    const std::vector<std::shared_ptr<SFPreset>> & presets) :
-    presets_(&presets) {
-  size_ = kItemSize * NumItems();
+/// Constructs a new SFRIFFPhdrChunk using the specified hydra layout.
+SFRIFFPhdrChunk::SFRIFFPhdrChunk(std::shared_ptr<const SFHydraLayout> layout) :
+    trim_names_at_null_(false) {
+  set_layout(std::move(layout));
 }
 
-/// Writes this chunk to the specified output stream.
-void SFRIFFPhdrChunk::Write(std::ostream & out) const {
-  // Save exception bits of output stream.
-  const std::ios_base::iostate old_exception_bits = out.exceptions();
-  // Set exception bits to get output error as an exception.
-  out.exceptions(std::ios::badbit | std::ios::failbit);
-
-  try {
-    // Write the chunk header.
-    RIFFChunk::WriteHeader(out, name(), size_);
-
-    // Presets:
-    size_t preset_bag_index = 0;
-    for (const auto & preset : presets()) {
-      // Write the preset header.
-      WriteItem(out, preset->name(),
-        preset->preset_number(), preset->bank(), uint16_t(preset_bag_index),
-        preset->library(), preset->genre(), preset->morphology());
-
-      // Count the number of preset zones.
-      size_t num_zones = 0;
-      if (preset->has_global_zone()) {
-        num_zones++;
-      }
-      num_zones += preset->zones().size();
-
-      // Increment the preset bag index.
-      preset_bag_index += num_zones;
-    }
-
-    // Write the last terminator item.
-    WriteItem(out, "EOP", 0, 0, uint16_t(preset_bag_index), 0, 0, 0);
-
-    // Write a padding byte if necessary.
-    if (size_ % 2 != 0) {
-      InsertInt8(out, 0);
-    }
+/// Writes this chunk to the specified output sink.
+void SFRIFFPhdrChunk::Write(OutputSink & out) const {
+  // Write the chunk header.
+  RIFFChunk::WriteHeader(out, name(), size_);
+
+  // Fill the items in a buffer.
+  std::vector<char> data(size_);
+  char * record = data.data();
+
+  // Presets:
+  const auto & preset_bag_indices = layout().preset_bag_indices();
+  for (size_t index = 0; index < presets().size(); index++) {
+    // Write the preset header.
+    const auto & preset = presets()[index];
+    record = WriteItem(record, preset->name(),
+      preset->preset_number(), preset->bank(), preset_bag_indices[index],
+      preset->library(), preset->genre(), preset->morphology());
   }
-  catch (const std::exception &) {
-    // Recover exception bits of output stream.
-    out.exceptions(old_exception_bits);
 
-    // Rethrow the exception.
-    throw;
-  }
-}
+  // Write the last terminator item.
+  record = WriteItem(record, "EOP", 0, 0, preset_bag_indices.back(), 0, 0, 0);
 
-/// Returns the number of preset items.
-uint16_t SFRIFFPhdrChunk::NumItems() const {
-  size_t num_preset_items = presets().size() + 1;
-  if (num_preset_items > UINT16_MAX) {
-    throw std::length_error("Too many presets.");
-  }
-  return static_cast<uint16_t>(num_preset_items);
+  // Write the items.
+  out.Write(data.data(), data.size());
+
+  // Write a padding byte if necessary.
+  RIFFChunk::WritePadding(out, size_);
 }
 
-/// Writes an item of phdr chunk.
-std::ostream & SFRIFFPhdrChunk::WriteItem(std::ostream & out,
+/// Fills an item of phdr chunk.
+char * SFRIFFPhdrChunk::WriteItem(char * record,
     const std::string & name,
     uint16_t preset_number,
     uint16_t bank,
     uint16_t preset_bag_index,
     uint32_t library,
     uint32_t genre,
-    uint32_t morphology) {
+    uint32_t morphology) const noexcept {
   // struct sfPresetHeader:
-  // char achPresetName[20];
-  std::string preset_name(name.substr(0, SFPreset::kMaxNameLength));
-  out.write(preset_name.data(), preset_name.size());
-  for (std::string::size_type i = 0; i < SFPreset::kMaxNameLength + 1 - preset_name.size(); i++) {
-    out.put(0);
-  }
-
-  // uint16_t wPreset;
-  InsertInt16L(out, preset_number);
-
-  // uint16_t wBank;
-  InsertInt16L(out, bank);
-
-  // uint16_t wPresetBagNdx;
-  InsertInt16L(out, preset_bag_index);
-
-  // uint32_t dwLibrary;
-  InsertInt32L(out, library);
-
-  // uint32_t dwGenre;
-  InsertInt32L(out, genre);
-
-  // uint32_t dwMorphology;
-  InsertInt32L(out, morphology);
-
-  return out;
+  SFPresetHeaderRecord::PresetName::Store(record, name, trim_names_at_null_);
+  SFPresetHeaderRecord::Preset::Store(record, preset_number);
+  SFPresetHeaderRecord::Bank::Store(record, bank);
+  SFPresetHeaderRecord::PresetBagIndex::Store(record, preset_bag_index);
+  SFPresetHeaderRecord::Library::Store(record, library);
+  SFPresetHeaderRecord::Genre::Store(record, genre);
+  SFPresetHeaderRecord::Morphology::Store(record, morphology);
+
+  return record + kItemSize;
 }
 
 } // namespace sf2cute
@@ -10,8 +10,8 @@
 #include <memory>
 #include <string>
 #include <vector>
-#include <ostream>
 
+#include "hydra_layout.hpp"
 #include "riff.hpp"
 
 namespace sf2cute {
@@ -30,11 +30,9 @@ public:
   /// Constructs a new empty SFRIFFPhdrChunk.
   SFRIFFPhdrChunk();
 
-  /// Constructs a new SFRIFFPhdrChunk using the specified presets.
-  /// @param presets The presets of the chunk.
-  /// @throws std::length_error Too many presets.
-  SFRIFFPhdrChunk(
-      const std::vector<std::shared_ptr<SFPreset>> & presets);
+  /// Constructs a new SFRIFFPhdrChunk using the specified hydra layout.
+  /// @param layout the hydra layout of the chunk.
+  explicit SFRIFFPhdrChunk(std::shared_ptr<const SFHydraLayout> layout);
 
   /// Constructs a new copy of specified SFRIFFPhdrChunk.
   /// @param origin a SFRIFFPhdrChunk object.
@@ -60,20 +58,35 @@ public:
     return "phdr";
   }
 
+  /// Returns the hydra layout of this chunk.
+  /// @return the hydra layout of this chunk.
+  const SFHydraLayout & layout() const noexcept {
+    return *layout_;
+  }
+
+  /// Sets the hydra layout of this chunk.
+  /// @param layout the hydra layout of this chunk.
+  void set_layout(std::shared_ptr<const SFHydraLayout> layout) {
+    layout_ = std::move(layout);
+    size_ = kItemSize * layout_->num_preset_items();
+  }
+
   /// Returns the presets of this chunk.
   /// @return the presets of this chunk.
-  const std::vector<std::shared_ptr<SFPreset>> &
-      presets() const {
-    return *presets_;
+  const std::vector<std::shared_ptr<SFPreset>> & presets() const {
+    return layout_->presets();
+  }
+
+  /// Returns true if each name is written up to its first null character.
+  /// @return true if the bytes after the first null character of a name are written as zeros.
+  bool trim_names_at_null() const noexcept {
+    return trim_names_at_null_;
   }
 
-  /// Sets the presets of this chunk.
-  /// @param presets the presets of this chunk.
-  /// @throws std::length_error Too many presets.
-  void set_presets(
-      const std::vector<std::shared_ptr<SFPreset>> & presets) {
-    presets_ = &presets;
-    size_ = kItemSize * NumItems();
+  /// Sets whether each name is written up to its first null character.
+  /// @param trim_names_at_null true to write the bytes after the first null character of a name as zeros.
+  void set_trim_names_at_null(bool trim_names_at_null) noexcept {
+    trim_names_at_null_ = trim_names_at_null;
   }
 
   /// Returns the whole length of this chunk.
@@ -82,20 +95,21 @@ public:
     return 8 + size_;
   }
 
-  /// Writes this chunk to the specified output stream.
-  /// @param out the output stream.
+  /// Returns the number of items of this chunk.
+  /// @return the number of items, including the terminator item.
+  virtual size_type num_items() const noexcept override {
+    return size_ / kItemSize;
+  }
+
+  /// Writes this chunk to the specified output sink.
+  /// @param out the output sink.
   /// @throws std::length_error The chunk size exceeds the maximum.
   /// @throws std::ios_base::failure An I/O error occurred.
-  virtual void Write(std::ostream & out) const override;
+  virtual void Write(OutputSink & out) const override;
 
 private:
-  /// Returns the number of preset items.
-  /// @return the number of preset items, including the terminator item.
-  /// @throws std::length_error Too many presets.
-  uint16_t NumItems() const;
-
-  /// Writes an item of phdr chunk.
-  /// @param out the output stream.
+  /// Fills an item of phdr chunk.
+  /// @param record the pointer to the item to be filled.
   /// @param name the name of preset.
   /// @param preset_number the preset number.
   /// @param bank the bank number.
@@ -103,16 +117,15 @@ private:
   /// @param library the library.
   /// @param genre the genre.
   /// @param morphology the morphology.
-  /// @return the output stream.
-  /// @throws std::ios_base::failure An I/O error occurred.
-  static std::ostream & WriteItem(std::ostream & out,
+  /// @return the pointer next to the filled item.
+  char * WriteItem(char * record,
       const std::string & name,
       uint16_t preset_number,
       uint16_t bank,
       uint16_t preset_bag_index,
       uint32_t library,
       uint32_t genre,
-      uint32_t morphology);
+      uint32_t morphology) const noexcept;
 
   /// The name of the chunk.
   std::string name_;
@@ -120,8 +133,11 @@ private:
   /// The size of the chunk (excluding header).
   size_type size_;
 
-  /// The presets of the chunk.
-  const std::vector<std::shared_ptr<SFPreset>> * presets_;
+  /// The hydra layout of the chunk.
+  std::shared_ptr<const SFHydraLayout> layout_;
+
+  /// True if each name is written up to its first null character.
+  bool trim_names_at_null_;
 };
 
 } // namespace sf2cute
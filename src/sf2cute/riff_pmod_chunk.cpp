@@ -6,128 +6,89 @@
 #include "riff_pmod_chunk.hpp"
 
 #include <stdint.h>
+#include <algorithm>
+#include <array>
 #include <memory>
 #include <string>
+#include <vector>
 #include <sstream>
-#include <ostream>
 #include <stdexcept>
 
 #include <sf2cute/preset.hpp>
 #include <sf2cute/preset_zone.hpp>
 
-#include "byteio.hpp"
+#include "packed_record.hpp"
 
 namespace sf2cute {
 
+static_assert(SFModListRecord::kSize == SFRIFFPmodChunk::kItemSize,
+  "The size of struct sfModList must match the item size of pmod chunk.");
+
 /// Constructs a new empty SFRIFFPmodChunk.
-SFRIFFPmodChunk::SFRIFFPmodChunk() :
-    size_(0),
-    presets_(nullptr) {
+SFRIFFPmodChunk::SFRIFFPmodChunk() {
+  set_layout(std::make_shared<SFHydraLayout>());
 }
 
-/// Constructs a new SFRIFFPmodChunk using the specified presets.
-SFRIFFPmodChunk::SFRIFFPmodChunk(
-    const std::vector<std::shared_ptr<SFPreset>> & presets) :
-    presets_(&presets) {
-  size_ = kItemSize * NumItems();
+/// Constructs a new SFRIFFPmodChunk using the specified hydra layout.
+SFRIFFPmodChunk::SFRIFFPmodChunk(std::shared_ptr<const SFHydraLayout> layout) {
+  set_layout(std::move(layout));
 }
 
-/// Writes this chunk to the specified output stream.
-void SFRIFFPmodChunk::Write(std::ostream & out) const {
-  // Save exception bits of output stream.
-  const std::ios_base::iostate old_exception_bits = out.exceptions();
-  // Set exception bits to get output error as an exception.
-  out.exceptions(std::ios::badbit | std::ios::failbit);
-
-  try {
-    // Write the chunk header.
-    RIFFChunk::WriteHeader(out, name(), size_);
-
-    // Presets:
-    for (const auto & preset : presets()) {
-      // Global zone:
-      if (preset->has_global_zone()) {
-        // Write all the modulators in the global zone.
-        for (const auto & modulator : preset->global_zone().modulators()) {
-          WriteItem(out, modulator->source_op(), modulator->destination_op(),
-            modulator->amount(), modulator->amount_source_op(), modulator->transform_op());
-        }
-      }
-
-      // Preset zones:
-      for (const auto & zone : preset->zones()) {
-        // Write all the modulators in the preset zone.
-        for (const auto & modulator : zone->modulators()) {
-          WriteItem(out, modulator->source_op(), modulator->destination_op(),
-            modulator->amount(), modulator->amount_source_op(), modulator->transform_op());
-        }
-      }
-    }
-
-    // Write the last terminator item.
-    WriteItem(out, SFModulator(0), SFGenerator(0), 0, SFModulator(0), SFTransform(0));
-
-    // Write a padding byte if necessary.
-    if (size_ % 2 != 0) {
-      InsertInt8(out, 0);
-    }
-  }
-  catch (const std::exception &) {
-    // Recover exception bits of output stream.
-    out.exceptions(old_exception_bits);
+/// Writes this chunk to the specified output sink.
+void SFRIFFPmodChunk::Write(OutputSink & out) const {
+  // Write the chunk header.
+  RIFFChunk::WriteHeader(out, name(), size_);
 
-    // Rethrow the exception.
-    throw;
-  }
-}
+  // Fill the items in a buffer.
+  std::vector<char> data(size_);
+  char * record = data.data();
 
-/// Returns the number of preset modulator items.
-uint16_t SFRIFFPmodChunk::NumItems() const {
-  size_t num_modulators = 1; // 1 = terminator
+  // Presets:
   for (const auto & preset : presets()) {
-    // Count the modulators in the global zone.
+    // Global zone:
     if (preset->has_global_zone()) {
-      num_modulators += preset->global_zone().modulators().size();
-      if (num_modulators > UINT16_MAX) {
-        throw std::length_error("Too many preset modulators.");
+      // Write all the modulators in the global zone.
+      for (const auto & modulator : preset->global_zone().modulators()) {
+        record = WriteItem(record, modulator->source_op(), modulator->destination_op(),
+          modulator->amount(), modulator->amount_source_op(), modulator->transform_op());
       }
     }
 
-    // Count the modulators in the instrument zones.
+    // Preset zones:
     for (const auto & zone : preset->zones()) {
-      num_modulators += zone->modulators().size();
-      if (num_modulators > UINT16_MAX) {
-        throw std::length_error("Too many preset modulators.");
+      // Write all the modulators in the preset zone.
+      for (const auto & modulator : zone->modulators()) {
+        record = WriteItem(record, modulator->source_op(), modulator->destination_op(),
+          modulator->amount(), modulator->amount_source_op(), modulator->transform_op());
       }
     }
   }
-  return static_cast<uint16_t>(num_modulators);
+
+  // Write the last terminator item.
+  record = WriteItem(record, SFModulator(0), SFGenerator(0), 0, SFModulator(0), SFTransform(0));
+
+  // Write the items.
+  out.Write(data.data(), data.size());
+
+  // Write a padding byte if necessary.
+  RIFFChunk::WritePadding(out, size_);
 }
 
-/// Writes an item of pmod chunk.
-std::ostream & SFRIFFPmodChunk::WriteItem(std::ostream & out,
+/// Fills an item of pmod chunk.
+char * SFRIFFPmodChunk::WriteItem(char * record,
     SFModulator source_op,
     SFGenerator destination_op,
     int16_t amount,
     SFModulator amount_source_op,
-    SFTransform transform_op) {
+    SFTransform transform_op) noexcept {
   // struct sfModList:
-  // SFModulator sfModSrcOper;
-  InsertInt16L(out, uint16_t(source_op));
-
-  // SFGenerator sfModDestOper;
-  InsertInt16L(out, uint16_t(destination_op));
-
-  // int16_t modAmount;
-  InsertInt16L(out, amount);
-
-  // SFModulator sfModAmtSrcOper;
-  InsertInt16L(out, uint16_t(amount_source_op));
-
-  // SFTransform sfModTransOper;
-  InsertInt16L(out, uint16_t(transform_op));
+  SFModListRecord::SourceOp::Store(record, uint16_t(source_op));
+  SFModListRecord::DestinationOp::Store(record, uint16_t(destination_op));
+  SFModListRecord::Amount::Store(record, amount);
+  SFModListRecord::AmountSourceOp::Store(record, uint16_t(amount_source_op));
+  SFModListRecord::TransformOp::Store(record, uint16_t(transform_op));
 
-  return out;
+  return record + kItemSize;
 }
 
 } // namespace sf2cute
@@ -10,11 +10,11 @@
 #include <memory>
 #include <string>
 #include <vector>
-#include <ostream>
 
 #include <sf2cute/types.hpp>
 #include <sf2cute/modulator.hpp>
 
+#include "hydra_layout.hpp"
 #include "riff.hpp"
 
 namespace sf2cute {
@@ -33,11 +33,9 @@ public:
   /// Constructs a new empty SFRIFFPmodChunk.
   SFRIFFPmodChunk();
 
-  /// Constructs a new SFRIFFPmodChunk using the specified presets.
-  /// @param presets The presets of the chunk.
-  /// @throws std::length_error Too many preset modulators.
-  SFRIFFPmodChunk(
-      const std::vector<std::shared_ptr<SFPreset>> & presets);
+  /// Constructs a new SFRIFFPmodChunk using the specified hydra layout.
+  /// @param layout the hydra layout of the chunk.
+  explicit SFRIFFPmodChunk(std::shared_ptr<const SFHydraLayout> layout);
 
   /// Constructs a new copy of specified SFRIFFPmodChunk.
   /// @param origin a SFRIFFPmodChunk object.
@@ -63,20 +61,23 @@ public:
     return "pmod";
   }
 
-  /// Returns the presets of this chunk.
-  /// @return the presets of this chunk.
-  const std::vector<std::shared_ptr<SFPreset>> &
-      presets() const {
-    return *presets_;
+  /// Returns the hydra layout of this chunk.
+  /// @return the hydra layout of this chunk.
+  const SFHydraLayout & layout() const noexcept {
+    return *layout_;
   }
 
-  /// Sets the presets of this chunk.
-  /// @param presets the presets of this chunk.
-  /// @throws std::length_error Too many preset modulators.
-  void set_presets(
-      const std::vector<std::shared_ptr<SFPreset>> & presets) {
-    presets_ = &presets;
-    size_ = kItemSize * NumItems();
+  /// Sets the hydra layout of this chunk.
+  /// @param layout the hydra layout of this chunk.
+  void set_layout(std::shared_ptr<const SFHydraLayout> layout) {
+    layout_ = std::move(layout);
+    size_ = kItemSize * layout_->num_preset_modulator_items();
+  }
+
+  /// Returns the presets of this chunk.
+  /// @return the presets of this chunk.
+  const std::vector<std::shared_ptr<SFPreset>> & presets() const {
+    return layout_->presets();
   }
 
   /// Returns the whole length of this chunk.
@@ -85,39 +86,39 @@ public:
     return 8 + size_;
   }
 
-  /// Writes this chunk to the specified output stream.
-  /// @param out the output stream.
+  /// Returns the number of items of this chunk.
+  /// @return the number of items, including the terminator item.
+  virtual size_type num_items() const noexcept override {
+    return size_ / kItemSize;
+  }
+
+  /// Writes this chunk to the specified output sink.
+  /// @param out the output sink.
   /// @throws std::length_error The chunk size exceeds the maximum.
   /// @throws std::ios_base::failure An I/O error occurred.
-  virtual void Write(std::ostream & out) const override;
+  virtual void Write(OutputSink & out) const override;
 
 private:
-  /// Returns the number of preset modulator items.
-  /// @return the number of preset modulator items, including the terminator item.
-  /// @throws std::length_error Too many preset modulators.
-  uint16_t NumItems() const;
-
-  /// Writes an item of pmod chunk.
-  /// @param out the output stream.
+  /// Fills an item of pmod chunk.
+  /// @param record the pointer to the item to be filled.
   /// @param source_op the source of data for the modulator.
   /// @param destination_op the destination of the modulator.
   /// @param amount the degree to which the source modulates the destination.
   /// @param amount_source_op the modulation source to be applied to the modulation amount.
   /// @param transform_op the transform type to be applied to the modulation source.
-  /// @return the output stream.
-  /// @throws std::ios_base::failure An I/O error occurred.
-  static std::ostream & WriteItem(std::ostream & out,
+  /// @return the pointer next to the filled item.
+  static char * WriteItem(char * record,
       SFModulator source_op,
       SFGenerator destination_op,
       int16_t amount,
       SFModulator amount_source_op,
-      SFTransform transform_op);
+      SFTransform transform_op) noexcept;
 
   /// The size of the chunk (excluding header).
   size_type size_;
 
-  /// The presets of the chunk.
-  const std::vector<std::shared_ptr<SFPreset>> * presets_;
+  /// The hydra layout of the chunk.
+  std::shared_ptr<const SFHydraLayout> layout_;
 };
 
 } // namespace sf2cute
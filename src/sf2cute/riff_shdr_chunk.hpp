@@ -10,12 +10,12 @@
 #include <memory>
 #include <string>
 #include <vector>
-#include <unordered_map>
-#include <ostream>
 
 #include <sf2cute/types.hpp>
 #include <sf2cute/modulator.hpp>
 
+#include "encoded_sample_pool.hpp"
+#include "hydra_layout.hpp"
 #include "riff.hpp"
 
 namespace sf2cute {
@@ -34,12 +34,9 @@ public:
   /// Constructs a new empty SFRIFFShdrChunk.
   SFRIFFShdrChunk();
 
-  /// Constructs a new SFRIFFShdrChunk using the specified samples.
-  /// @param samples The samples of the chunk.
-  /// @param sample_index_map the map containing the samples as keys and their indices as map values.
-  /// @throws std::length_error Too many samples.
-  SFRIFFShdrChunk(const std::vector<std::shared_ptr<SFSample>> & samples,
-      std::unordered_map<const SFSample *, uint16_t> sample_index_map);
+  /// Constructs a new SFRIFFShdrChunk using the specified hydra layout.
+  /// @param layout the hydra layout of the chunk.
+  explicit SFRIFFShdrChunk(std::shared_ptr<const SFHydraLayout> layout);
 
   /// Constructs a new copy of specified SFRIFFShdrChunk.
   /// @param origin a SFRIFFShdrChunk object.
@@ -65,30 +62,51 @@ public:
     return "shdr";
   }
 
+  /// Returns the hydra layout of this chunk.
+  /// @return the hydra layout of this chunk.
+  const SFHydraLayout & layout() const noexcept {
+    return *layout_;
+  }
+
+  /// Sets the hydra layout of this chunk.
+  /// @param layout the hydra layout of this chunk.
+  void set_layout(std::shared_ptr<const SFHydraLayout> layout) {
+    layout_ = std::move(layout);
+    size_ = kItemSize * layout_->num_sample_items();
+  }
+
   /// Returns the samples of this chunk.
   /// @return the samples of this chunk.
   const std::vector<std::shared_ptr<SFSample>> & samples() const {
-    return *samples_;
+    return layout_->samples();
+  }
+
+  /// Returns the compressed sample pool that the sample headers point to.
+  /// @return the compressed sample pool, or nullptr if the sample headers point to the data points.
+  const std::shared_ptr<const SFEncodedSamplePool> & encoded_samples() const noexcept {
+    return encoded_samples_;
   }
 
-  /// Sets the samples of this chunk.
-  /// @param samples the samples of this chunk.
-  /// @throws std::length_error Too many samples.
-  void set_samples(const std::vector<std::shared_ptr<SFSample>> & samples) {
-    samples_ = &samples;
-    size_ = kItemSize * NumItems();
+  /// Sets the compressed sample pool that the sample headers point to (SoundFont 3).
+  ///
+  /// Each sample header then has the byte range of the compressed data, the loop points
+  /// relative to the beginning of the sample, and the sample type flag of the compressed data.
+  /// @param encoded_samples the compressed sample pool of the same samples,
+  /// or nullptr to point to the data points.
+  void set_encoded_samples(std::shared_ptr<const SFEncodedSamplePool> encoded_samples) noexcept {
+    encoded_samples_ = std::move(encoded_samples);
   }
 
-  /// Returns the map containing the samples as keys and their indices as map values.
-  /// @return the map containing the samples as keys and their indices as map values.
-  const std::unordered_map<const SFSample *, uint16_t> & sample_index_map() const {
-    return sample_index_map_;
+  /// Returns true if each name is written up to its first null character.
+  /// @return true if the bytes after the first null character of a name are written as zeros.
+  bool trim_names_at_null() const noexcept {
+    return trim_names_at_null_;
   }
 
-  /// Sets the map containing the samples as keys and their indices as map values.
-  /// @param sample_index_map the map containing the samples as keys and their indices as map values.
-  void set_sample_index_map(std::unordered_map<const SFSample *, uint16_t> sample_index_map) {
-    sample_index_map_ = std::move(sample_index_map);
+  /// Sets whether each name is written up to its first null character.
+  /// @param trim_names_at_null true to write the bytes after the first null character of a name as zeros.
+  void set_trim_names_at_null(bool trim_names_at_null) noexcept {
+    trim_names_at_null_ = trim_names_at_null;
   }
 
   /// Returns the whole length of this chunk.
@@ -97,21 +115,21 @@ public:
     return 8 + size_;
   }
 
-  /// Writes this chunk to the specified output stream.
-  /// @param out the output stream.
+  /// Returns the number of items of this chunk.
+  /// @return the number of items, including the terminator item.
+  virtual size_type num_items() const noexcept override {
+    return size_ / kItemSize;
+  }
+
+  /// Writes this chunk to the specified output sink.
+  /// @param out the output sink.
   /// @throws std::length_error The chunk size exceeds the maximum.
-  /// @throws std::out_of_range Sample has a link to an unknown sample.
   /// @throws std::ios_base::failure An I/O error occurred.
-  virtual void Write(std::ostream & out) const override;
+  virtual void Write(OutputSink & out) const override;
 
 private:
-  /// Returns the number of sample header items.
-  /// @return the number of sample header items, including the terminator item.
-  /// @throws std::length_error Too many samples.
-  uint16_t NumItems() const;
-
-  /// Writes an item of shdr chunk.
-  /// @param out the output stream.
+  /// Fills an item of shdr chunk.
+  /// @param record the pointer to the item to be filled.
   /// @param name the name of sample.
   /// @param start the beginning index of the sample, in sample data points, inclusive.
   /// @param end the ending index of the sample, in sample data points, exclusive.
@@ -122,21 +140,23 @@ private:
   /// @param correction the pitch correction that should be applied to the sample, in cents.
   /// @param link the associated right or left stereo sample. nullptr is allowed.
   /// @param type both the type of sample and the whether the sample is located in RAM or ROM memory.
-  /// @return the output stream.
-  /// @throws std::ios_base::failure An I/O error occurred.
-  static std::ostream & WriteItem(std::ostream & out,
+  /// @return the pointer next to the filled item.
+  char * WriteItem(char * record,
       const std::string & name, uint32_t start, uint32_t end,
       uint32_t start_loop, uint32_t end_loop, uint32_t sample_rate,
-      uint8_t original_key, int8_t correction, uint16_t link, SFSampleLink type);
+      uint8_t original_key, int8_t correction, uint16_t link, SFSampleLink type) const noexcept;
 
   /// The size of the chunk (excluding header).
   size_type size_;
 
-  /// The samples of the chunk.
-  const std::vector<std::shared_ptr<SFSample>> * samples_;
+  /// The hydra layout of the chunk.
+  std::shared_ptr<const SFHydraLayout> layout_;
+
+  /// True if each name is written up to its first null character.
+  bool trim_names_at_null_;
 
-  /// The map containing the samples as keys and their indices as map values.
-  std::unordered_map<const SFSample *, uint16_t> sample_index_map_;
+  /// The compressed sample pool that the sample headers point to.
+  std::shared_ptr<const SFEncodedSamplePool> encoded_samples_;
 };
 
 } // namespace sf2cute
@@ -0,0 +1,66 @@
+/// @file
+/// SoundFont "sm24" RIFF chunk implementation
+///
+/// @author gocha <https://github.com/gocha>
+
+#include "riff_sm24_chunk.hpp"
+
+#include <stdint.h>
+#include <algorithm>
+#include <array>
+#include <memory>
+#include <string>
+
+#include <sf2cute/sample.hpp>
+
+namespace sf2cute {
+
+/// Constructs a new SFRIFFSm24Chunk using the specified hydra layout.
+SFRIFFSm24Chunk::SFRIFFSm24Chunk(std::shared_ptr<const SFHydraLayout> layout) :
+    size_(0),
+    layout_(std::move(layout)) {
+  // The chunk has a byte for each data point of the "smpl" chunk.
+  for (size_t index = 0; index < samples().size(); index++) {
+    if (layout_->sample_origin_indices()[index] == index) {
+      size_ += samples()[index]->data_length() + SFSample::kTerminatorSampleLength;
+    }
+  }
+}
+
+/// Writes this chunk to the specified output sink.
+void SFRIFFSm24Chunk::Write(OutputSink & out) const {
+  // Write the chunk header.
+  RIFFChunk::WriteHeader(out, name(), size_);
+
+  // Write the lower 8 bits of the data points, and the terminator samples.
+  for (size_t index = 0; index < samples().size(); index++) {
+    if (layout_->sample_origin_indices()[index] != index) {
+      continue;
+    }
+
+    const SFSample & sample = *samples()[index];
+    if (sample.has_24bit_data()) {
+      out.Write(reinterpret_cast<const char *>(sample.low_byte_data().data()),
+        sample.low_byte_data().size());
+    }
+    else {
+      WriteZeros(out, sample.data_length());
+    }
+    WriteZeros(out, SFSample::kTerminatorSampleLength);
+  }
+
+  // Write a padding byte if necessary.
+  RIFFChunk::WritePadding(out, size_);
+}
+
+/// Writes zeros.
+void SFRIFFSm24Chunk::WriteZeros(OutputSink & out, size_type size) {
+  static const std::array<char, 4096> kZeros{};
+  while (size != 0) {
+    const size_type block_size = std::min(size, size_type(kZeros.size()));
+    out.Write(kZeros.data(), block_size);
+    size -= block_size;
+  }
+}
+
+} // namespace sf2cute
@@ -0,0 +1,101 @@
+/// @file
+/// SoundFont "sm24" RIFF chunk header
+///
+/// @author gocha <https://github.com/gocha>
+
+#ifndef SF2CUTE_RIFF_SM24_CHUNK_HPP_
+#define SF2CUTE_RIFF_SM24_CHUNK_HPP_
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "hydra_layout.hpp"
+#include "riff.hpp"
+
+namespace sf2cute {
+
+class SFSample;
+
+/// The SFRIFFSm24Chunk class represents a SoundFont 2.04 "sm24" chunk.
+///
+/// The chunk holds the lower 8 bits of each data point in the "smpl" chunk,
+/// in the same order, including the terminator samples.
+/// The data points of 16-bit samples are extended with zeros.
+class SFRIFFSm24Chunk : public RIFFChunkInterface {
+public:
+  /// Unsigned integer type for the chunk size.
+  using size_type = RIFFChunkInterface::size_type;
+
+  /// Constructs a new SFRIFFSm24Chunk using the specified hydra layout.
+  ///
+  /// The data points of a sample that shares the data points of another sample
+  /// (SFHydraLayout::sample_origin_indices()) are not written, as in the "smpl" chunk.
+  /// @param layout the hydra layout of the chunk.
+  explicit SFRIFFSm24Chunk(std::shared_ptr<const SFHydraLayout> layout);
+
+  /// Constructs a new copy of specified SFRIFFSm24Chunk.
+  /// @param origin a SFRIFFSm24Chunk object.
+  SFRIFFSm24Chunk(const SFRIFFSm24Chunk & origin) = default;
+
+  /// Copy-assigns a new value to the SFRIFFSm24Chunk, replacing its current contents.
+  /// @param origin a SFRIFFSm24Chunk object.
+  SFRIFFSm24Chunk & operator=(const SFRIFFSm24Chunk & origin) = default;
+
+  /// Acquires the contents of specified SFRIFFSm24Chunk.
+  /// @param origin a SFRIFFSm24Chunk object.
+  SFRIFFSm24Chunk(SFRIFFSm24Chunk && origin) = default;
+
+  /// Move-assigns a new value to the SFRIFFSm24Chunk, replacing its current contents.
+  /// @param origin a SFRIFFSm24Chunk object.
+  SFRIFFSm24Chunk & operator=(SFRIFFSm24Chunk && origin) = default;
+
+  /// Destructs the SFRIFFSm24Chunk.
+  virtual ~SFRIFFSm24Chunk() = default;
+
+  /// @copydoc RIFFChunkInterface::name()
+  virtual std::string name() const override {
+    return "sm24";
+  }
+
+  /// Returns the samples of this chunk.
+  /// @return the samples of this chunk.
+  const std::vector<std::shared_ptr<SFSample>> & samples() const {
+    return layout_->samples();
+  }
+
+  /// Returns the whole length of this chunk.
+  /// @return the length of this chunk including a chunk header and a padding byte, in terms of bytes.
+  virtual size_type size() const noexcept override {
+    return 8 + size_ + (size_ % 2);
+  }
+
+  /// Returns the number of samples of this chunk.
+  /// @return the number of samples.
+  virtual size_type num_items() const noexcept override {
+    return samples().size();
+  }
+
+  /// Writes this chunk to the specified output sink.
+  /// @param out the output sink.
+  /// @throws std::ios_base::failure An I/O error occurred.
+  virtual void Write(OutputSink & out) const override;
+
+private:
+  /// Writes zeros.
+  /// @param out the output sink.
+  /// @param size the number of zero bytes.
+  /// @throws std::ios_base::failure An I/O error occurred.
+  static void WriteZeros(OutputSink & out, size_type size);
+
+  /// The size of the chunk (excluding header).
+  size_type size_;
+
+  /// The hydra layout of the chunk.
+  std::shared_ptr<const SFHydraLayout> layout_;
+};
+
+} // namespace sf2cute
+
+#endif // SF2CUTE_RIFF_SM24_CHUNK_HPP_
@@ -6,74 +6,209 @@
 #include "riff_smpl_chunk.hpp"
 
 #include <stdint.h>
+#include <algorithm>
+#include <array>
 #include <memory>
 #include <string>
 #include <ostream>
 #include <stdexcept>
 
 #include <sf2cute/sample.hpp>
+#include <sf2cute/write_digest.hpp>
 
 #include "byteio.hpp"
+#include "hashing_output_sink.hpp"
 
 namespace sf2cute {
 
 /// Constructs a new empty SFRIFFSmplChunk.
 SFRIFFSmplChunk::SFRIFFSmplChunk() :
     size_(0),
-    samples_(nullptr) {
+    samples_(nullptr),
+    sample_digests_(nullptr),
+    sample_sources_(nullptr) {
 }
 
 /// Constructs a new SFRIFFSmplChunk using the specified samples.
 SFRIFFSmplChunk::SFRIFFSmplChunk(
     const std::vector<std::shared_ptr<SFSample>> & samples) :
-    samples_(&samples) {
+    samples_(&samples),
+    sample_digests_(nullptr),
+    sample_sources_(nullptr) {
   size_ = GetSamplePoolSize();
 }
 
-/// Writes this chunk to the specified output stream.
-void SFRIFFSmplChunk::Write(std::ostream & out) const {
-  // Save exception bits of output stream.
-  const std::ios_base::iostate old_exception_bits = out.exceptions();
-  // Set exception bits to get output error as an exception.
-  out.exceptions(std::ios::badbit | std::ios::failbit);
-
-  try {
-    // Write the chunk header.
-    RIFFChunk::WriteHeader(out, name(), size_);
-
-    // Write the chunk data.
-    for (const auto & sample : samples()) {
-      // Write the samples.
-      for (int16_t value : sample->data()) {
-        InsertInt16L(out, value);
+/// Constructs a new SFRIFFSmplChunk using the specified hydra layout.
+SFRIFFSmplChunk::SFRIFFSmplChunk(std::shared_ptr<const SFHydraLayout> layout) :
+    samples_(&layout->samples()),
+    layout_(std::move(layout)),
+    sample_digests_(nullptr),
+    sample_sources_(nullptr) {
+  size_ = GetSamplePoolSize();
+}
+
+/// Writes this chunk to the specified output sink.
+void SFRIFFSmplChunk::Write(OutputSink & out) const {
+  // Write the chunk header.
+  RIFFChunk::WriteHeader(out, name(), size_);
+
+  // Write the chunk data.
+  if (encoded_samples_ != nullptr) {
+    WriteEncodedSamples(out);
+  }
+  else {
+    WriteSamples(out, 0, samples().size());
+  }
+
+  // Write a padding byte if necessary.
+  RIFFChunk::WritePadding(out, size_);
+}
+
+/// Splits this chunk into its header and ranges of whole samples.
+void SFRIFFSmplChunk::GetWriteRanges(size_type offset,
+    std::vector<RIFFWriteRange> & ranges) const {
+  // The compressed data are small, and are not worth splitting.
+  if (encoded_samples_ != nullptr) {
+    RIFFChunkInterface::GetWriteRanges(offset, ranges);
+    return;
+  }
+
+  // The chunk header.
+  ranges.push_back(RIFFWriteRange{offset, 8,
+    [this](OutputSink & out) { RIFFChunk::WriteHeader(out, name(), size_); }});
+  offset += 8;
+
+  // The samples, grouped so that each range is large enough.
+  // The chunk data never needs a padding byte, since every data point is 16-bit.
+  size_t first = 0;
+  size_type range_size = 0;
+  for (size_t index = 0; index < samples().size(); index++) {
+    if (IsWrittenSample(index)) {
+      range_size += sizeof(int16_t) *
+          (samples()[index]->data_length() + SFSample::kTerminatorSampleLength);
+    }
+
+    // A range never ends with nothing to write, even if the last samples are shared.
+    const size_t last = index + 1;
+    if (range_size != 0 && (range_size >= kMinWriteRangeSize || last == samples().size())) {
+      ranges.push_back(RIFFWriteRange{offset, range_size,
+        [this, first, last](OutputSink & out) { WriteSamples(out, first, last); }});
+      offset += range_size;
+      first = last;
+      range_size = 0;
+    }
+  }
+}
+
+/// Writes the compressed data of the samples.
+void SFRIFFSmplChunk::WriteEncodedSamples(OutputSink & out) const {
+  for (size_t index = 0; index < samples().size(); index++) {
+    // A shared sample has the hash of its origin, which precedes it.
+    const SFSample & sample = *samples()[index];
+    if (!IsWrittenSample(index)) {
+      if (sample_digests_ != nullptr) {
+        const SFContentDigest & origin = (*sample_digests_)[layout_->sample_origin_indices()[index]];
+        (*sample_digests_)[index] = SFContentDigest{sample.name(), origin.size, origin.digest};
       }
+      continue;
+    }
 
-      // Write terminator samples.
-      for (uint32_t index = 0; index < SFSample::kTerminatorSampleLength; index++) {
-        InsertInt16L(out, 0);
+    // Write the compressed data.
+    const std::vector<char> & data = encoded_samples_->sample_data(index);
+    if (sample_digests_ != nullptr) {
+      HashingOutputSink hashing_out(out);
+      hashing_out.Write(data.data(), data.size());
+      (*sample_digests_)[index] = SFContentDigest{sample.name(),
+        hashing_out.position(), hashing_out.digest()};
+    }
+    else {
+      out.Write(data.data(), data.size());
+    }
+  }
+}
+
+/// Writes the data points and the terminator of a series of samples.
+void SFRIFFSmplChunk::WriteSamples(OutputSink & out,
+    size_t first, size_t last) const {
+  static const std::array<char, sizeof(int16_t) * SFSample::kTerminatorSampleLength> kTerminator{};
+  for (size_t index = first; index < last; index++) {
+    // A shared sample has the hash of its origin, which precedes it.
+    const SFSample & sample = *samples()[index];
+    if (!IsWrittenSample(index)) {
+      if (sample_digests_ != nullptr) {
+        const SFContentDigest & origin = (*sample_digests_)[layout_->sample_origin_indices()[index]];
+        (*sample_digests_)[index] = SFContentDigest{sample.name(), origin.size, origin.digest};
       }
+      continue;
     }
 
-    // Write a padding byte if necessary.
-    if (size_ % 2 != 0) {
-      InsertInt8(out, 0);
+    // Write the samples.
+    if (sample_digests_ != nullptr) {
+      HashingOutputSink hashing_out(out);
+      WriteSampleAt(hashing_out, index);
+      (*sample_digests_)[index] = SFContentDigest{sample.name(),
+        hashing_out.position(), hashing_out.digest()};
     }
+    else {
+      WriteSampleAt(out, index);
+    }
+
+    // Write terminator samples.
+    out.Write(kTerminator.data(), kTerminator.size());
   }
-  catch (const std::exception &) {
-    // Recover exception bits of output stream.
-    out.exceptions(old_exception_bits);
+}
 
-    // Rethrow the exception.
-    throw;
+/// Writes the data points of a sample, from its overriding source if any.
+void SFRIFFSmplChunk::WriteSampleAt(OutputSink & out, size_t index) const {
+  if (sample_sources_ != nullptr && (*sample_sources_)[index].fd != -1) {
+    const SFSampleFileSource & source = (*sample_sources_)[index];
+    out.WriteFromFile(source.fd, source.offset, sizeof(int16_t) * OutputSink::size_type(source.length));
+  }
+  else {
+    WriteSample(out, *samples()[index]);
+  }
+}
+
+/// Writes the data points of a sample.
+void SFRIFFSmplChunk::WriteSample(OutputSink & out, const SFSample & sample) {
+  if (sample.has_file_source()) {
+    // The data in a file is already in the file byte order.
+    const SFSampleFileSource & source = sample.file_source();
+    out.WriteFromFile(source.fd, source.offset, sizeof(int16_t) * OutputSink::size_type(source.length));
+  }
+  else {
+    WriteSampleData(out, sample.data());
+  }
+}
+
+/// Writes the sample data points in little-endian order.
+void SFRIFFSmplChunk::WriteSampleData(OutputSink & out,
+    const std::vector<int16_t> & data) {
+  if (IsLittleEndianHost()) {
+    // The memory image is already in the file byte order.
+    out.Write(data.data(), data.size() * sizeof(int16_t));
+  }
+  else {
+    // Swap the bytes through a small buffer.
+    constexpr size_t kBlockLength = 4096;
+    std::array<char, sizeof(int16_t) * kBlockLength> buffer;
+    for (size_t offset = 0; offset < data.size(); offset += kBlockLength) {
+      const size_t length = std::min(kBlockLength, data.size() - offset);
+      WriteInt16LArray(buffer.data(), &data[offset], length);
+      out.Write(buffer.data(), length * sizeof(int16_t));
+    }
   }
 }
 
 /// Returns the total sample pool size.
 SFRIFFSmplChunk::size_type SFRIFFSmplChunk::GetSamplePoolSize() const {
   SFRIFFSmplChunk::size_type size = 0;
-  for (const auto & sample : samples()) {
+  for (size_t index = 0; index < samples().size(); index++) {
+    if (!IsWrittenSample(index)) {
+      continue;
+    }
     size += sizeof(int16_t) *
-        (sample->data().size() + SFSample::kTerminatorSampleLength);
+        (samples()[index]->data_length() + SFSample::kTerminatorSampleLength);
     if (size > UINT32_MAX) {
       throw std::length_error("The sample pool size exceeds the maximum.");
     }
@@ -6,16 +6,20 @@
 #ifndef SF2CUTE_RIFF_SMPL_CHUNK_HPP_
 #define SF2CUTE_RIFF_SMPL_CHUNK_HPP_
 
+#include <stdint.h>
 #include <memory>
 #include <string>
 #include <vector>
-#include <ostream>
 
+#include "encoded_sample_pool.hpp"
+#include "hydra_layout.hpp"
 #include "riff.hpp"
 
 namespace sf2cute {
 
 class SFSample;
+struct SFContentDigest;
+struct SFSampleFileSource;
 
 /// The SFRIFFSmplChunk class represents a SoundFont 2 "smpl" chunk.
 class SFRIFFSmplChunk : public RIFFChunkInterface {
@@ -23,6 +27,10 @@ public:
   /// Unsigned integer type for the chunk size.
   using size_type = RIFFChunkInterface::size_type;
 
+  /// The minimum length of a write range, in terms of bytes.
+  /// Consecutive small samples are grouped into one range up to this length.
+  static constexpr size_type kMinWriteRangeSize = 1024 * 1024;
+
   /// Constructs a new empty SFRIFFSmplChunk.
   SFRIFFSmplChunk();
 
@@ -31,6 +39,14 @@ public:
   /// @throws std::length_error The sample pool size exceeds the maximum.
   SFRIFFSmplChunk(const std::vector<std::shared_ptr<SFSample>> & samples);
 
+  /// Constructs a new SFRIFFSmplChunk using the specified hydra layout.
+  ///
+  /// The data points of a sample that shares the data points of another sample
+  /// (SFHydraLayout::sample_origin_indices()) are not written.
+  /// @param layout the hydra layout of the chunk.
+  /// @throws std::length_error The sample pool size exceeds the maximum.
+  explicit SFRIFFSmplChunk(std::shared_ptr<const SFHydraLayout> layout);
+
   /// Constructs a new copy of specified SFRIFFSmplChunk.
   /// @param origin a SFRIFFSmplChunk object.
   SFRIFFSmplChunk(const SFRIFFSmplChunk & origin) = default;
@@ -66,22 +82,120 @@ public:
   /// @throws std::length_error The sample pool size exceeds the maximum.
   void set_samples(const std::vector<std::shared_ptr<SFSample>> & samples) {
     samples_ = &samples;
+    layout_.reset();
+    encoded_samples_.reset();
     size_ = GetSamplePoolSize();
   }
 
+  /// Returns the collection that receives the hashes of the sample data.
+  /// @return the pointer to the collection, or nullptr if the sample data is not hashed.
+  std::vector<SFContentDigest> * sample_digests() const noexcept {
+    return sample_digests_;
+  }
+
+  /// Sets the collection that receives the hashes of the sample data.
+  /// @param sample_digests the pointer to the collection, which has an element for each sample,
+  /// or nullptr to stop hashing. The collection must outlive the writes.
+  void set_sample_digests(std::vector<SFContentDigest> * sample_digests) noexcept {
+    sample_digests_ = sample_digests;
+  }
+
+  /// Returns the sources that override the data of the samples.
+  /// @return the pointer to the sources, or nullptr if every sample is written from itself.
+  const std::vector<SFSampleFileSource> * sample_sources() const noexcept {
+    return sample_sources_;
+  }
+
+  /// Sets the sources that override the data of the samples.
+  ///
+  /// A sample whose source has a file descriptor of -1 is written from itself.
+  /// Any other source must hold the same data points as its sample.
+  /// @param sample_sources the pointer to the sources, which has an element for each sample,
+  /// or nullptr to write every sample from itself. The collection must outlive the writes.
+  void set_sample_sources(const std::vector<SFSampleFileSource> * sample_sources) noexcept {
+    sample_sources_ = sample_sources;
+  }
+
+  /// Returns the compressed data that replace the data points of the samples.
+  /// @return the compressed sample pool, or nullptr if the data points are written.
+  const std::shared_ptr<const SFEncodedSamplePool> & encoded_samples() const noexcept {
+    return encoded_samples_;
+  }
+
+  /// Sets the compressed data that replace the data points of the samples (SoundFont 3).
+  ///
+  /// The compressed data of each sample are written one after another, without terminator samples.
+  /// @param encoded_samples the compressed sample pool of the same samples,
+  /// or nullptr to write the data points.
+  void set_encoded_samples(std::shared_ptr<const SFEncodedSamplePool> encoded_samples) {
+    encoded_samples_ = std::move(encoded_samples);
+    size_ = encoded_samples_ != nullptr ? encoded_samples_->size() : GetSamplePoolSize();
+  }
+
   /// Returns the whole length of this chunk.
-  /// @return the length of this chunk including a chunk header, in terms of bytes.
+  /// @return the length of this chunk including a chunk header and a padding byte, in terms of bytes.
   virtual size_type size() const noexcept override {
-    return 8 + size_;
+    return 8 + size_ + (size_ % 2);
+  }
+
+  /// Returns the number of samples of this chunk.
+  /// @return the number of samples.
+  virtual size_type num_items() const noexcept override {
+    return samples_ != nullptr ? samples_->size() : 0;
   }
 
-  /// Writes this chunk to the specified output stream.
-  /// @param out the output stream.
+  /// Writes this chunk to the specified output sink.
+  /// @param out the output sink.
   /// @throws std::length_error The chunk size exceeds the maximum.
   /// @throws std::ios_base::failure An I/O error occurred.
-  virtual void Write(std::ostream & out) const override;
+  virtual void Write(OutputSink & out) const override;
+
+  /// Splits this chunk into its header and ranges of whole samples.
+  /// The chunk is a single range if it holds compressed data.
+  /// @param offset the absolute offset of this chunk in the file.
+  /// @param ranges the collection that the ranges are appended to, in file order.
+  virtual void GetWriteRanges(size_type offset,
+      std::vector<RIFFWriteRange> & ranges) const override;
 
 private:
+  /// Writes the data points of a sample.
+  /// @param out the output sink.
+  /// @param sample the sample.
+  /// @throws std::ios_base::failure An I/O error occurred.
+  static void WriteSample(OutputSink & out, const SFSample & sample);
+
+  /// Returns true if the data points of a sample are written to the sample pool.
+  /// @param index the index of the sample.
+  /// @return false if the sample shares the data points of another sample.
+  bool IsWrittenSample(size_t index) const noexcept {
+    return layout_ == nullptr || layout_->sample_origin_indices()[index] == index;
+  }
+
+  /// Writes the data points of a sample, from its overriding source if any.
+  /// @param out the output sink.
+  /// @param index the index of the sample.
+  /// @throws std::ios_base::failure An I/O error occurred.
+  void WriteSampleAt(OutputSink & out, size_t index) const;
+
+  /// Writes the compressed data of the samples.
+  /// @param out the output sink.
+  /// @throws std::ios_base::failure An I/O error occurred.
+  void WriteEncodedSamples(OutputSink & out) const;
+
+  /// Writes the data points and the terminator of a series of samples.
+  /// @param out the output sink.
+  /// @param first the index of the first sample.
+  /// @param last the index next to the last sample.
+  /// @throws std::ios_base::failure An I/O error occurred.
+  void WriteSamples(OutputSink & out, size_t first, size_t last) const;
+
+  /// Writes the sample data points in little-endian order.
+  /// @param out the output sink.
+  /// @param data the sample data points.
+  /// @throws std::ios_base::failure An I/O error occurred.
+  static void WriteSampleData(OutputSink & out,
+      const std::vector<int16_t> & data);
+
   /// Returns the total sample pool size.
   /// @return the total sample pool size.
   /// @throws std::length_error The sample pool size exceeds the maximum.
@@ -92,6 +206,18 @@ private:
 
   /// The samples of the chunk.
   const std::vector<std::shared_ptr<SFSample>> * samples_;
+
+  /// The hydra layout of the chunk, or nullptr if every sample is written.
+  std::shared_ptr<const SFHydraLayout> layout_;
+
+  /// The collection that receives the hashes of the sample data.
+  std::vector<SFContentDigest> * sample_digests_;
+
+  /// The sources that override the data of the samples.
+  const std::vector<SFSampleFileSource> * sample_sources_;
+
+  /// The compressed data that replace the data points of the samples.
+  std::shared_ptr<const SFEncodedSamplePool> encoded_samples_;
 };
 
 } // namespace sf2cute
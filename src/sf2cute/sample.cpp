@@ -7,10 +7,16 @@
 
 #include <stdint.h>
 #include <memory>
+#include <mutex>
 #include <algorithm>
 #include <string>
 #include <vector>
 
+#include <sf2cute/output_sink.hpp>
+
+#include "byteio.hpp"
+#include "pcm24.hpp"
+
 namespace sf2cute {
 
 /// Constructs a new empty SFSample.
@@ -22,6 +28,9 @@ SFSample::SFSample() :
     correction_(0),
     link_(),
     type_(SFSampleLink::kMonoSample),
+    file_source_(),
+    has_file_source_(false),
+    file_data_loaded_(false),
     parent_file_(nullptr) {
 }
 
@@ -35,6 +44,9 @@ SFSample::SFSample(std::string name) :
     correction_(0),
     link_(),
     type_(SFSampleLink::kMonoSample),
+    file_source_(),
+    has_file_source_(false),
+    file_data_loaded_(false),
     parent_file_(nullptr) {
 }
 
@@ -47,7 +59,6 @@ SFSample::SFSample(std::string name,
     uint8_t original_key,
     int8_t correction) :
     name_(std::move(name)),
-    data_(std::move(data)),
     start_loop_(std::move(start_loop)),
     end_loop_(std::move(end_loop)),
     sample_rate_(std::move(sample_rate)),
@@ -55,6 +66,10 @@ SFSample::SFSample(std::string name,
     correction_(std::move(correction)),
     link_(),
     type_(SFSampleLink::kMonoSample),
+    data_(std::move(data)),
+    file_source_(),
+    has_file_source_(false),
+    file_data_loaded_(false),
     parent_file_(nullptr) {
 }
 
@@ -69,7 +84,6 @@ SFSample::SFSample(std::string name,
     std::weak_ptr<SFSample> link,
     SFSampleLink type) :
     name_(std::move(name)),
-    data_(std::move(data)),
     start_loop_(std::move(start_loop)),
     end_loop_(std::move(end_loop)),
     sample_rate_(std::move(sample_rate)),
@@ -77,13 +91,38 @@ SFSample::SFSample(std::string name,
     correction_(std::move(correction)),
     link_(std::move(link)),
     type_(std::move(type)),
+    data_(std::move(data)),
+    file_source_(),
+    has_file_source_(false),
+    file_data_loaded_(false),
+    parent_file_(nullptr) {
+}
+
+/// Constructs a new SFSample whose data is stored in a file.
+SFSample::SFSample(std::string name,
+    SFSampleFileSource file_source,
+    uint32_t start_loop,
+    uint32_t end_loop,
+    uint32_t sample_rate,
+    uint8_t original_key,
+    int8_t correction) :
+    name_(std::move(name)),
+    start_loop_(std::move(start_loop)),
+    end_loop_(std::move(end_loop)),
+    sample_rate_(std::move(sample_rate)),
+    original_key_(std::move(original_key)),
+    correction_(std::move(correction)),
+    link_(),
+    type_(SFSampleLink::kMonoSample),
+    file_source_(std::move(file_source)),
+    has_file_source_(true),
+    file_data_loaded_(false),
     parent_file_(nullptr) {
 }
 
 /// Constructs a new copy of specified SFSample.
 SFSample::SFSample(const SFSample & origin) :
     name_(origin.name_),
-    data_(origin.data_),
     start_loop_(origin.start_loop_),
     end_loop_(origin.end_loop_),
     sample_rate_(origin.sample_rate_),
@@ -91,13 +130,37 @@ SFSample::SFSample(const SFSample & origin) :
     correction_(origin.correction_),
     link_(origin.link_),
     type_(origin.type_),
+    low_byte_data_(origin.low_byte_data_),
+    file_source_(origin.file_source_),
+    has_file_source_(origin.has_file_source_),
+    file_data_loaded_(false),
     parent_file_(nullptr) {
+  CopyDataFrom(origin);
+}
+
+/// Acquires the contents of specified SFSample.
+SFSample::SFSample(SFSample && origin) noexcept :
+    name_(std::move(origin.name_)),
+    start_loop_(std::move(origin.start_loop_)),
+    end_loop_(std::move(origin.end_loop_)),
+    sample_rate_(std::move(origin.sample_rate_)),
+    original_key_(std::move(origin.original_key_)),
+    correction_(std::move(origin.correction_)),
+    link_(std::move(origin.link_)),
+    type_(std::move(origin.type_)),
+    data_(std::move(origin.data_)),
+    low_byte_data_(std::move(origin.low_byte_data_)),
+    file_source_(std::move(origin.file_source_)),
+    has_file_source_(std::move(origin.has_file_source_)),
+    file_data_loaded_(origin.file_data_loaded_.load(std::memory_order_acquire)),
+    parent_file_(std::move(origin.parent_file_)) {
 }
 
 /// Copy-assigns a new value to the SFSample, replacing its current contents.
 SFSample & SFSample::operator=(const SFSample & origin) {
   name_ = origin.name_;
-  data_ = origin.data_;
+  CopyDataFrom(origin);
+  low_byte_data_ = origin.low_byte_data_;
   start_loop_ = origin.start_loop_;
   end_loop_ = origin.end_loop_;
   sample_rate_ = origin.sample_rate_;
@@ -105,8 +168,87 @@ SFSample & SFSample::operator=(const SFSample & origin) {
   correction_ = origin.correction_;
   link_ = origin.link_;
   type_ = origin.type_;
+  file_source_ = origin.file_source_;
+  has_file_source_ = origin.has_file_source_;
   parent_file_ = nullptr;
   return *this;
 }
 
+/// Move-assigns a new value to the SFSample, replacing its current contents.
+SFSample & SFSample::operator=(SFSample && origin) noexcept {
+  name_ = std::move(origin.name_);
+  data_ = std::move(origin.data_);
+  low_byte_data_ = std::move(origin.low_byte_data_);
+  start_loop_ = std::move(origin.start_loop_);
+  end_loop_ = std::move(origin.end_loop_);
+  sample_rate_ = std::move(origin.sample_rate_);
+  original_key_ = std::move(origin.original_key_);
+  correction_ = std::move(origin.correction_);
+  link_ = std::move(origin.link_);
+  type_ = std::move(origin.type_);
+  file_source_ = std::move(origin.file_source_);
+  has_file_source_ = std::move(origin.has_file_source_);
+  file_data_loaded_.store(origin.file_data_loaded_.load(std::memory_order_acquire),
+    std::memory_order_release);
+  parent_file_ = std::move(origin.parent_file_);
+  return *this;
+}
+
+/// Sets 24-bit sample data stored in 32-bit integers.
+void SFSample::set_data24(const std::vector<int32_t> & data) {
+  data_.resize(data.size());
+  low_byte_data_.resize(data.size());
+  SplitInt24Samples(data.data(), data.size(), data_.data(), low_byte_data_.data());
+  file_source_ = SFSampleFileSource();
+  has_file_source_ = false;
+}
+
+/// Sets packed 24-bit sample data.
+void SFSample::set_packed_data24(const void * data, size_t length) {
+  data_.resize(length);
+  low_byte_data_.resize(length);
+  SplitPackedInt24LSamples(data, length, data_.data(), low_byte_data_.data());
+  file_source_ = SFSampleFileSource();
+  has_file_source_ = false;
+}
+
+/// Copies the sample data of another sample, if it is in memory.
+void SFSample::CopyDataFrom(const SFSample & origin) {
+  if (!origin.has_file_source_) {
+    data_ = origin.data_;
+    file_data_loaded_.store(false, std::memory_order_release);
+    return;
+  }
+
+  // The data stored in a file is copied only if it has been read, so that it is never read twice.
+  // The lock keeps another thread from filling the data of origin while it is copied.
+  std::lock_guard<std::mutex> lock(origin.file_data_mutex_);
+  const bool file_data_loaded = origin.file_data_loaded_.load(std::memory_order_relaxed);
+  if (file_data_loaded) {
+    data_ = origin.data_;
+  }
+  else {
+    data_.clear();
+  }
+  file_data_loaded_.store(file_data_loaded, std::memory_order_release);
+}
+
+/// Reads the sample data from the file that stores it, unless it has been read.
+void SFSample::LoadFileData() const {
+  std::lock_guard<std::mutex> lock(file_data_mutex_);
+  if (file_data_loaded_.load(std::memory_order_relaxed)) {
+    return;
+  }
+
+  // The data in a file is in the file byte order.
+  const OutputSink::size_type size = sizeof(int16_t) * OutputSink::size_type(file_source_.length);
+  MemoryOutputSink bytes;
+  bytes.Reserve(size);
+  bytes.WriteFromFile(file_source_.fd, file_source_.offset, size);
+
+  data_.resize(file_source_.length);
+  ReadInt16LArray(data_.data(), bytes.data().data(), data_.size());
+  file_data_loaded_.store(true, std::memory_order_release);
+}
+
 } // namespace sf2cute
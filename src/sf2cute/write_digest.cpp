@@ -0,0 +1,35 @@
+/// @file
+/// SoundFont write digest structs implementation.
+///
+/// @author gocha <https://github.com/gocha>
+
+#include <sf2cute/write_digest.hpp>
+
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <string>
+
+namespace sf2cute {
+
+/// Writes the hashes as a text manifest.
+void SFWriteDigests::WriteManifest(std::ostream & out) const {
+  // Format the manifest aside, so that the stream state is left untouched.
+  std::ostringstream manifest;
+  const auto write_line = [&manifest](const SFContentDigest & digest, const char * kind) {
+    manifest << "xxh64 " << std::hex << std::setw(16) << std::setfill('0') << digest.digest
+      << std::dec << " " << digest.size << " " << kind << " " << digest.name << "\n";
+  };
+
+  write_line(file, "file");
+  for (const auto & chunk : chunks) {
+    write_line(chunk, "chunk");
+  }
+  for (const auto & sample : samples) {
+    write_line(sample, "sample");
+  }
+
+  out << manifest.str();
+}
+
+} // namespace sf2cute
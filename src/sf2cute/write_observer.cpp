@@ -0,0 +1,96 @@
+/// @file
+/// SoundFont write observer classes implementation.
+///
+/// @author gocha <https://github.com/gocha>
+
+#include <sf2cute/write_observer.hpp>
+
+#include <stdint.h>
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace sf2cute {
+
+/// Called before a chunk is written.
+void SFWriteObserver::OnChunkBegin(const std::string & name, uint64_t size, uint64_t num_items) {
+  // Nothing to observe by default.
+  static_cast<void>(name);
+  static_cast<void>(size);
+  static_cast<void>(num_items);
+}
+
+/// Called after a chunk is written.
+void SFWriteObserver::OnChunkEnd(const SFChunkWriteStats & stats) {
+  // Nothing to observe by default.
+  static_cast<void>(stats);
+}
+
+/// Called after a chunk is written.
+void SFWriteStatistics::OnChunkEnd(const SFChunkWriteStats & stats) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto entry = std::find_if(entries_.begin(), entries_.end(),
+    [&](const Entry & entry) { return entry.name == stats.name; });
+  if (entry == entries_.end()) {
+    entries_.push_back(Entry{stats.name, 0, 0, 0, std::chrono::steady_clock::duration::zero()});
+    entry = std::prev(entries_.end());
+  }
+
+  entry->count++;
+  entry->bytes_written += stats.bytes_written;
+  entry->num_items += stats.num_items;
+  entry->duration += stats.duration;
+}
+
+/// Returns the aggregated measurements.
+std::vector<SFWriteStatistics::Entry> SFWriteStatistics::entries() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_;
+}
+
+/// Removes all the measurements.
+void SFWriteStatistics::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_.clear();
+}
+
+/// Prints the aggregated measurements as a table.
+void SFWriteStatistics::PrintSummary(std::ostream & out) const {
+  // Format the table aside, so that the stream state is left untouched.
+  std::ostringstream table;
+  table << std::left << std::setw(6) << "chunk" << std::right
+    << std::setw(8) << "count"
+    << std::setw(16) << "bytes"
+    << std::setw(12) << "items"
+    << std::setw(14) << "time (ms)"
+    << std::setw(12) << "MB/s" << "\n";
+
+  table << std::fixed;
+  for (const auto & entry : entries()) {
+    const double seconds = std::chrono::duration<double>(entry.duration).count();
+    const double megabytes = static_cast<double>(entry.bytes_written) / (1024.0 * 1024.0);
+
+    table << std::left << std::setw(6) << entry.name << std::right
+      << std::setw(8) << entry.count
+      << std::setw(16) << entry.bytes_written
+      << std::setw(12) << entry.num_items
+      << std::setw(14) << std::setprecision(3) << seconds * 1000.0;
+    if (seconds > 0) {
+      table << std::setw(12) << std::setprecision(1) << megabytes / seconds;
+    }
+    else {
+      table << std::setw(12) << "-";
+    }
+    table << "\n";
+  }
+
+  out << table.str();
+}
+
+} // namespace sf2cute
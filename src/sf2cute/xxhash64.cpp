@@ -0,0 +1,158 @@
+/// @file
+/// XXH64 hash function class implementation.
+///
+/// @author gocha <https://github.com/gocha>
+
+#include "xxhash64.hpp"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+namespace sf2cute {
+
+namespace {
+
+/// The prime constants of XXH64.
+constexpr uint64_t kPrime1 = UINT64_C(0x9E3779B185EBCA87);
+constexpr uint64_t kPrime2 = UINT64_C(0xC2B2AE3D27D4EB4F);
+constexpr uint64_t kPrime3 = UINT64_C(0x165667B19E3779F9);
+constexpr uint64_t kPrime4 = UINT64_C(0x85EBCA77C2B2AE63);
+constexpr uint64_t kPrime5 = UINT64_C(0x27D4EB2F165667C5);
+
+/// Rotates bits to the left.
+inline uint64_t RotateLeft(uint64_t value, int count) noexcept {
+  return (value << count) | (value >> (64 - count));
+}
+
+/// Reads a 64-bit integer in little-endian order.
+inline uint64_t Read64(const unsigned char * in) noexcept {
+  return uint64_t(in[0]) | (uint64_t(in[1]) << 8) |
+    (uint64_t(in[2]) << 16) | (uint64_t(in[3]) << 24) |
+    (uint64_t(in[4]) << 32) | (uint64_t(in[5]) << 40) |
+    (uint64_t(in[6]) << 48) | (uint64_t(in[7]) << 56);
+}
+
+/// Reads a 32-bit integer in little-endian order.
+inline uint64_t Read32(const unsigned char * in) noexcept {
+  return uint64_t(in[0]) | (uint64_t(in[1]) << 8) |
+    (uint64_t(in[2]) << 16) | (uint64_t(in[3]) << 24);
+}
+
+/// Mixes a lane of input into an accumulator.
+inline uint64_t Round(uint64_t accumulator, uint64_t lane) noexcept {
+  accumulator += lane * kPrime2;
+  accumulator = RotateLeft(accumulator, 31);
+  return accumulator * kPrime1;
+}
+
+/// Merges an accumulator into the hash.
+inline uint64_t MergeAccumulator(uint64_t hash, uint64_t accumulator) noexcept {
+  hash ^= Round(0, accumulator);
+  return hash * kPrime1 + kPrime4;
+}
+
+} // namespace
+
+/// Constructs a new XXH64 using the specified seed.
+XXH64::XXH64(uint64_t seed) noexcept :
+    seed_(seed),
+    accumulators_{seed + kPrime1 + kPrime2, seed + kPrime2, seed, seed - kPrime1},
+    buffer_(),
+    buffer_length_(0),
+    total_length_(0) {
+}
+
+/// Feeds a sequence of bytes.
+void XXH64::Update(const void * data, size_t size) noexcept {
+  const unsigned char * bytes = static_cast<const unsigned char *>(data);
+  total_length_ += size;
+
+  // Complete the buffered stripe first.
+  if (buffer_length_ != 0) {
+    const size_t length = (size < kStripeSize - buffer_length_) ? size : kStripeSize - buffer_length_;
+    memcpy(buffer_ + buffer_length_, bytes, length);
+    buffer_length_ += length;
+    bytes += length;
+    size -= length;
+
+    if (buffer_length_ < kStripeSize) {
+      return;
+    }
+    ConsumeStripe(buffer_);
+    buffer_length_ = 0;
+  }
+
+  // Consume the whole stripes in place.
+  while (size >= kStripeSize) {
+    ConsumeStripe(bytes);
+    bytes += kStripeSize;
+    size -= kStripeSize;
+  }
+
+  memcpy(buffer_, bytes, size);
+  buffer_length_ = size;
+}
+
+/// Returns the hash of the bytes fed so far.
+uint64_t XXH64::Digest() const noexcept {
+  uint64_t hash;
+  if (total_length_ >= kStripeSize) {
+    hash = RotateLeft(accumulators_[0], 1) + RotateLeft(accumulators_[1], 7) +
+      RotateLeft(accumulators_[2], 12) + RotateLeft(accumulators_[3], 18);
+    for (uint64_t accumulator : accumulators_) {
+      hash = MergeAccumulator(hash, accumulator);
+    }
+  }
+  else {
+    hash = seed_ + kPrime5;
+  }
+  hash += total_length_;
+
+  // Consume the remaining bytes.
+  const unsigned char * bytes = buffer_;
+  size_t size = buffer_length_;
+  while (size >= 8) {
+    hash ^= Round(0, Read64(bytes));
+    hash = RotateLeft(hash, 27) * kPrime1 + kPrime4;
+    bytes += 8;
+    size -= 8;
+  }
+  if (size >= 4) {
+    hash ^= Read32(bytes) * kPrime1;
+    hash = RotateLeft(hash, 23) * kPrime2 + kPrime3;
+    bytes += 4;
+    size -= 4;
+  }
+  while (size != 0) {
+    hash ^= uint64_t(*bytes) * kPrime5;
+    hash = RotateLeft(hash, 11) * kPrime1;
+    bytes++;
+    size--;
+  }
+
+  // Avalanche.
+  hash ^= hash >> 33;
+  hash *= kPrime2;
+  hash ^= hash >> 29;
+  hash *= kPrime3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+/// Computes the hash of a sequence of bytes.
+uint64_t XXH64::Hash(const void * data, size_t size, uint64_t seed) noexcept {
+  XXH64 hasher(seed);
+  hasher.Update(data, size);
+  return hasher.Digest();
+}
+
+/// Consumes a whole stripe.
+void XXH64::ConsumeStripe(const unsigned char * stripe) noexcept {
+  accumulators_[0] = Round(accumulators_[0], Read64(stripe));
+  accumulators_[1] = Round(accumulators_[1], Read64(stripe + 8));
+  accumulators_[2] = Round(accumulators_[2], Read64(stripe + 16));
+  accumulators_[3] = Round(accumulators_[3], Read64(stripe + 24));
+}
+
+} // namespace sf2cute
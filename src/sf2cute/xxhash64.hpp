@@ -0,0 +1,73 @@
+/// @file
+/// XXH64 hash function class header.
+///
+/// @author gocha <https://github.com/gocha>
+
+#ifndef SF2CUTE_XXHASH64_HPP_
+#define SF2CUTE_XXHASH64_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace sf2cute {
+
+/// The XXH64 class computes the 64-bit xxHash (XXH64) of a byte stream incrementally.
+///
+/// @remarks XXH64 is a fast non-cryptographic hash function.
+/// Its four independent accumulators keep the pipeline of the processor busy.
+/// @see https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md
+class XXH64 {
+public:
+  /// Constructs a new XXH64 using the specified seed.
+  /// @param seed the seed of the hash.
+  explicit XXH64(uint64_t seed = 0) noexcept;
+
+  /// Feeds a sequence of bytes.
+  /// @param data the pointer to the bytes.
+  /// @param size the number of bytes.
+  void Update(const void * data, size_t size) noexcept;
+
+  /// Returns the hash of the bytes fed so far.
+  /// @return the hash of the bytes fed so far.
+  uint64_t Digest() const noexcept;
+
+  /// Returns the number of bytes fed so far.
+  /// @return the number of bytes fed so far.
+  uint64_t total_length() const noexcept {
+    return total_length_;
+  }
+
+  /// Computes the hash of a sequence of bytes.
+  /// @param data the pointer to the bytes.
+  /// @param size the number of bytes.
+  /// @param seed the seed of the hash.
+  /// @return the hash of the bytes.
+  static uint64_t Hash(const void * data, size_t size, uint64_t seed = 0) noexcept;
+
+private:
+  /// The size of a stripe, in terms of bytes.
+  static constexpr size_t kStripeSize = 32;
+
+  /// Consumes a whole stripe.
+  /// @param stripe the pointer to the stripe.
+  void ConsumeStripe(const unsigned char * stripe) noexcept;
+
+  /// The seed of the hash.
+  uint64_t seed_;
+
+  /// The accumulators.
+  uint64_t accumulators_[4];
+
+  /// The bytes of the incomplete stripe.
+  unsigned char buffer_[kStripeSize];
+
+  /// The number of bytes stored in the buffer.
+  size_t buffer_length_;
+
+  /// The number of bytes fed so far.
+  uint64_t total_length_;
+};
+
+} // namespace sf2cute
+
+#endif // SF2CUTE_XXHASH64_HPP_
@@ -0,0 +1,422 @@
+/// @file
+/// Writes SoundFont 2 files, reads them back, and checks that nothing is lost on the way.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sf2cute.hpp>
+
+#include "test_utility.hpp"
+
+using namespace sf2cute;
+using namespace sf2cute_test;
+
+namespace {
+
+/// The number of threads used by the multi-threaded cases.
+constexpr unsigned kNumThreads = 4;
+
+/// Checks that the samples of two SoundFonts have the same properties and data.
+/// @param expected the SoundFont that was written.
+/// @param actual the SoundFont that was read.
+void CheckSameSamples(const SoundFont & expected, const SoundFont & actual) {
+  SF2CUTE_CHECK(expected.samples().size() == actual.samples().size());
+  for (size_t index = 0; index < expected.samples().size(); index++) {
+    const SFSample & expected_sample = *expected.samples()[index];
+    const SFSample & actual_sample = *actual.samples()[index];
+    SF2CUTE_CHECK(expected_sample.name() == actual_sample.name());
+    SF2CUTE_CHECK(expected_sample.start_loop() == actual_sample.start_loop());
+    SF2CUTE_CHECK(expected_sample.end_loop() == actual_sample.end_loop());
+    SF2CUTE_CHECK(expected_sample.sample_rate() == actual_sample.sample_rate());
+    SF2CUTE_CHECK(expected_sample.original_key() == actual_sample.original_key());
+    SF2CUTE_CHECK(expected_sample.correction() == actual_sample.correction());
+    SF2CUTE_CHECK(expected_sample.type() == actual_sample.type());
+    SF2CUTE_CHECK(expected_sample.data_length() == actual_sample.data_length());
+    SF2CUTE_CHECK(expected_sample.data() == actual_sample.data());
+    SF2CUTE_CHECK(expected_sample.low_byte_data() == actual_sample.low_byte_data());
+  }
+}
+
+/// Writes a SoundFont to a file, reads it back, and checks that writing it again gives the same bytes.
+/// @param file the SoundFont.
+/// @param filename the name of the file to write to.
+/// @param lazy_sample_data true to leave the sample data in the file while reading.
+/// @param num_threads the number of threads of the reader and the writer.
+void CheckRoundTrip(const SoundFont & file, const std::string & filename,
+    bool lazy_sample_data, unsigned num_threads) {
+  SoundFontWriter writer(file);
+  writer.set_num_threads(num_threads);
+  writer.Write(filename);
+  const std::string expected = ReadFileBytes(filename);
+
+  SoundFontReader reader;
+  reader.set_lazy_sample_data(lazy_sample_data);
+  reader.set_num_threads(num_threads);
+  SoundFont read_file = reader.Read(filename);
+
+  // Write before the data is touched, so that a lazy sample is copied from the file.
+  SoundFontWriter read_writer(read_file);
+  read_writer.set_num_threads(num_threads);
+  read_writer.Write(filename + ".out");
+  SF2CUTE_CHECK(ReadFileBytes(filename + ".out") == expected);
+
+  CheckSameSamples(file, read_file);
+  std::remove((filename + ".out").c_str());
+  std::remove(filename.c_str());
+}
+
+/// Reads the sample data while writing, and writes back without reading the sample data.
+void TestEagerRoundTrip() {
+  const SoundFont file = MakeTestSoundFont(false);
+  CheckRoundTrip(file, "round_trip_eager_1.sf2", false, 1);
+  CheckRoundTrip(file, "round_trip_eager_n.sf2", false, kNumThreads);
+}
+
+/// Leaves the sample data in the file while reading.
+void TestLazyRoundTrip() {
+  const SoundFont file = MakeTestSoundFont(false);
+  CheckRoundTrip(file, "round_trip_lazy_1.sf2", true, 1);
+  CheckRoundTrip(file, "round_trip_lazy_n.sf2", true, kNumThreads);
+}
+
+/// Writes a lazily read SoundFont back to the file it was read from.
+void TestLazyWriteToSource() {
+  const std::string filename = "round_trip_lazy_source.sf2";
+  const SoundFont file = MakeTestSoundFont(false);
+  const std::string expected = WriteToBytes(file);
+  for (const SFFileWriteMode mode : {SFFileWriteMode::kBuffered, SFFileWriteMode::kMemoryMapped,
+      SFFileWriteMode::kPositional, SFFileWriteMode::kDirect}) {
+    SoundFontWriter(file).Write(filename);
+
+    SoundFontReader reader;
+    reader.set_lazy_sample_data(true);
+    SoundFont read_file = reader.Read(filename);
+    SoundFontWriter writer(read_file);
+    writer.set_file_write_mode(mode);
+    writer.Write(filename);
+    SF2CUTE_CHECK(ReadFileBytes(filename) == expected);
+  }
+  std::remove(filename.c_str());
+}
+
+/// Reads a SoundFont from a stream and from memory.
+void TestReadFromStreamAndMemory() {
+  const SoundFont file = MakeTestSoundFont(true);
+  const std::string expected = WriteToBytes(file);
+
+  SoundFontReader reader;
+  std::istringstream in(expected);
+  const SoundFont stream_file = reader.Read(in);
+  SF2CUTE_CHECK(WriteToBytes(stream_file) == expected);
+  CheckSameSamples(file, stream_file);
+
+  const SoundFont memory_file = reader.Read(expected.data(), expected.size());
+  SF2CUTE_CHECK(WriteToBytes(memory_file) == expected);
+  CheckSameSamples(file, memory_file);
+}
+
+/// The CountingHandler class counts the records passed by SoundFontParser.
+class CountingHandler : public SFParseHandler {
+public:
+  /// The strings of INFO chunk, by their chunk names.
+  std::map<std::string, std::string> infos;
+
+  /// The sizes of the chunks in sdta chunk, by their chunk names.
+  std::map<std::string, uint32_t> sample_data_sizes;
+
+  /// The names of the phdr records.
+  std::vector<std::string> preset_names;
+
+  /// The names of the inst records.
+  std::vector<std::string> instrument_names;
+
+  /// The names of the shdr records.
+  std::vector<std::string> sample_names;
+
+  /// The number of pbag, pmod and pgen records.
+  size_t num_preset_bags = 0, num_preset_modulators = 0, num_preset_generators = 0;
+
+  /// The number of ibag, imod and igen records.
+  size_t num_instrument_bags = 0, num_instrument_modulators = 0, num_instrument_generators = 0;
+
+  virtual void OnInfo(const std::string & name, const std::string & text) override {
+    infos[name] = text;
+  }
+
+  virtual void OnSampleData(const std::string & name, uint64_t, uint32_t size) override {
+    sample_data_sizes[name] = size;
+  }
+
+  virtual void OnPresetHeader(size_t, const SFParsedPresetHeader & header) override {
+    preset_names.push_back(header.name);
+  }
+
+  virtual void OnBag(SFHydraLevel level, size_t, const SFParsedBag &) override {
+    (level == SFHydraLevel::kPreset ? num_preset_bags : num_instrument_bags)++;
+  }
+
+  virtual void OnModulator(SFHydraLevel level, size_t, const SFModulatorItem &) override {
+    (level == SFHydraLevel::kPreset ? num_preset_modulators : num_instrument_modulators)++;
+  }
+
+  virtual void OnGenerator(SFHydraLevel level, size_t, const SFGeneratorItem &) override {
+    (level == SFHydraLevel::kPreset ? num_preset_generators : num_instrument_generators)++;
+  }
+
+  virtual void OnInstrument(size_t, const SFParsedInstrument & instrument) override {
+    instrument_names.push_back(instrument.name);
+  }
+
+  virtual void OnSampleHeader(size_t, const SFParsedSampleHeader & header) override {
+    sample_names.push_back(header.name);
+  }
+};
+
+/// Checks the records counted by a handler against a SoundFont read by SoundFontReader.
+/// @param handler the handler that counted the records.
+/// @param file the SoundFont.
+void CheckParsedRecords(const CountingHandler & handler, const SoundFont & file) {
+  // Each list ends with a terminator record.
+  SF2CUTE_CHECK(handler.preset_names.size() == file.presets().size() + 1);
+  SF2CUTE_CHECK(handler.instrument_names.size() == file.instruments().size() + 1);
+  SF2CUTE_CHECK(handler.sample_names.size() == file.samples().size() + 1);
+
+  size_t num_bags = 1, num_modulators = 1, num_generators = 1;
+  for (size_t index = 0; index < file.presets().size(); index++) {
+    const SFPreset & preset = *file.presets()[index];
+    SF2CUTE_CHECK(handler.preset_names[index] == preset.name());
+    if (preset.has_global_zone()) {
+      num_bags++;
+      num_modulators += preset.global_zone().modulators().size();
+      num_generators += preset.global_zone().generators().size();
+    }
+    for (const auto & zone : preset.zones()) {
+      // The instrument of a zone is written as its last generator.
+      num_bags++;
+      num_modulators += zone->modulators().size();
+      num_generators += zone->generators().size() + 1;
+    }
+  }
+  SF2CUTE_CHECK(handler.num_preset_bags == num_bags);
+  SF2CUTE_CHECK(handler.num_preset_modulators == num_modulators);
+  SF2CUTE_CHECK(handler.num_preset_generators == num_generators);
+
+  num_bags = 1, num_modulators = 1, num_generators = 1;
+  for (size_t index = 0; index < file.instruments().size(); index++) {
+    const SFInstrument & instrument = *file.instruments()[index];
+    SF2CUTE_CHECK(handler.instrument_names[index] == instrument.name());
+    if (instrument.has_global_zone()) {
+      num_bags++;
+      num_modulators += instrument.global_zone().modulators().size();
+      num_generators += instrument.global_zone().generators().size();
+    }
+    for (const auto & zone : instrument.zones()) {
+      // The sample of a zone is written as its last generator.
+      num_bags++;
+      num_modulators += zone->modulators().size();
+      num_generators += zone->generators().size() + 1;
+    }
+  }
+  SF2CUTE_CHECK(handler.num_instrument_bags == num_bags);
+  SF2CUTE_CHECK(handler.num_instrument_modulators == num_modulators);
+  SF2CUTE_CHECK(handler.num_instrument_generators == num_generators);
+
+  for (size_t index = 0; index < file.samples().size(); index++) {
+    SF2CUTE_CHECK(handler.sample_names[index] == file.samples()[index]->name());
+  }
+
+  SF2CUTE_CHECK(handler.infos.at("INAM") == file.bank_name());
+  SF2CUTE_CHECK(handler.infos.at("isng") == file.sound_engine());
+  SF2CUTE_CHECK(handler.infos.at("ICMT") == file.comment());
+}
+
+/// Parses a file with SoundFontParser, and checks the records against SoundFontReader.
+void TestParseRecordCounts() {
+  const std::string filename = "round_trip_parse.sf2";
+  const SoundFont file = MakeTestSoundFont(true);
+  SoundFontWriter(file).Write(filename);
+  const SoundFont read_file = SoundFontReader().Read(filename);
+
+  CountingHandler file_handler;
+  SoundFontParser().Parse(filename, file_handler);
+  CheckParsedRecords(file_handler, read_file);
+  SF2CUTE_CHECK(file_handler.sample_data_sizes.count("smpl") == 1);
+  SF2CUTE_CHECK(file_handler.sample_data_sizes.count("sm24") == 1);
+
+  // The other inputs give the same records.
+  const std::string bytes = ReadFileBytes(filename);
+  CountingHandler stream_handler;
+  SoundFontParser().Parse(std::istringstream(bytes), stream_handler);
+  CheckParsedRecords(stream_handler, read_file);
+
+  CountingHandler memory_handler;
+  SoundFontParser().Parse(bytes.data(), bytes.size(), memory_handler);
+  CheckParsedRecords(memory_handler, read_file);
+  std::remove(filename.c_str());
+}
+
+/// Reads the metadata of a file with SoundFontReader::ReadSummary(), and checks it against Read().
+void TestReadSummary() {
+  const std::string filename = "round_trip_summary.sf2";
+  SoundFontWriter(MakeTestSoundFont(false)).Write(filename);
+  SoundFontReader reader;
+  const SoundFont file = reader.Read(filename);
+  const SFFileSummary summary = reader.ReadSummary(filename);
+
+  SF2CUTE_CHECK(summary.version == SFVersionTag(2, 1));
+  SF2CUTE_CHECK(summary.sound_engine == file.sound_engine());
+  SF2CUTE_CHECK(summary.bank_name == file.bank_name());
+  SF2CUTE_CHECK(summary.rom_name == file.rom_name());
+  SF2CUTE_CHECK(summary.has_rom_version == file.has_rom_version());
+  SF2CUTE_CHECK(summary.rom_version == file.rom_version());
+  SF2CUTE_CHECK(summary.creation_date == file.creation_date());
+  SF2CUTE_CHECK(summary.engineers == file.engineers());
+  SF2CUTE_CHECK(summary.product == file.product());
+  SF2CUTE_CHECK(summary.copyright == file.copyright());
+  SF2CUTE_CHECK(summary.comment == file.comment());
+  SF2CUTE_CHECK(summary.software == file.software());
+
+  SF2CUTE_CHECK(summary.presets.size() == file.presets().size());
+  for (size_t index = 0; index < file.presets().size(); index++) {
+    SF2CUTE_CHECK(summary.presets[index].name == file.presets()[index]->name());
+    SF2CUTE_CHECK(summary.presets[index].preset_number == file.presets()[index]->preset_number());
+    SF2CUTE_CHECK(summary.presets[index].bank == file.presets()[index]->bank());
+  }
+  std::remove(filename.c_str());
+}
+
+/// Writes the identical sample data only once, and reads each sample back with its own data.
+void TestDeduplicatedRoundTrip() {
+  const std::string filename = "round_trip_dedup.sf2";
+  const SoundFont file = MakeTestSoundFont(false);
+  const std::string plain = WriteToBytes(file);
+  for (const bool lazy_sample_data : {false, true}) {
+    SoundFontWriter writer(file);
+    writer.set_deduplicate_samples(true);
+    writer.Write(filename);
+    const std::string expected = ReadFileBytes(filename);
+    SF2CUTE_CHECK(expected.size() < plain.size());
+
+    SoundFontReader reader;
+    reader.set_lazy_sample_data(lazy_sample_data);
+    const SoundFont read_file = reader.Read(filename);
+    if (!lazy_sample_data) {
+      // The samples whose data are stored in a file are always written in full.
+      SoundFontWriter read_writer(read_file);
+      read_writer.set_deduplicate_samples(true);
+      SF2CUTE_CHECK(WriteToBytes(read_writer) == expected);
+    }
+    CheckSameSamples(file, read_file);
+
+    // Without deduplication, the data is written in full again.
+    SF2CUTE_CHECK(WriteToBytes(read_file) == plain);
+  }
+  std::remove(filename.c_str());
+}
+
+/// Writes 24-bit sample data to the sm24 chunk, and reads it back.
+void TestSm24RoundTrip() {
+  const SoundFont file = MakeTestSoundFont(true);
+  CheckRoundTrip(file, "round_trip_sm24_1.sf2", false, 1);
+  CheckRoundTrip(file, "round_trip_sm24_n.sf2", true, kNumThreads);
+
+  SoundFontWriter writer(file);
+  writer.set_deduplicate_samples(true);
+  const std::string expected = WriteToBytes(writer);
+  const SoundFont read_file = SoundFontReader().Read(expected.data(), expected.size());
+  SoundFontWriter read_writer(read_file);
+  read_writer.set_deduplicate_samples(true);
+  SF2CUTE_CHECK(WriteToBytes(read_writer) == expected);
+  CheckSameSamples(file, read_file);
+}
+
+/// Updates the INFO and pdta chunks of a file in place.
+void TestUpdateInPlace() {
+  const std::string filename = "round_trip_update.sf2";
+  SoundFont file = MakeTestSoundFont(false);
+  SoundFontWriter(file).Write(filename);
+
+  // The hydra grows, and the sample data is the same.
+  file.set_comment("A longer comment than the one written first");
+  file.presets().front()->set_name("Renamed");
+  file.NewPreset("Added", 100, 0, std::vector<SFPresetZone>{SFPresetZone(file.instruments().back())});
+  SoundFontWriter(file).Update(filename);
+  const SoundFont updated_file = SoundFontReader().Read(filename);
+  SF2CUTE_CHECK(WriteToBytes(updated_file) == WriteToBytes(file));
+
+  // The sample data changes, and the file is written in full.
+  file.NewSample("Added", MakeSampleData(1001, 99), 0, 1000, 44100, 60, 0);
+  SoundFontWriter(file).Update(filename);
+  SF2CUTE_CHECK(ReadFileBytes(filename) == WriteToBytes(file));
+  std::remove(filename.c_str());
+}
+
+/// Copies the unchanged sample data from the previous output with a build cache.
+void TestBuildCache() {
+  const std::string filename = "round_trip_cache.sf2";
+  const std::string index_filename = "round_trip_cache.idx";
+  std::remove(filename.c_str());
+  std::remove(index_filename.c_str());
+
+  SoundFont file = MakeTestSoundFont(false);
+  {
+    SFBuildCache cache;
+    SoundFontWriter writer(file);
+    writer.set_build_cache(&cache);
+    writer.Write(filename);
+    SF2CUTE_CHECK(cache.num_copied_samples() == 0);
+    cache.Save(index_filename);
+  }
+
+  // The new sample is serialized, and the others are copied from the previous output.
+  // The next build copies every sample, with and without comparing the bytes.
+  file.NewSample("Added", MakeSampleData(777, 77), 0, 700, 44100, 60, 0);
+  const size_t num_samples = file.samples().size();
+  for (const bool verify_data : {false, true}) {
+    SFBuildCache cache;
+    cache.Load(index_filename);
+    cache.set_verify_data(verify_data);
+    SoundFontWriter writer(file);
+    writer.set_build_cache(&cache);
+    writer.Write(filename);
+    SF2CUTE_CHECK(ReadFileBytes(filename) == WriteToBytes(file));
+#ifdef SF2CUTE_HAS_POSIX_IO
+    const size_t num_new_samples = verify_data ? 0 : 1;
+    SF2CUTE_CHECK(cache.num_copied_samples() == num_samples - num_new_samples);
+    SF2CUTE_CHECK(cache.num_serialized_samples() == num_new_samples);
+#endif
+    cache.Save(index_filename);
+  }
+  std::remove(filename.c_str());
+  std::remove(index_filename.c_str());
+}
+
+/// The test cases.
+const TestCase kTestCases[] = {
+  {"eager", TestEagerRoundTrip},
+  {"lazy", TestLazyRoundTrip},
+  {"lazy_write_to_source", TestLazyWriteToSource},
+  {"stream_and_memory", TestReadFromStreamAndMemory},
+  {"parse", TestParseRecordCounts},
+  {"summary", TestReadSummary},
+  {"dedup", TestDeduplicatedRoundTrip},
+  {"sm24", TestSm24RoundTrip},
+  {"update", TestUpdateInPlace},
+  {"build_cache", TestBuildCache},
+};
+
+} // namespace
+
+/// Runs the round trip tests.
+/// @param argc the number of arguments.
+/// @param argv the arguments. The first argument, if any, is the name of the test case to run.
+/// @return 0 if the tests pass.
+int main(int argc, char * argv[]) {
+  return RunTestCases(argc, argv, kTestCases);
+}
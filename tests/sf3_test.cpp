@@ -0,0 +1,209 @@
+/// @file
+/// Writes SoundFont 3 files with a test encoder, and checks the layout of the compressed sample pool.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sf2cute.hpp>
+
+#include "test_utility.hpp"
+
+using namespace sf2cute;
+using namespace sf2cute_test;
+
+namespace {
+
+/// The TestEncoder class represents an encoder that writes a short digest of each sample.
+///
+/// The output is not audio. It only has to vary in size between samples,
+/// so that the sample headers have uneven byte offsets and the compressed sample pool needs padding.
+class TestEncoder : public SFSampleEncoder {
+public:
+  /// Constructs a new TestEncoder.
+  TestEncoder() : num_calls_(0) {
+  }
+
+  /// Returns the number of samples compressed so far.
+  /// @return the number of calls of Encode().
+  size_t num_calls() const noexcept {
+    return num_calls_.load();
+  }
+
+  /// Returns the compressed data of a sample.
+  /// @param data the sample data points.
+  /// @return the compressed sample data, which is (length % 7) + 5 bytes long.
+  static std::vector<char> EncodeData(const std::vector<int16_t> & data) {
+    // For the samples of MakeTestSoundFont(), these sizes add up to an odd number,
+    // with or without deduplication.
+    std::vector<char> bytes{'T', 'E', 'S', 'T'};
+    for (size_t index = 0; index < data.size() % 7; index++) {
+      bytes.push_back(static_cast<char>(data[index] & 0xff));
+    }
+    bytes.push_back(static_cast<char>(data.size() & 0xff));
+    return bytes;
+  }
+
+  /// Compresses the data of a sample.
+  /// @param sample the sample. Not used.
+  /// @param data the sample data points.
+  /// @return the compressed sample data.
+  virtual std::vector<char> Encode(const SFSample & sample, const std::vector<int16_t> & data) override {
+    static_cast<void>(sample);
+    num_calls_++;
+    return EncodeData(data);
+  }
+
+private:
+  /// The number of samples compressed so far.
+  std::atomic<size_t> num_calls_;
+};
+
+/// The SampleHandler class collects the sample data chunks and the sample headers.
+class SampleHandler : public SFParseHandler {
+public:
+  /// The version of the file (ifil).
+  SFVersionTag version;
+
+  /// The offsets of the chunks in sdta chunk, by their chunk names.
+  std::map<std::string, uint64_t> sample_data_offsets;
+
+  /// The sizes of the chunks in sdta chunk, by their chunk names.
+  std::map<std::string, uint32_t> sample_data_sizes;
+
+  /// The shdr records, excluding the terminator record.
+  std::vector<SFParsedSampleHeader> headers;
+
+  virtual void OnVersion(const std::string & name, const SFVersionTag & version_tag) override {
+    if (name == "ifil") {
+      version = version_tag;
+    }
+  }
+
+  virtual void OnSampleData(const std::string & name, uint64_t offset, uint32_t size) override {
+    sample_data_offsets[name] = offset;
+    sample_data_sizes[name] = size;
+  }
+
+  virtual void OnSampleHeader(size_t, const SFParsedSampleHeader & header) override {
+    if (header.name != "EOS") {
+      headers.push_back(header);
+    }
+  }
+};
+
+/// Checks the compressed sample pool and the sample headers of an SF3 file.
+/// @param bytes the bytes of the SF3 file.
+/// @param file the SoundFont that was written.
+/// @param deduplicate_samples true if the file was written with deduplication.
+void CheckSampleLayout(const std::string & bytes, const SoundFont & file, bool deduplicate_samples) {
+  SampleHandler handler;
+  SoundFontParser().Parse(bytes.data(), bytes.size(), handler);
+  SF2CUTE_CHECK(handler.version.major_version == 3);
+  SF2CUTE_CHECK(handler.sample_data_sizes.count("smpl") == 1);
+  SF2CUTE_CHECK(handler.sample_data_sizes.count("sm24") == 0);
+  SF2CUTE_CHECK(handler.headers.size() == file.samples().size());
+
+  // The compressed data are placed in order, and a shared sample points to the data of its origin.
+  const uint64_t smpl_offset = handler.sample_data_offsets.at("smpl");
+  const uint32_t smpl_size = handler.sample_data_sizes.at("smpl");
+  std::map<std::vector<int16_t>, uint32_t> written_offsets;
+  uint32_t offset = 0;
+  for (size_t index = 0; index < file.samples().size(); index++) {
+    const SFSample & sample = *file.samples()[index];
+    const SFParsedSampleHeader & header = handler.headers[index];
+    const std::vector<char> expected = TestEncoder::EncodeData(sample.data());
+
+    const auto written = written_offsets.find(sample.data());
+    if (deduplicate_samples && written != written_offsets.end()) {
+      SF2CUTE_CHECK(header.start == written->second);
+    }
+    else {
+      SF2CUTE_CHECK(header.start == offset);
+      offset += uint32_t(expected.size());
+      written_offsets.insert(std::make_pair(sample.data(), header.start));
+    }
+    SF2CUTE_CHECK(header.end == header.start + expected.size());
+    SF2CUTE_CHECK(std::string(bytes, size_t(smpl_offset + header.start), expected.size()) ==
+      std::string(expected.begin(), expected.end()));
+
+    // The loop points are relative to the beginning of the sample.
+    SF2CUTE_CHECK(header.start_loop == sample.start_loop());
+    SF2CUTE_CHECK(header.end_loop == sample.end_loop());
+    SF2CUTE_CHECK(uint16_t(header.type) ==
+      (uint16_t(sample.type()) | SFSampleEncoder::kVorbisSampleType));
+  }
+  SF2CUTE_CHECK(smpl_size == offset);
+
+  // An odd-sized smpl chunk is followed by a zero padding byte.
+  SF2CUTE_CHECK(smpl_size % 2 == 1);
+  SF2CUTE_CHECK(bytes[size_t(smpl_offset + smpl_size)] == 0);
+}
+
+/// Writes an SF3 file, and checks its compressed sample pool.
+void TestSampleLayout() {
+  const SoundFont file = MakeTestSoundFont(false);
+  TestEncoder encoder;
+  SoundFontWriter writer(file);
+  writer.set_sample_encoder(&encoder);
+  const std::string bytes = WriteToBytes(writer);
+  SF2CUTE_CHECK(encoder.num_calls() == file.samples().size());
+  CheckSampleLayout(bytes, file, false);
+
+  // ReadSummary() lists the SF3 file as well.
+  const std::string filename = "sf3_layout.sf3";
+  writer.Write(filename);
+  const SFFileSummary summary = SoundFontReader().ReadSummary(filename);
+  SF2CUTE_CHECK(summary.version.major_version == 3);
+  SF2CUTE_CHECK(summary.presets.size() == file.presets().size());
+  std::remove(filename.c_str());
+}
+
+/// Writes an SF3 file with deduplication, which compresses the identical sample data once.
+void TestDeduplicatedSampleLayout() {
+  const SoundFont file = MakeTestSoundFont(false);
+  TestEncoder encoder;
+  SoundFontWriter writer(file);
+  writer.set_sample_encoder(&encoder);
+  writer.set_deduplicate_samples(true);
+  const std::string bytes = WriteToBytes(writer);
+  SF2CUTE_CHECK(encoder.num_calls() < file.samples().size());
+  CheckSampleLayout(bytes, file, true);
+}
+
+/// Compresses the samples on several threads, which gives the same bytes.
+void TestMultiThreadedEncoding() {
+  const SoundFont file = MakeTestSoundFont(true);
+  TestEncoder encoder;
+  SoundFontWriter writer(file);
+  writer.set_sample_encoder(&encoder);
+  const std::string expected = WriteToBytes(writer);
+
+  writer.set_num_threads(4);
+  SF2CUTE_CHECK(WriteToBytes(writer) == expected);
+
+  // The lower 8 bits of 24-bit sample data are not written.
+  CheckSampleLayout(expected, file, false);
+}
+
+/// The test cases.
+const TestCase kTestCases[] = {
+  {"layout", TestSampleLayout},
+  {"dedup", TestDeduplicatedSampleLayout},
+  {"threads", TestMultiThreadedEncoding},
+};
+
+} // namespace
+
+/// Runs the SF3 tests.
+/// @param argc the number of arguments.
+/// @param argv the arguments. The first argument, if any, is the name of the test case to run.
+/// @return 0 if the tests pass.
+int main(int argc, char * argv[]) {
+  return RunTestCases(argc, argv, kTestCases);
+}
@@ -0,0 +1,230 @@
+/// @file
+/// Helpers shared by the SF2cute tests.
+
+#ifndef SF2CUTE_TESTS_TEST_UTILITY_HPP_
+#define SF2CUTE_TESTS_TEST_UTILITY_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sf2cute.hpp>
+
+/// Fails the current test case if the condition is false.
+#define SF2CUTE_CHECK(condition) \
+  ((condition) ? static_cast<void>(0) : \
+    ::sf2cute_test::Fail(#condition, __FILE__, __LINE__))
+
+namespace sf2cute_test {
+
+/// Throws an exception that fails the current test case.
+/// @param condition the text of the failed condition.
+/// @param file the name of the source file.
+/// @param line the line number in the source file.
+/// @throws std::runtime_error always.
+[[noreturn]] inline void Fail(const char * condition, const char * file, int line) {
+  std::ostringstream message_builder;
+  message_builder << file << ":" << line << ": check failed: " << condition;
+  throw std::runtime_error(message_builder.str());
+}
+
+/// The TestCase struct represents a named test case.
+struct TestCase {
+  /// The name of the test case, given on the command line.
+  const char * name;
+
+  /// The function that runs the test case.
+  void (*run)();
+};
+
+/// Runs the test case named on the command line, or all the test cases.
+/// @param argc the number of arguments.
+/// @param argv the arguments. The first argument, if any, is the name of the test case.
+/// @param test_cases the test cases.
+/// @return 0 if the test cases pass.
+template <size_t N>
+int RunTestCases(int argc, char * argv[], const TestCase (&test_cases)[N]) {
+  const std::string selected_name = argc >= 2 ? argv[1] : "";
+  int num_failures = 0;
+  bool found = false;
+  for (const TestCase & test_case : test_cases) {
+    if (!selected_name.empty() && selected_name != test_case.name) {
+      continue;
+    }
+
+    found = true;
+    try {
+      test_case.run();
+      std::cout << "[PASS] " << test_case.name << std::endl;
+    }
+    catch (const std::exception & ex) {
+      std::cout << "[FAIL] " << test_case.name << ": " << ex.what() << std::endl;
+      num_failures++;
+    }
+  }
+
+  if (!found) {
+    std::cout << "Unknown test case \"" << selected_name << "\"." << std::endl;
+    return 1;
+  }
+  return num_failures == 0 ? 0 : 1;
+}
+
+/// Returns the contents of a file.
+/// @param filename the name of the file.
+/// @return the bytes of the file.
+/// @throws std::ios_base::failure The file could not be read.
+inline std::string ReadFileBytes(const std::string & filename) {
+  std::ifstream in;
+  in.exceptions(std::ios::badbit);
+  in.open(filename, std::ios::binary);
+  if (!in.is_open()) {
+    throw std::ios_base::failure("Could not open \"" + filename + "\".");
+  }
+  return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+/// Writes a SoundFont to memory.
+/// @param writer the writer of the SoundFont.
+/// @return the bytes of the SoundFont file.
+inline std::string WriteToBytes(sf2cute::SoundFontWriter & writer) {
+  std::ostringstream out;
+  writer.Write(out);
+  return out.str();
+}
+
+/// Writes a SoundFont to memory with the default settings.
+/// @param file the SoundFont.
+/// @return the bytes of the SoundFont file.
+inline std::string WriteToBytes(const sf2cute::SoundFont & file) {
+  sf2cute::SoundFontWriter writer(file);
+  return WriteToBytes(writer);
+}
+
+/// Makes the data points of a test sample.
+/// @param length the number of data points.
+/// @param seed the seed of the data points.
+/// @return the data points.
+inline std::vector<int16_t> MakeSampleData(size_t length, uint32_t seed) {
+  // A linear congruential generator keeps the data the same on every platform.
+  std::vector<int16_t> data(length);
+  uint32_t state = seed;
+  for (auto & data_point : data) {
+    state = state * 1664525 + 1013904223;
+    data_point = static_cast<int16_t>(state >> 16);
+  }
+  return data;
+}
+
+/// Makes a SoundFont that uses every part of the hydra.
+///
+/// The SoundFont has INFO strings, a stereo pair, samples with identical data,
+/// global zones, generators and modulators at both levels.
+/// @param with_24bit_data true to give some samples 24-bit sample data.
+/// @return the SoundFont.
+inline sf2cute::SoundFont MakeTestSoundFont(bool with_24bit_data) {
+  using namespace sf2cute;
+
+  SoundFont sf2;
+  sf2.set_sound_engine("EMU8000");
+  sf2.set_bank_name("Test Bank");
+  sf2.set_rom_name("ROM");
+  sf2.set_rom_version(SFVersionTag(1, 0));
+  sf2.set_creation_date("October 18, 2026");
+  sf2.set_engineers("Engineers");
+  sf2.set_product("Product");
+  sf2.set_copyright("Copyright");
+  sf2.set_comment("Comment");
+  sf2.set_software("SF2cute tests");
+
+  // Samples, whose lengths include odd ones.
+  std::vector<std::shared_ptr<SFSample>> samples;
+  for (uint32_t index = 0; index < 12; index++) {
+    std::vector<int16_t> data = MakeSampleData(301 + 97 * index, index + 1);
+    if (index % 5 == 4) {
+      // The same data as the previous sample, which deduplication shares.
+      data = samples.back()->data();
+    }
+    std::shared_ptr<SFSample> sample = sf2.NewSample("Sample " + std::to_string(index),
+      std::move(data), 8, uint32_t(200 + index), 22050 + 1000 * index, uint8_t(48 + index), int8_t(index) - 6);
+    if (with_24bit_data && index % 3 == 0) {
+      std::vector<int32_t> data24(sample->data().size());
+      for (size_t offset = 0; offset < data24.size(); offset++) {
+        data24[offset] = int32_t(sample->data()[offset]) * 256 + int32_t((offset * 7 + index) & 0xff);
+      }
+      sample->set_data24(data24);
+    }
+    samples.push_back(std::move(sample));
+  }
+  samples[1]->set_link(samples[2]);
+  samples[1]->set_type(SFSampleLink::kLeftSample);
+  samples[2]->set_link(samples[1]);
+  samples[2]->set_type(SFSampleLink::kRightSample);
+
+  // Instruments.
+  const SFModulatorItem velocity_modulator(
+    SFModulator(SFGeneralController::kNoteOnVelocity, SFControllerDirection::kDecrease,
+      SFControllerPolarity::kUnipolar, SFControllerType::kConcave),
+    SFGenerator::kInitialAttenuation, 960, SFModulator(0), SFTransform::kLinear);
+  const SFModulatorItem key_modulator(
+    SFModulator(SFGeneralController::kNoteOnKeyNumber, SFControllerDirection::kIncrease,
+      SFControllerPolarity::kUnipolar, SFControllerType::kLinear),
+    SFGenerator::kPan, 100, SFModulator(0), SFTransform::kLinear);
+  std::vector<std::shared_ptr<SFInstrument>> instruments;
+  for (size_t index = 0; index < 6; index++) {
+    std::vector<SFInstrumentZone> zones;
+    for (size_t zone_index = 0; zone_index < 1 + index % 3; zone_index++) {
+      SFInstrumentZone zone(samples[(index * 2 + zone_index) % samples.size()]);
+      zone.SetGenerator(SFGeneratorItem(SFGenerator::kKeyRange,
+        RangesType(uint8_t(zone_index * 40), uint8_t(zone_index * 40 + 39))));
+      zone.SetGenerator(SFGeneratorItem(SFGenerator::kPan, int16_t(zone_index * 10)));
+      if (zone_index % 2 == 0) {
+        zone.SetModulator(key_modulator);
+      }
+      zones.push_back(std::move(zone));
+    }
+    std::shared_ptr<SFInstrument> instrument =
+      sf2.NewInstrument("Instrument " + std::to_string(index), std::move(zones));
+    if (index % 2 == 0) {
+      SFInstrumentZone global_zone;
+      global_zone.SetGenerator(SFGeneratorItem(SFGenerator::kReleaseVolEnv, -1200));
+      global_zone.SetModulator(velocity_modulator);
+      instrument->set_global_zone(std::move(global_zone));
+    }
+    instruments.push_back(std::move(instrument));
+  }
+
+  // Presets.
+  for (size_t index = 0; index < 5; index++) {
+    std::vector<SFPresetZone> zones;
+    for (size_t zone_index = 0; zone_index < 1 + index % 2; zone_index++) {
+      SFPresetZone zone(instruments[(index + zone_index) % instruments.size()]);
+      zone.SetGenerator(SFGeneratorItem(SFGenerator::kCoarseTune, int16_t(zone_index)));
+      if (index % 2 == 1) {
+        zone.SetModulator(velocity_modulator);
+      }
+      zones.push_back(std::move(zone));
+    }
+    std::shared_ptr<SFPreset> preset = sf2.NewPreset("Preset " + std::to_string(index),
+      uint16_t(index), uint16_t(index / 3), std::move(zones));
+    if (index == 3) {
+      SFPresetZone global_zone;
+      global_zone.SetGenerator(SFGeneratorItem(SFGenerator::kChorusEffectsSend, 200));
+      preset->set_global_zone(std::move(global_zone));
+    }
+  }
+  return sf2;
+}
+
+} // namespace sf2cute_test
+
+#endif // SF2CUTE_TESTS_TEST_UTILITY_HPP_